@@ -0,0 +1,388 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "image_resizer/base64.hpp"
+#include "image_resizer/codec.hpp"
+#include "image_resizer/image_resizer.hpp"
+#include "image_resizer/interpolation.hpp"
+#include "image_resizer/metrics.hpp"
+#include "image_resizer/parallel_jpeg.hpp"
+#include "image_resizer/resize_pipeline.hpp"
+#include "image_resizer/worker_pool.hpp"
+
+// Source resolutions, indexed by the first benchmark argument
+static const cv::Size source_sizes[] = {{640, 480}, {1920, 1080}, {3840, 2160}, {7680, 4320}};
+static const char *source_names[] = {"640x480", "1080p", "4K", "8K"};
+
+// Encodings, indexed by the second benchmark argument
+static const char *format_exts[] = {".jpg", ".png"};
+static const char *format_names[] = {"jpeg", "png"};
+
+// Thumbnail size every resize benchmark targets
+static const cv::Size target_size{320, 240};
+
+/// @brief Deterministic photo-like image: smooth gradients plus fine texture
+///
+/// Flat or random images would compress unrealistically well or badly, this
+/// keeps encoded sizes close to what real photos produce.
+/// @param size image size
+/// @return BGR image
+static cv::Mat synthetic_image(const cv::Size &size)
+{
+    cv::Mat image(size, CV_8UC3);
+    std::uint32_t noise = 2463534242u;
+    for (int y = 0; y < image.rows; ++y)
+    {
+        uchar *row = image.ptr(y);
+        for (int x = 0; x < image.cols; ++x)
+        {
+            // xorshift32, a few levels of grain on top of the gradients
+            noise ^= noise << 13;
+            noise ^= noise >> 17;
+            noise ^= noise << 5;
+            int grain = static_cast<int>(noise & 15) - 8;
+
+            row[3 * x + 0] = cv::saturate_cast<uchar>(255 * x / image.cols + grain);
+            row[3 * x + 1] = cv::saturate_cast<uchar>(255 * y / image.rows + grain);
+            row[3 * x + 2] = cv::saturate_cast<uchar>(((x / 64 + y / 64) % 2) * 96 + 64 + grain);
+        }
+    }
+    return image;
+}
+
+/// @brief Synthetic source image, generated once per resolution
+static const cv::Mat &source_image(int size_index)
+{
+    static std::map<int, cv::Mat> images;
+    cv::Mat &image = images[size_index];
+    if (image.empty())
+        image = synthetic_image(source_sizes[size_index]);
+    return image;
+}
+
+/// @brief Encoded bytes of a synthetic source image, generated once per resolution and format
+static const std::string &encoded_image(int size_index, int format_index)
+{
+    static std::map<std::pair<int, int>, std::string> images;
+    std::string &encoded = images[std::make_pair(size_index, format_index)];
+    if (encoded.empty())
+    {
+        std::vector<uchar> buffer;
+        cv::imencode(format_exts[format_index], source_image(size_index), buffer);
+        encoded.assign(buffer.begin(), buffer.end());
+    }
+    return encoded;
+}
+
+/// @brief Base64 form of a synthetic source image, as sent in input_jpeg
+static const std::string &base64_image(int size_index, int format_index)
+{
+    static std::map<std::pair<int, int>, std::string> images;
+    std::string &encoded = images[std::make_pair(size_index, format_index)];
+    if (encoded.empty())
+        encoded = base64_encode(encoded_image(size_index, format_index));
+    return encoded;
+}
+
+static std::string label(int size_index, int format_index)
+{
+    return std::string(source_names[size_index]) + " " + format_names[format_index];
+}
+
+static void source_args(benchmark::internal::Benchmark *bench)
+{
+    for (int size_index = 0; size_index < 4; ++size_index)
+        for (int format_index = 0; format_index < 2; ++format_index)
+            bench->Args({size_index, format_index});
+}
+
+// Every source, without and with Metrics attached as the third argument
+static void metrics_args(benchmark::internal::Benchmark *bench)
+{
+    for (int size_index = 0; size_index < 4; ++size_index)
+        for (int format_index = 0; format_index < 2; ++format_index)
+            for (int with_metrics = 0; with_metrics < 2; ++with_metrics)
+                bench->Args({size_index, format_index, with_metrics});
+}
+
+static void BM_Base64Encode(benchmark::State &state)
+{
+    const std::string &raw = encoded_image(state.range(0), state.range(1));
+    std::string encoded(base64_encoded_length(raw.size()), '\0');
+
+    for (auto _ : state)
+    {
+        base64_encode(reinterpret_cast<const unsigned char *>(raw.data()), raw.size(), &encoded[0]);
+        benchmark::DoNotOptimize(encoded.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * raw.size());
+    state.SetLabel(label(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_Base64Encode)->Apply(source_args);
+
+static void BM_Base64Decode(benchmark::State &state)
+{
+    const std::string &encoded = base64_image(state.range(0), state.range(1));
+    std::vector<unsigned char> raw(base64_decoded_length(encoded.size()));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(base64_decode(encoded.data(), encoded.size(), raw.data()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * encoded.size());
+    state.SetLabel(label(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_Base64Decode)->Apply(source_args);
+
+static void BM_DecodeImage(benchmark::State &state)
+{
+    const std::string &raw = encoded_image(state.range(0), state.range(1));
+    cv::Mat data(1, static_cast<int>(raw.size()), CV_8UC1, const_cast<char *>(raw.data()));
+
+    for (auto _ : state)
+    {
+        cv::Mat image = cv::imdecode(data, cv::IMREAD_UNCHANGED);
+        benchmark::DoNotOptimize(image.data);
+    }
+
+    state.SetItemsProcessed(state.iterations() * source_sizes[state.range(0)].area());
+    state.SetLabel(label(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_DecodeImage)->Apply(source_args)->Unit(benchmark::kMillisecond);
+
+// Same images through the codec the resizer uses, TurboJPEG when built with it
+static void BM_CodecDecode(benchmark::State &state)
+{
+    const std::string &raw = encoded_image(state.range(0), state.range(1));
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(raw.data());
+    ImageCodec &codec = default_codec();
+    cv::Mat image;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(codec.decode(data, raw.size(), source_sizes[state.range(0)], image));
+    }
+
+    state.SetItemsProcessed(state.iterations() * source_sizes[state.range(0)].area());
+    state.SetLabel(label(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_CodecDecode)->Apply(source_args)->Unit(benchmark::kMillisecond);
+
+static void BM_Resize(benchmark::State &state)
+{
+    static const int flags[] = {cv::INTER_NEAREST, cv::INTER_LINEAR, cv::INTER_AREA, cv::INTER_CUBIC, cv::INTER_LANCZOS4};
+    static const char *names[] = {"nearest", "linear", "area", "cubic", "lanczos4"};
+
+    const cv::Mat &image = source_image(state.range(0));
+    cv::Mat resized;
+
+    for (auto _ : state)
+    {
+        cv::resize(image, resized, target_size, 0, 0, flags[state.range(1)]);
+        benchmark::DoNotOptimize(resized.data);
+    }
+
+    state.SetItemsProcessed(state.iterations() * image.total());
+    state.SetLabel(std::string(source_names[state.range(0)]) + " " + names[state.range(1)]);
+}
+BENCHMARK(BM_Resize)->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2, 3, 4}})->Unit(benchmark::kMicrosecond);
+
+// Same modes through resample_image, which reduces with cv::pyrDown first
+static void BM_ResampleImage(benchmark::State &state)
+{
+    static const Interpolation modes[] = {Interpolation::NEAREST, Interpolation::LINEAR, Interpolation::AREA,
+                                          Interpolation::CUBIC, Interpolation::LANCZOS, Interpolation::QUALITY};
+
+    const cv::Mat &image = source_image(state.range(0));
+    Interpolation interpolation = modes[state.range(1)];
+    cv::Mat resized;
+
+    for (auto _ : state)
+    {
+        resample_image(image, resized, target_size, interpolation);
+        benchmark::DoNotOptimize(resized.data);
+    }
+
+    state.SetItemsProcessed(state.iterations() * image.total());
+    state.SetLabel(std::string(source_names[state.range(0)]) + " " + interpolation_name(interpolation));
+}
+BENCHMARK(BM_ResampleImage)->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2, 3, 4, 5}})->Unit(benchmark::kMicrosecond);
+
+static void BM_EncodeImage(benchmark::State &state)
+{
+    const cv::Mat &image = source_image(state.range(0));
+    std::vector<uchar> buffer;
+
+    for (auto _ : state)
+    {
+        cv::imencode(format_exts[state.range(1)], image, buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * image.total());
+    state.SetLabel(label(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_EncodeImage)->Apply(source_args)->Unit(benchmark::kMillisecond);
+
+static void BM_CodecEncode(benchmark::State &state)
+{
+    static const OutputFormat formats[] = {OutputFormat::JPEG, OutputFormat::PNG};
+
+    const cv::Mat &image = source_image(state.range(0));
+    ImageCodec &codec = default_codec();
+    std::vector<uchar> buffer;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(codec.encode(image, formats[state.range(1)], -1, -1, buffer));
+    }
+
+    state.SetItemsProcessed(state.iterations() * image.total());
+    state.SetLabel(label(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_CodecEncode)->Apply(source_args)->Unit(benchmark::kMillisecond);
+
+// Second argument: number of bands, 1 is the serial encoder with the same restart markers
+static void BM_ParallelJpegEncode(benchmark::State &state)
+{
+    const cv::Mat &image = source_image(state.range(0));
+    std::vector<uchar> buffer;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(encode_jpeg_parallel(image, -1, state.range(1), buffer));
+    }
+
+    state.SetItemsProcessed(state.iterations() * image.total());
+    state.SetLabel(std::string(source_names[state.range(0)]) + " " + std::to_string(state.range(1)) + " bands");
+}
+BENCHMARK(BM_ParallelJpegEncode)->ArgsProduct({{1, 2, 3}, {1, 2, 4, 8}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Process(benchmark::State &state)
+{
+    const std::string &encoded = base64_image(state.range(0), state.range(1));
+    std::string request = "{\"input_jpeg\":\"" + encoded + "\",\"desired_width\":" + std::to_string(target_size.width) +
+                          ",\"desired_height\":" + std::to_string(target_size.height) + "}";
+
+    // No result cache, every iteration runs the whole pipeline
+    std::shared_ptr<Metrics> metrics = state.range(2) != 0 ? std::make_shared<Metrics>() : nullptr;
+    ImageResizer image_resizer(nullptr, metrics);
+    std::string response;
+
+    for (auto _ : state)
+    {
+        Error res = image_resizer.process(request, response);
+        if (!res.IsOk())
+        {
+            state.SkipWithError(res.AsString().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(response.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * request.size());
+    state.SetLabel(label(state.range(0), state.range(1)) + (metrics ? " metrics" : ""));
+}
+BENCHMARK(BM_Process)->Apply(metrics_args)->Unit(benchmark::kMillisecond);
+
+// Cost of one stage observation, range(0) 0 without Metrics attached
+static void BM_StageTimer(benchmark::State &state)
+{
+    Metrics metrics;
+    Metrics *attached = state.range(0) != 0 ? &metrics : nullptr;
+
+    for (auto _ : state)
+    {
+        StageTimer timer(attached, Stage::RESIZE);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetLabel(attached ? "metrics" : "detached");
+}
+BENCHMARK(BM_StageTimer)->Arg(0)->Arg(1);
+
+// Sustained throughput of many raw requests in flight at once, range(2) 0
+// runs them on the worker pool, 1 on the stage pipeline
+static void BM_Throughput(benchmark::State &state)
+{
+    const std::string &encoded = encoded_image(state.range(0), state.range(1));
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(encoded.data());
+    bool pipelined = state.range(2) != 0;
+    const std::size_t in_flight = 64;
+
+    ResizeOptions options;
+    options.sizes.assign(1, target_size);
+
+    auto image_resizer = std::make_shared<ImageResizer>(nullptr);
+    std::unique_ptr<WorkerPool> pool;
+    std::unique_ptr<ResizePipeline> pipeline;
+    if (pipelined)
+    {
+        PipelineOptions pipeline_options;
+        pipeline_options.queue_capacity = in_flight;
+        pipeline.reset(new ResizePipeline(image_resizer, pipeline_options));
+    }
+    else
+    {
+        pool.reset(new WorkerPool(0, in_flight));
+    }
+
+    std::vector<std::string> outputs(in_flight);
+    for (auto _ : state)
+    {
+        std::vector<std::promise<Error>> results(in_flight);
+        for (std::size_t i = 0; i < in_flight; ++i)
+        {
+            outputs[i].clear();
+            std::promise<Error> &result = results[i];
+            std::string &output = outputs[i];
+            bool queued;
+            if (pipelined)
+            {
+                queued = pipeline->try_submit([&](ImageResizer &resizer, ResizeJob &job)
+                                              {
+                                                  job.options = options;
+                                                  return resizer.decode_raw(data, encoded.size(), job); },
+                                              output, [&result](const Error &status)
+                                              { result.set_value(status); });
+            }
+            else
+            {
+                queued = pool->try_post([&]()
+                                        { result.set_value(image_resizer->process_raw(data, encoded.size(), options, output)); });
+            }
+            if (!queued)
+                result.set_value(Error(Error::Code::FAILED, "queue is full"));
+        }
+
+        // Every request is waited for, the results are still referenced until then
+        Error failure = Error::Success;
+        for (auto &result : results)
+        {
+            Error res = result.get_future().get();
+            if (!res.IsOk())
+                failure = res;
+        }
+        if (!failure.IsOk())
+        {
+            state.SkipWithError(failure.AsString().c_str());
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * in_flight);
+    state.SetLabel(label(state.range(0), state.range(1)) + (pipelined ? " pipeline" : " pool"));
+}
+BENCHMARK(BM_Throughput)->ArgsProduct({{0, 1, 2}, {0, 1}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
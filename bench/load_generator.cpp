@@ -0,0 +1,510 @@
+// HTTP load generator for /resize_image
+//
+// Starts image_resizer_app on localhost (unless --no-server is given) and
+// drives it with a weighted mix of synthetic requests, either closed-loop
+// (every client waits for its answer before sending the next request) or
+// open-loop (requests are sent at a fixed rate whatever the latency).
+// Open-loop latencies are measured from the scheduled send time, so a
+// saturated server shows up as growing latency instead of a lower rate.
+
+#include <libasyik/service.hpp>
+#include <libasyik/http.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include "image_resizer/base64.hpp"
+
+#ifndef IMAGE_RESIZER_APP_PATH
+#define IMAGE_RESIZER_APP_PATH "./image_resizer_app"
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+/// @brief Command line settings
+struct LoadConfig
+{
+    std::string server_path = IMAGE_RESIZER_APP_PATH;
+    bool start_server = true;
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    bool open_loop = false;
+    std::size_t concurrency = 16;
+    double rate = 100.0;
+    std::size_t threads = 1;
+    double duration = 30.0;
+    double warmup = 5.0;
+    std::string mix = "1920x1080:320x240:1";
+    std::string json_path;
+};
+
+/// @brief One kind of request of the mix
+struct RequestKind
+{
+    std::string body;
+    unsigned weight;
+};
+
+/// @brief Samples collected by one client thread
+struct LoadStats
+{
+    std::vector<double> latencies_us;
+    std::map<int, std::uint64_t> codes;
+    std::uint64_t failures = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_received = 0;
+
+    void merge(const LoadStats &other)
+    {
+        latencies_us.insert(latencies_us.end(), other.latencies_us.begin(), other.latencies_us.end());
+        for (const auto &code : other.codes)
+            codes[code.first] += code.second;
+        failures += other.failures;
+        dropped += other.dropped;
+        bytes_sent += other.bytes_sent;
+        bytes_received += other.bytes_received;
+    }
+};
+
+static void usage()
+{
+    std::cerr << "Usage: load_generator [options]\n"
+                 "  --server PATH       image_resizer_app to start (default " IMAGE_RESIZER_APP_PATH ")\n"
+                 "  --no-server         drive an already running server\n"
+                 "  --host HOST         server address (default 127.0.0.1)\n"
+                 "  --port PORT         server port (default 8080)\n"
+                 "  --mode closed|open  closed-loop clients or open-loop fixed rate (default closed)\n"
+                 "  --concurrency N     closed: clients, open: maximum requests in flight (default 16)\n"
+                 "  --rate R            open: requests per second (default 100)\n"
+                 "  --threads T         client threads, each with its own service (default 1)\n"
+                 "  --duration S        measured seconds (default 30)\n"
+                 "  --warmup S          seconds before measuring (default 5)\n"
+                 "  --mix SPEC          comma separated SRCWxSRCH:DSTWxDSTH:WEIGHT (default 1920x1080:320x240:1)\n"
+                 "  --json PATH         also write the report as json\n";
+}
+
+static bool parse_args(int argc, char **argv, LoadConfig &config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help")
+            return false;
+        if (arg == "--no-server")
+        {
+            config.start_server = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+
+        std::string value = argv[++i];
+        if (arg == "--server")
+            config.server_path = value;
+        else if (arg == "--host")
+            config.host = value;
+        else if (arg == "--port")
+            config.port = std::atoi(value.c_str());
+        else if (arg == "--mode" && (value == "closed" || value == "open"))
+            config.open_loop = value == "open";
+        else if (arg == "--concurrency")
+            config.concurrency = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--rate")
+            config.rate = std::atof(value.c_str());
+        else if (arg == "--threads")
+            config.threads = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--duration")
+            config.duration = std::atof(value.c_str());
+        else if (arg == "--warmup")
+            config.warmup = std::atof(value.c_str());
+        else if (arg == "--mix")
+            config.mix = value;
+        else if (arg == "--json")
+            config.json_path = value;
+        else
+            return false;
+    }
+
+    return config.port > 0 && config.concurrency > 0 && config.threads > 0 && config.rate > 0 && config.duration > 0;
+}
+
+/// @brief Deterministic photo-like JPEG, see bench-image-resizer.cpp
+static std::string synthetic_jpeg(const cv::Size &size)
+{
+    cv::Mat image(size, CV_8UC3);
+    std::uint32_t noise = 2463534242u;
+    for (int y = 0; y < image.rows; ++y)
+    {
+        uchar *row = image.ptr(y);
+        for (int x = 0; x < image.cols; ++x)
+        {
+            noise ^= noise << 13;
+            noise ^= noise >> 17;
+            noise ^= noise << 5;
+            int grain = static_cast<int>(noise & 15) - 8;
+
+            row[3 * x + 0] = cv::saturate_cast<uchar>(255 * x / image.cols + grain);
+            row[3 * x + 1] = cv::saturate_cast<uchar>(255 * y / image.rows + grain);
+            row[3 * x + 2] = cv::saturate_cast<uchar>(((x / 64 + y / 64) % 2) * 96 + 64 + grain);
+        }
+    }
+
+    std::vector<uchar> buffer;
+    cv::imencode(".jpg", image, buffer);
+    return std::string(buffer.begin(), buffer.end());
+}
+
+/// @brief Build the request bodies of a mix specification
+/// @param spec comma separated SRCWxSRCH:DSTWxDSTH:WEIGHT entries
+/// @param kinds one request per entry
+/// @return false if spec is malformed
+static bool parse_mix(const std::string &spec, std::vector<RequestKind> &kinds)
+{
+    std::stringstream entries(spec);
+    std::string entry;
+    while (std::getline(entries, entry, ','))
+    {
+        int src_width, src_height, dst_width, dst_height;
+        unsigned weight = 1;
+        int fields = std::sscanf(entry.c_str(), "%dx%d:%dx%d:%u", &src_width, &src_height, &dst_width, &dst_height, &weight);
+        if (fields < 4 || src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0 || weight == 0)
+            return false;
+
+        RequestKind kind;
+        kind.weight = weight;
+        kind.body = "{\"input_jpeg\":\"" + base64_encode(synthetic_jpeg(cv::Size(src_width, src_height))) +
+                    "\",\"desired_width\":" + std::to_string(dst_width) +
+                    ",\"desired_height\":" + std::to_string(dst_height) + "}";
+        kinds.push_back(kind);
+    }
+    return !kinds.empty();
+}
+
+/// @brief Weighted round robin over the request kinds, the same sequence in every run
+class RequestMix
+{
+public:
+    explicit RequestMix(const std::vector<RequestKind> &kinds)
+    {
+        for (std::size_t i = 0; i < kinds.size(); ++i)
+            for (unsigned w = 0; w < kinds[i].weight; ++w)
+                schedule_.push_back(i);
+    }
+
+    std::size_t next(std::size_t &cursor) const { return schedule_[cursor++ % schedule_.size()]; }
+
+private:
+    std::vector<std::size_t> schedule_;
+};
+
+/// @brief Send one request and record it if it completed after the warmup
+static void send_request(const asyik::service_ptr &as, const std::string &url, const RequestKind &kind,
+                         Clock::time_point start, Clock::time_point measure_from, LoadStats &stats)
+{
+    bool measured = start >= measure_from;
+    try
+    {
+        auto req = asyik::http_easy_request(as, "POST", url, kind.body, {{"Content-Type", "application/json"}});
+        if (!measured)
+            return;
+
+        double latency = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        stats.latencies_us.push_back(latency);
+        stats.codes[req->response.result()]++;
+        stats.bytes_sent += kind.body.size();
+        stats.bytes_received += req->response.body.size();
+    }
+    catch (const std::exception &err)
+    {
+        if (measured)
+            stats.failures++;
+    }
+}
+
+/// @brief Run the clients of one thread until the end of the test
+static void run_clients(const LoadConfig &config, const std::vector<RequestKind> &kinds, std::size_t thread_index,
+                        Clock::time_point measure_from, Clock::time_point stop_at, LoadStats &stats)
+{
+    auto as = asyik::make_service();
+    std::string url = "http://" + config.host + ":" + std::to_string(config.port) + "/resize_image";
+    RequestMix mix(kinds);
+
+    // Clients and rate are split between the threads
+    std::size_t clients = config.concurrency / config.threads + (thread_index < config.concurrency % config.threads ? 1 : 0);
+    auto in_flight = std::make_shared<std::size_t>(0);
+    auto finished = std::make_shared<std::size_t>(0);
+
+    if (!config.open_loop)
+    {
+        for (std::size_t c = 0; c < clients; ++c)
+        {
+            as->execute([&, c, finished]()
+                        {
+                            // Offset the cursors so clients do not send the same kind in lock step
+                            std::size_t cursor = c;
+                            while (Clock::now() < stop_at)
+                                send_request(as, url, kinds[mix.next(cursor)], Clock::now(), measure_from, stats);
+
+                            if (++*finished == clients)
+                                as->stop(); });
+        }
+        if (clients == 0)
+            return;
+    }
+    else
+    {
+        as->execute([&, in_flight]()
+                    {
+                        std::chrono::duration<double> interval(config.threads / config.rate);
+                        Clock::time_point next_send = Clock::now() + std::chrono::duration_cast<Clock::duration>(interval * thread_index / config.threads);
+                        std::size_t cursor = 0;
+
+                        while (next_send < stop_at)
+                        {
+                            // Millisecond sleeps, every request that fell due meanwhile is sent at once
+                            while (next_send <= Clock::now() && next_send < stop_at)
+                            {
+                                Clock::time_point scheduled = next_send;
+                                next_send += std::chrono::duration_cast<Clock::duration>(interval);
+
+                                if (*in_flight >= std::max<std::size_t>(clients, 1))
+                                {
+                                    if (scheduled >= measure_from)
+                                        stats.dropped++;
+                                    continue;
+                                }
+
+                                const RequestKind *kind = &kinds[mix.next(cursor)];
+                                ++*in_flight;
+                                as->execute([&, kind, scheduled, in_flight]()
+                                            {
+                                                send_request(as, url, *kind, scheduled, measure_from, stats);
+                                                --*in_flight; });
+                            }
+                            asyik::sleep_for(std::chrono::milliseconds(1));
+                        }
+
+                        while (*in_flight > 0)
+                            asyik::sleep_for(std::chrono::milliseconds(1));
+                        as->stop(); });
+    }
+
+    as->run();
+}
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    std::size_t index = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void report(const LoadConfig &config, LoadStats &stats)
+{
+    std::sort(stats.latencies_us.begin(), stats.latencies_us.end());
+    std::uint64_t completed = stats.latencies_us.size();
+    std::uint64_t ok = stats.codes.count(200) ? stats.codes[200] : 0;
+    double mean = 0.0;
+    for (double latency : stats.latencies_us)
+        mean += latency;
+    mean = completed ? mean / completed : 0.0;
+
+    const double quantiles[] = {0.5, 0.95, 0.99, 0.999};
+    const char *quantile_names[] = {"p50", "p95", "p99", "p999"};
+
+    std::printf("mode          %s, %zu %s, %zu thread(s)\n", config.open_loop ? "open" : "closed", config.concurrency,
+                config.open_loop ? "max in flight" : "clients", config.threads);
+    if (config.open_loop)
+        std::printf("target rate   %.1f req/s\n", config.rate);
+    std::printf("completed     %llu in %.1f s, %llu failed, %llu dropped\n", static_cast<unsigned long long>(completed),
+                config.duration, static_cast<unsigned long long>(stats.failures), static_cast<unsigned long long>(stats.dropped));
+    std::printf("throughput    %.1f req/s, %.1f ok/s, %.2f MB/s in, %.2f MB/s out\n", completed / config.duration, ok / config.duration,
+                stats.bytes_sent / config.duration / 1e6, stats.bytes_received / config.duration / 1e6);
+    for (const auto &code : stats.codes)
+        std::printf("status %-6d %llu\n", code.first, static_cast<unsigned long long>(code.second));
+    std::printf("latency (ms)  mean %.2f", mean / 1000.0);
+    for (int i = 0; i < 4; ++i)
+        std::printf(", %s %.2f", quantile_names[i], percentile(stats.latencies_us, quantiles[i]) / 1000.0);
+    std::printf(", max %.2f\n", stats.latencies_us.empty() ? 0.0 : stats.latencies_us.back() / 1000.0);
+
+    if (config.json_path.empty())
+        return;
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("mode");
+    writer.String(config.open_loop ? "open" : "closed");
+    writer.Key("concurrency");
+    writer.Uint64(config.concurrency);
+    writer.Key("rate");
+    writer.Double(config.open_loop ? config.rate : 0.0);
+    writer.Key("mix");
+    writer.String(config.mix.c_str());
+    writer.Key("duration_s");
+    writer.Double(config.duration);
+    writer.Key("completed");
+    writer.Uint64(completed);
+    writer.Key("failed");
+    writer.Uint64(stats.failures);
+    writer.Key("dropped");
+    writer.Uint64(stats.dropped);
+    writer.Key("throughput_rps");
+    writer.Double(completed / config.duration);
+    writer.Key("codes");
+    writer.StartObject();
+    for (const auto &code : stats.codes)
+    {
+        std::string key = std::to_string(code.first);
+        writer.Key(key.c_str());
+        writer.Uint64(code.second);
+    }
+    writer.EndObject();
+    writer.Key("latency_ms");
+    writer.StartObject();
+    writer.Key("mean");
+    writer.Double(mean / 1000.0);
+    for (int i = 0; i < 4; ++i)
+    {
+        writer.Key(quantile_names[i]);
+        writer.Double(percentile(stats.latencies_us, quantiles[i]) / 1000.0);
+    }
+    writer.Key("max");
+    writer.Double(stats.latencies_us.empty() ? 0.0 : stats.latencies_us.back() / 1000.0);
+    writer.EndObject();
+    writer.EndObject();
+
+    FILE *file = std::fopen(config.json_path.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::cerr << "Unable to write " << config.json_path << std::endl;
+        return;
+    }
+    std::fwrite(buffer.GetString(), 1, buffer.GetSize(), file);
+    std::fputc('\n', file);
+    std::fclose(file);
+}
+
+/// @brief Start the server as a child process listening on config.port
+/// @return Child pid, -1 on failure
+static pid_t start_server(const LoadConfig &config)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        setenv("IMAGE_RESIZER_PORT", std::to_string(config.port).c_str(), 1);
+        execl(config.server_path.c_str(), config.server_path.c_str(), static_cast<char *>(nullptr));
+        std::perror("execl");
+        _exit(127);
+    }
+    return pid;
+}
+
+/// @brief Wait until the server answers http requests
+static bool wait_for_server(const LoadConfig &config, double timeout_s)
+{
+    bool ready = false;
+    auto as = asyik::make_service();
+    std::string url = "http://" + config.host + ":" + std::to_string(config.port) + "/cache_stats";
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout_s));
+
+    as->execute([&]()
+                {
+                    while (!ready && Clock::now() < deadline)
+                    {
+                        try
+                        {
+                            auto req = asyik::http_easy_request(as, "GET", url, "", {});
+                            ready = req->response.result() == 200;
+                        }
+                        catch (const std::exception &err)
+                        {
+                            asyik::sleep_for(std::chrono::milliseconds(100));
+                        }
+                    }
+                    as->stop(); });
+    as->run();
+    return ready;
+}
+
+int main(int argc, char **argv)
+{
+    LoadConfig config;
+    if (!parse_args(argc, argv, config))
+    {
+        usage();
+        return 2;
+    }
+
+    std::vector<RequestKind> kinds;
+    if (!parse_mix(config.mix, kinds))
+    {
+        std::cerr << "Invalid --mix " << config.mix << std::endl;
+        return 2;
+    }
+
+    pid_t server = -1;
+    if (config.start_server)
+    {
+        server = start_server(config);
+        if (server < 0)
+        {
+            std::perror("fork");
+            return 1;
+        }
+    }
+
+    int status = 0;
+    if (!wait_for_server(config, 30.0))
+    {
+        std::cerr << "Server on port " << config.port << " did not become ready" << std::endl;
+        status = 1;
+    }
+    else
+    {
+        Clock::time_point measure_from = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.warmup));
+        Clock::time_point stop_at = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.duration));
+
+        std::vector<LoadStats> stats(config.threads);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < config.threads; ++t)
+        {
+            threads.emplace_back([&, t]()
+                                 { run_clients(config, kinds, t, measure_from, stop_at, stats[t]); });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        LoadStats total;
+        for (const LoadStats &thread_stats : stats)
+            total.merge(thread_stats);
+        report(config, total);
+    }
+
+    if (server > 0)
+    {
+        kill(server, SIGTERM);
+        waitpid(server, nullptr, 0);
+    }
+
+    return status;
+}
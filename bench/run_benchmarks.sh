@@ -0,0 +1,20 @@
+#!/bin/bash
+# Build and run the benchmark suite, results are written as JSON so that
+# releases can be compared, e.g. with benchmark's tools/compare.py:
+#   compare.py benchmarks before.json after.json
+set -e
+
+BUILD_DIR=${BUILD_DIR:-build-bench}
+OUTPUT=${1:-bench-$(git rev-parse --short HEAD 2>/dev/null || echo local).json}
+
+cmake -S "$(dirname "$0")/.." -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release -DBUILD_BENCHMARKS=ON
+cmake --build "$BUILD_DIR" --target bench_image_resizer -j"$(nproc)"
+
+"$BUILD_DIR"/bench/bench_image_resizer \
+    --benchmark_out="$OUTPUT" \
+    --benchmark_out_format=json \
+    --benchmark_repetitions=${REPETITIONS:-3} \
+    --benchmark_report_aggregates_only=true \
+    "${@:2}"
+
+echo "Results written to $OUTPUT"
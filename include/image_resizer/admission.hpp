@@ -0,0 +1,152 @@
+#ifndef ADMISSION_HPP
+#define ADMISSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "image_resizer/image_header.hpp"
+
+/// @brief Resources a request is expected to hold while it is processed
+struct RequestCost
+{
+    /// @brief Pixels decoded, resized and encoded, the proxy for CPU time
+    std::uint64_t pixels = 0;
+
+    /// @brief Peak memory in bytes
+    std::uint64_t bytes = 0;
+
+    RequestCost &operator+=(const RequestCost &other)
+    {
+        pixels += other.pixels;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+/// @brief Admit requests while their summed cost fits a CPU and a memory budget
+///
+/// A request over budget waits in a short FIFO until enough cost is
+/// released, or is rejected at once when the FIFO is full, so that overload
+/// turns into quick 503 answers instead of every request timing out. The
+/// FIFO is strict: a large request at its head holds back smaller ones
+/// behind it, which keeps large requests from starving.
+class AdmissionController
+{
+public:
+    /// @brief Outcome of acquire
+    enum class Result
+    {
+        ADMITTED,
+        QUEUED,
+        REJECTED,
+    };
+
+    /// @brief Counters describing the admission state
+    struct Stats
+    {
+        std::uint64_t admitted = 0;
+        std::uint64_t queued = 0;
+        std::uint64_t rejected = 0;
+        std::uint64_t timed_out = 0;
+        std::size_t waiting = 0;
+        std::uint64_t pixels_in_use = 0;
+        std::uint64_t bytes_in_use = 0;
+        std::uint64_t pixel_budget = 0;
+        std::uint64_t byte_budget = 0;
+    };
+
+    /// @brief Create a controller with nothing admitted
+    /// @param pixel_budget pixels processed at once, 0 for no CPU budget
+    /// @param byte_budget bytes held at once, 0 for no memory budget
+    /// @param max_waiting requests allowed to wait for budget, 0 to reject at once
+    /// @param stream_min_pixels sources the resizer streams, see ImageResizer, 0 for none
+    AdmissionController(std::uint64_t pixel_budget, std::uint64_t byte_budget, std::size_t max_waiting, std::size_t stream_min_pixels = 0);
+
+    AdmissionController(const AdmissionController &obj) = delete;
+    AdmissionController &operator=(const AdmissionController &obj) = delete;
+
+    /// @brief Estimate the cost of resizing an encoded image
+    ///
+    /// Dimensions come from the JPEG or PNG header when it is found, from the
+    /// payload size otherwise.
+    ///
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param output_pixels summed area of every target size
+    /// @return Estimated cost
+    RequestCost estimate(const unsigned char *data, std::size_t length, std::uint64_t output_pixels) const;
+
+    /// @brief Estimate the cost of resizing a base64 encoded image
+    /// @param encoded base64 characters
+    /// @param length number of characters
+    /// @param output_pixels summed area of every target size
+    /// @return Estimated cost, the decoded copy of the image included
+    RequestCost estimate_base64(const char *encoded, std::size_t length, std::uint64_t output_pixels) const;
+
+    /// @brief Charge a cost against the budgets
+    ///
+    /// A cost larger than a whole budget is charged as the budget, so that
+    /// such a request still runs, alone.
+    ///
+    /// @param cost estimated cost, pass it unchanged to release
+    /// @param on_admit called once the cost is charged, only when QUEUED is returned,
+    ///                 from the thread releasing budget and without any lock held
+    /// @param ticket identifies the waiting request for cancel, only set when QUEUED is returned
+    /// @return ADMITTED if charged at once, QUEUED if waiting for on_admit, REJECTED if the queue is full
+    Result acquire(const RequestCost &cost, std::function<void()> on_admit, std::uint64_t &ticket);
+
+    /// @brief Give up waiting, e.g. once the caller timed out
+    /// @param ticket set by acquire
+    /// @return false if the request was admitted meanwhile, it must then be released
+    bool cancel(std::uint64_t ticket);
+
+    /// @brief Return the cost of a finished request and admit waiting ones that fit
+    /// @param cost cost passed to acquire
+    void release(const RequestCost &cost);
+
+    /// @brief Snapshot of the counters
+    Stats stats() const;
+
+    bool enabled() const { return pixel_budget_ > 0 || byte_budget_ > 0; }
+
+private:
+    struct Waiter
+    {
+        std::uint64_t ticket;
+        RequestCost cost;
+        std::function<void()> on_admit;
+    };
+
+    RequestCost estimate(const ImageHeader *header, std::uint64_t encoded_bytes, std::uint64_t output_pixels) const;
+
+    /// @brief Cost limited to the budgets
+    RequestCost clamp(const RequestCost &cost) const;
+
+    /// @brief Whether a clamped cost fits the unused budget, mutex_ held
+    bool fits(const RequestCost &cost) const;
+
+    /// @brief Charge waiting requests from the head of the queue while they fit, mutex_ held
+    /// @param admitted on_admit of every charged request, to call once mutex_ is released
+    void admit_waiting(std::vector<std::function<void()>> &admitted);
+
+    const std::uint64_t pixel_budget_;
+    const std::uint64_t byte_budget_;
+    const std::size_t max_waiting_;
+    const std::size_t stream_min_pixels_;
+
+    std::uint64_t pixels_in_use_ = 0;
+    std::uint64_t bytes_in_use_ = 0;
+    std::uint64_t next_ticket_ = 1;
+    std::uint64_t admitted_ = 0;
+    std::uint64_t queued_ = 0;
+    std::uint64_t rejected_ = 0;
+    std::uint64_t timed_out_ = 0;
+    std::deque<Waiter> waiting_;
+
+    mutable std::mutex mutex_;
+};
+
+#endif
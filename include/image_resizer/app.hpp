@@ -0,0 +1,672 @@
+#ifndef APP_HPP
+#define APP_HPP
+
+#include <boost/fiber/future.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <tuple>
+#include <vector>
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include "image_resizer/admission.hpp"
+#include "image_resizer/config.hpp"
+#include "image_resizer/error.hpp"
+#include "image_resizer/form_data.hpp"
+#include "image_resizer/image_resizer.hpp"
+#include "image_resizer/metrics.hpp"
+#include "image_resizer/output_format.hpp"
+#include "image_resizer/request_arena.hpp"
+#include "image_resizer/resize_pipeline.hpp"
+#include "image_resizer/result_cache.hpp"
+#include "image_resizer/worker_pool.hpp"
+
+/// @brief Helper variable to store error code and reasoning
+typedef std::tuple<uint16_t, std::string> HTTP_CODE;
+
+uint16_t getCode(const HTTP_CODE &code);
+std::string getReason(const HTTP_CODE &code);
+
+/// @brief Append code and message members to a serialized json object
+/// @param body json object, e.g. response body written by ImageResizer
+/// @param code response code
+/// @param message response message
+void append_status(std::string &body, uint16_t code, const char *message);
+
+/// @brief Serialize a json object holding only code and message members
+/// @param code response code
+/// @param message error message
+/// @return Serialized json object
+std::string error_json(uint16_t code, const std::string &message);
+
+/// @brief Queue a function on the worker pool
+/// @param pool worker pool to run func on
+/// @param func CPU bound work, must stay valid until the future is ready
+/// @param cost estimated pixels processed by func, cheaper work runs first
+/// @return Future of the status returned by func, invalid if the worker queue is full
+boost::fibers::future<Error> post_to_worker(WorkerPool &pool, std::function<Error()> func, std::uint64_t cost = 0);
+
+/// @brief Validate the fields of a single resize request
+/// @param doc json object of the request
+/// @return HTTP_CODE code error and reasing
+HTTP_CODE validate_fields(const rapidjson::Value &doc);
+
+/// @brief Parse a positive integer parameter, at most ResizeOptions::max_dimension
+/// @param str parameter value
+/// @param value parsed integer
+/// @return false if str is not an integer in that range
+bool parse_dimension(const std::string &str, int &value);
+
+/// @brief State shared by every HTTP shard
+struct AppContext
+{
+    AppConfig config;
+    // Requests run either on the worker pool or on the stage pipeline, the other one is null
+    std::shared_ptr<WorkerPool> worker_pool;
+    std::shared_ptr<ResizePipeline> pipeline;
+    std::shared_ptr<ResultCache> result_cache;
+    std::shared_ptr<Metrics> metrics;
+    std::shared_ptr<ImageResizer> image_resizer;
+    std::shared_ptr<AdmissionController> admission;
+};
+
+/// @brief Create the resizer, the worker pool or the stage pipeline, the cache and the admission controller
+/// @param config application settings
+/// @return State shared by every HTTP shard
+std::shared_ptr<AppContext> make_app_context(const AppConfig &config);
+
+/// @brief Queue a request on the stage pipeline or the worker pool
+/// @param ctx shared application state
+/// @param decode decode stage of the request, the resize and encode stages follow
+/// @param output response is appended here, must stay valid until the future is ready
+/// @param cost estimated pixels processed, cheaper requests run first on the worker pool
+/// @return Future of the status of the request, invalid if the queue is full
+boost::fibers::future<Error> post_request(const AppContext &ctx, ResizePipeline::DecodeFunction decode, std::string &output, std::uint64_t cost);
+
+/// @brief Process a request on the stage pipeline or the worker pool while the calling fiber waits
+/// @param ctx shared application state
+/// @param decode decode stage of the request, the resize and encode stages follow
+/// @param output response is appended here
+/// @param cost estimated pixels processed, cheaper requests run first on the worker pool
+/// @param result status of the request
+/// @return false if the queue is full and the request was not processed
+bool run_request(const AppContext &ctx, ResizePipeline::DecodeFunction decode, std::string &output, std::uint64_t cost, Error &result);
+
+/// @brief Summed area of the target sizes of a single resize request
+/// @param doc json object of the request, validated by validate_fields
+/// @return Output pixels, invalid sizes count as none since parse_options refuses them
+std::uint64_t requested_pixels(const rapidjson::Value &doc);
+
+/// @brief Cost of a single resize request, from the header of its base64 image
+/// @param ctx shared application state
+/// @param doc json object of the request, validated by validate_fields
+/// @return Estimated cost
+RequestCost estimate_cost(const AppContext &ctx, const rapidjson::Value &doc);
+
+/// @brief Charge a request against the admission budgets, waiting briefly while they are spent
+///
+/// Only the calling fiber waits, other connections keep being served.
+///
+/// @param ctx shared application state
+/// @param cost estimated cost of the request, released by AdmissionRelease
+/// @return false if the request must be shed
+bool admit(const AppContext &ctx, const RequestCost &cost);
+
+/// @brief Return the cost of an admitted request when leaving the handler
+struct AdmissionRelease
+{
+    AdmissionController &admission;
+    RequestCost cost;
+
+    ~AdmissionRelease() { admission.release(cost); }
+};
+
+/// @brief Append the result cache counters in Prometheus text format
+/// @param output e.g. the body of a /metrics response
+/// @param stats cache counters
+void append_cache_metrics(std::string &output, const ResultCache::Stats &stats);
+
+/// @brief Append the admission counters in Prometheus text format
+/// @param output e.g. the body of a /metrics response
+/// @param stats admission counters
+void append_admission_metrics(std::string &output, const AdmissionController::Stats &stats);
+
+/// @brief Append the occupancy of the pipeline stages in Prometheus text format
+/// @param output e.g. the body of a /metrics response
+/// @param stats occupancy of every stage
+void append_pipeline_metrics(std::string &output, const std::vector<ResizePipeline::StageStats> &stats);
+
+/// @brief Parse the json body of an incoming request
+/// @param req_ptr ptr to http_request_ptr, its body is modified and must outlive doc
+/// @param doc document to store data in json format
+/// @return HTTP_CODE code error and reasing
+HTTP_CODE parse_requests(const auto &req_ptr, RequestDocument &doc)
+{
+    if (req_ptr->headers["Content-Type"] != "application/json")
+    {
+        return std::make_tuple(415, "Content-Type error: payload must be defined as application/json");
+    }
+
+    // Parsed in place: strings, input_jpeg included, stay views into the body
+    // instead of being copied into the document, which decodes them directly
+    if (doc.ParseInsitu(&req_ptr->body[0]).HasParseError())
+    {
+        std::stringstream err;
+        err << "JSON parse error: " << doc.GetParseError() << " - " << rapidjson::GetParseError_En(doc.GetParseError());
+        return std::make_tuple(422, err.str());
+    }
+
+    return std::make_tuple(200, "");
+}
+
+/// @brief Validate incoming data request
+/// @param req_ptr ptr to http_request_ptr
+/// @param doc document to store data in json format
+/// @return HTTP_CODE code error and reasing
+HTTP_CODE validate_requests(const auto &req_ptr, RequestDocument &doc)
+{
+    HTTP_CODE code = parse_requests(req_ptr, doc);
+    if (getCode(code) != 200)
+    {
+        return code;
+    }
+
+    return validate_fields(doc);
+}
+
+/// @brief Validate incoming batch request
+/// @param req_ptr ptr to http_request_ptr
+/// @param doc document to store data in json format
+/// @return HTTP_CODE code error and reasing
+HTTP_CODE validate_batch_requests(const auto &req_ptr, RequestDocument &doc)
+{
+    HTTP_CODE code = parse_requests(req_ptr, doc);
+    if (getCode(code) != 200)
+    {
+        return code;
+    }
+
+    if (!doc.IsObject() || !doc.HasMember("items"))
+    {
+        return std::make_tuple(400, "items is not available in data.");
+    }
+    else if (!doc["items"].IsArray() || doc["items"].Empty())
+    {
+        return std::make_tuple(400, "items must be a non-empty array.");
+    }
+
+    return std::make_tuple(200, "");
+}
+
+/// @brief Read a parameter of a raw upload from a form field, an X- header or the query string
+/// @param req_ptr ptr to http_request_ptr
+/// @param parts multipart form parts, empty for octet-stream bodies
+/// @param name form field and query parameter name
+/// @param header header name
+/// @param value parameter value
+/// @return false if the parameter is missing
+bool raw_parameter(const auto &req_ptr, const std::vector<FormPart> &parts, const std::string &name, const std::string &header, std::string &value)
+{
+    for (const FormPart &part : parts)
+    {
+        if (part.name == name && part.filename.empty())
+        {
+            value.assign(part.data, part.length);
+            return true;
+        }
+    }
+
+    value = std::string(req_ptr->headers[header]);
+    if (!value.empty())
+        return true;
+
+    return query_parameter(std::string(req_ptr->target()), name, value);
+}
+
+/// @brief Validate a raw upload and read its image and parameters
+/// @param req_ptr ptr to http_request_ptr
+/// @param data encoded image, a view into the request body
+/// @param length image size
+/// @param options resize parameters
+/// @return HTTP_CODE code error and reasing
+HTTP_CODE parse_raw_requests(const auto &req_ptr, const char *&data, std::size_t &length, ResizeOptions &options)
+{
+    const std::string content_type(req_ptr->headers["Content-Type"]);
+    std::vector<FormPart> parts;
+
+    if (content_type.compare(0, 24, "application/octet-stream") == 0)
+    {
+        data = req_ptr->body.data();
+        length = req_ptr->body.size();
+    }
+    else if (content_type.compare(0, 19, "multipart/form-data") == 0)
+    {
+        if (!parse_multipart(content_type, req_ptr->body.data(), req_ptr->body.size(), parts))
+        {
+            return std::make_tuple(400, "multipart/form-data body is malformed.");
+        }
+
+        auto image = std::find_if(parts.begin(), parts.end(), [](const FormPart &part)
+                                  { return part.name == "image"; });
+        if (image == parts.end())
+        {
+            return std::make_tuple(400, "image is not available in data.");
+        }
+        data = image->data;
+        length = image->length;
+    }
+    else
+    {
+        return std::make_tuple(415, "Content-Type error: payload must be defined as application/octet-stream or multipart/form-data");
+    }
+
+    if (length == 0)
+    {
+        return std::make_tuple(400, "image data is empty.");
+    }
+
+    std::string width, height, interpolation;
+    if (!raw_parameter(req_ptr, parts, "desired_width", "X-Desired-Width", width))
+    {
+        return std::make_tuple(400, "desired_width is not available in data.");
+    }
+    else if (!raw_parameter(req_ptr, parts, "desired_height", "X-Desired-Height", height))
+    {
+        return std::make_tuple(400, "desired_height is not available in data.");
+    }
+
+    cv::Size size;
+    if (!parse_dimension(width, size.width) || !parse_dimension(height, size.height))
+    {
+        return std::make_tuple(400, "desired_width and desired_height must be integers between 1 and 65500.");
+    }
+    options.sizes.assign(1, size);
+
+    if (raw_parameter(req_ptr, parts, "interpolation", "X-Interpolation", interpolation) &&
+        !parse_interpolation(interpolation, options.interpolation))
+    {
+        return std::make_tuple(400, "interpolation must be one of nearest, linear, area, cubic, lanczos, fast, balanced or quality.");
+    }
+
+    // An explicit output_format overrides the one negotiated from Accept
+    std::string format, quality, effort;
+    negotiate_output_format(std::string(req_ptr->headers["Accept"]), options.format);
+    if (raw_parameter(req_ptr, parts, "output_format", "X-Output-Format", format) &&
+        !parse_output_format(format, options.format))
+    {
+        return std::make_tuple(400, "output_format must be one of jpeg, png, webp or avif.");
+    }
+
+    if (raw_parameter(req_ptr, parts, "quality", "X-Quality", quality) &&
+        (!parse_dimension(quality, options.quality) || options.quality > 100))
+    {
+        return std::make_tuple(400, "quality must be an integer between 1 and 100.");
+    }
+
+    if (raw_parameter(req_ptr, parts, "effort", "X-Effort", effort))
+    {
+        if (effort.size() != 1 || effort[0] < '0' || effort[0] > '9')
+        {
+            return std::make_tuple(400, "effort must be an integer between 0 and 9.");
+        }
+        options.effort = effort[0] - '0';
+    }
+
+    return std::make_tuple(200, "");
+}
+
+/// @brief Answer 503 with a Retry-After header
+/// @param req_ptr ptr to http_request_ptr
+/// @param ctx shared application state
+void respond_busy(const auto &req_ptr, const AppContext &ctx)
+{
+    req_ptr->response.headers.set("Content-Type", "application/json");
+    req_ptr->response.headers.set("Retry-After", std::to_string(ctx.config.retry_after_seconds));
+    req_ptr->response.body = error_json(503, "Server is busy, try again later.");
+    req_ptr->response.result(503);
+}
+
+/// @brief Wrap a request handler to count it and time it as a whole
+/// @param ctx shared application state
+/// @param handler endpoint handler
+/// @return Handler updating the request metrics around the call of handler
+template <typename Handler>
+auto instrument(const std::shared_ptr<AppContext> &ctx, Handler handler)
+{
+    return [ctx, handler](auto req, auto args)
+    {
+        Metrics &metrics = *ctx->metrics;
+        metrics.add_in_flight(1);
+        try
+        {
+            StageTimer timer(&metrics, Stage::REQUEST);
+            handler(req, args);
+        }
+        catch (...)
+        {
+            metrics.add_in_flight(-1);
+            throw;
+        }
+        metrics.add_in_flight(-1);
+        metrics.count_request(static_cast<uint16_t>(req->response.result()), req->body.size(), req->response.body.size());
+    };
+}
+
+/// @brief Register every endpoint of the application on a server
+/// @param server http server of one shard
+/// @param ctx shared application state
+template <typename Server>
+void register_routes(Server &server, const std::shared_ptr<AppContext> &ctx)
+{
+    server->set_request_body_limit(10485760); // 10MB
+
+    // accept string argument
+    server->on_http_request("/resize_image", "POST", instrument(ctx, [ctx](auto req, auto args)
+                            {
+                            HTTP_CODE val_code;
+                            RequestArena arena;
+                            RequestDocument &payload_data = arena.document();
+
+                            req->response.headers.set("Content-Type", "application/json");
+
+                            {
+                              StageTimer timer(ctx->metrics.get(), Stage::PARSE);
+                              val_code = validate_requests(req, payload_data);
+                            }
+                            if (getCode(val_code) != 200)
+                            {
+                              req->response.body = error_json(getCode(val_code), getReason(val_code));
+                              req->response.result(getCode(val_code));
+                            }
+                            else
+                            {
+                              // Encoded image goes straight into the outgoing body
+                              Error proc_code;
+                              // Formats listed in Accept replace the JPEG default unless the request names one
+                              OutputFormat preferred_format = OutputFormat::JPEG;
+                              negotiate_output_format(std::string(req->headers["Accept"]), preferred_format);
+                              req->response.headers.set("Vary", "Accept");
+
+                              // Cached responses cost nothing, they are neither admitted nor queued
+                              ResizeJob probe;
+                              req->response.body.clear();
+                              if (ctx->image_resizer->lookup(payload_data, probe, preferred_format, req->response.body)) {
+                                append_status(req->response.body, 200, "success");
+                                req->response.result(200);
+                                return;
+                              }
+
+                              RequestCost cost = estimate_cost(*ctx, payload_data);
+                              if (!admit(*ctx, cost)) {
+                                respond_busy(req, *ctx);
+                                return;
+                              }
+                              AdmissionRelease release{*ctx->admission, cost};
+
+                              bool accepted = run_request(*ctx, [&](ImageResizer &resizer, ResizeJob &job)
+                                                          {
+                                                            job.key = probe.key;
+                                                            job.cache_checked = probe.cache_checked;
+                                                            return resizer.decode(payload_data, job, preferred_format); },
+                                                          req->response.body, cost.pixels, proc_code);
+
+                              if (!accepted) {
+                                respond_busy(req, *ctx);
+                              }
+                              else if (proc_code.IsOk()) {
+                                append_status(req->response.body, 200, "success");
+                                req->response.result(200);
+                              }
+                              else {
+                                req->response.body = error_json(500, proc_code.AsString());
+                                req->response.result(500);
+                              }
+                            } }));
+
+    // Every item is resized in parallel on the worker pool, results keep the
+    // order of the items and carry their own status
+    server->on_http_request("/resize_batch", "POST", instrument(ctx, [ctx](auto req, auto args)
+                            {
+                            HTTP_CODE val_code;
+                            RequestArena arena;
+                            RequestDocument &payload_data = arena.document();
+
+                            req->response.headers.set("Content-Type", "application/json");
+
+                            {
+                              StageTimer timer(ctx->metrics.get(), Stage::PARSE);
+                              val_code = validate_batch_requests(req, payload_data);
+                            }
+                            if (getCode(val_code) != 200)
+                            {
+                              req->response.body = error_json(getCode(val_code), getReason(val_code));
+                              req->response.result(getCode(val_code));
+                              return;
+                            }
+
+                            OutputFormat preferred_format = OutputFormat::JPEG;
+                            negotiate_output_format(std::string(req->headers["Accept"]), preferred_format);
+                            req->response.headers.set("Vary", "Accept");
+
+                            const rapidjson::Value &items = payload_data["items"];
+                            std::vector<HTTP_CODE> item_codes(items.Size());
+                            std::vector<std::string> outputs(items.Size());
+                            std::vector<boost::fibers::future<Error>> results(items.Size());
+                            std::vector<Error> statuses(items.Size());
+                            std::vector<char> finished(items.Size(), 0);
+                            std::vector<ResizeJob> probes(items.Size());
+
+                            // The batch is admitted as a whole, charged the cost of its valid
+                            // items the response cache does not answer
+                            RequestCost cost;
+                            std::vector<RequestCost> item_costs(items.Size());
+                            for (rapidjson::SizeType i = 0; i < items.Size(); ++i)
+                            {
+                              item_codes[i] = validate_fields(items[i]);
+                              if (getCode(item_codes[i]) != 200)
+                                continue;
+
+                              if (ctx->image_resizer->lookup(items[i], probes[i], preferred_format, outputs[i]))
+                              {
+                                statuses[i] = Error::Success;
+                                finished[i] = 1;
+                                continue;
+                              }
+                              item_costs[i] = estimate_cost(*ctx, items[i]);
+                              cost += item_costs[i];
+                            }
+                            if (!admit(*ctx, cost))
+                            {
+                              respond_busy(req, *ctx);
+                              return;
+                            }
+                            AdmissionRelease release{*ctx->admission, cost};
+
+                            // Items are queued while there is room, then one more every time
+                            // one of them finishes, so a batch larger than the free queue
+                            // slots is not refused. Only a batch of which no item can be
+                            // answered from the cache or queued at all is busy.
+                            std::deque<rapidjson::SizeType> in_flight;
+                            bool answered_any = std::find(finished.begin(), finished.end(), 1) != finished.end();
+                            for (rapidjson::SizeType i = 0; i < items.Size(); ++i)
+                            {
+                              if (getCode(item_codes[i]) != 200 || finished[i])
+                                continue;
+
+                              while (true)
+                              {
+                                results[i] = post_request(*ctx, [&items, &probes, i, preferred_format](ImageResizer &resizer, ResizeJob &job)
+                                                          {
+                                                            job.key = probes[i].key;
+                                                            job.cache_checked = probes[i].cache_checked;
+                                                            return resizer.decode(items[i], job, preferred_format); },
+                                                          outputs[i], item_costs[i].pixels);
+                                if (results[i].valid())
+                                {
+                                  in_flight.push_back(i);
+                                  answered_any = true;
+                                  break;
+                                }
+                                if (in_flight.empty())
+                                  break;
+
+                                rapidjson::SizeType oldest = in_flight.front();
+                                in_flight.pop_front();
+                                statuses[oldest] = results[oldest].get();
+                                finished[oldest] = 1;
+                              }
+
+                              if (!answered_any)
+                              {
+                                respond_busy(req, *ctx);
+                                return;
+                              }
+                            }
+
+                            std::string &body = req->response.body;
+                            body.assign("{\"results\":[");
+                            for (rapidjson::SizeType i = 0; i < items.Size(); ++i)
+                            {
+                              if (i > 0)
+                                body.push_back(',');
+
+                              if (getCode(item_codes[i]) != 200)
+                              {
+                                body.append(error_json(getCode(item_codes[i]), getReason(item_codes[i])));
+                              }
+                              else if (!finished[i] && !results[i].valid())
+                              {
+                                body.append(error_json(503, "Server is busy, try again later."));
+                              }
+                              else
+                              {
+                                Error proc_code = finished[i] ? statuses[i] : results[i].get();
+                                if (proc_code.IsOk())
+                                {
+                                  append_status(outputs[i], 200, "success");
+                                  body.append(outputs[i]);
+                                }
+                                else
+                                {
+                                  body.append(error_json(500, proc_code.AsString()));
+                                }
+                                std::string().swap(outputs[i]);
+                              }
+                            }
+                            body.append("]}");
+                            append_status(body, 200, "success");
+                            req->response.result(200); }));
+
+    // Raw image bytes in and out, no base64 nor json on the hot path
+    server->on_http_request("/resize_raw", "POST", instrument(ctx, [ctx](auto req, auto args)
+                            {
+                            HTTP_CODE val_code;
+                            const char *data = nullptr;
+                            std::size_t length = 0;
+                            ResizeOptions options;
+
+                            {
+                              StageTimer timer(ctx->metrics.get(), Stage::PARSE);
+                              val_code = parse_raw_requests(req, data, length, options);
+                            }
+                            if (getCode(val_code) != 200)
+                            {
+                              req->response.headers.set("Content-Type", "application/json");
+                              req->response.body = error_json(getCode(val_code), getReason(val_code));
+                              req->response.result(getCode(val_code));
+                              return;
+                            }
+
+                            // Cached responses cost nothing, they are neither admitted nor queued
+                            ResizeJob probe;
+                            probe.options = options;
+                            req->response.body.clear();
+                            if (ctx->image_resizer->lookup_raw(reinterpret_cast<const unsigned char *>(data), length, probe, req->response.body))
+                            {
+                              req->response.headers.set("Content-Type", output_format_mime(options.format));
+                              req->response.headers.set("Vary", "Accept");
+                              req->response.result(200);
+                              return;
+                            }
+
+                            std::uint64_t output_pixels = static_cast<std::uint64_t>(options.sizes[0].width) * options.sizes[0].height;
+                            RequestCost cost = ctx->admission->estimate(reinterpret_cast<const unsigned char *>(data), length, output_pixels);
+                            if (!admit(*ctx, cost))
+                            {
+                              respond_busy(req, *ctx);
+                              return;
+                            }
+                            AdmissionRelease release{*ctx->admission, cost};
+
+                            Error proc_code;
+                            bool accepted = run_request(*ctx, [&](ImageResizer &resizer, ResizeJob &job)
+                                                        {
+                                                          job.options = options;
+                                                          job.key = probe.key;
+                                                          job.cache_checked = probe.cache_checked;
+                                                          return resizer.decode_raw(reinterpret_cast<const unsigned char *>(data), length, job); },
+                                                        req->response.body, cost.pixels, proc_code);
+
+                            if (!accepted)
+                            {
+                              respond_busy(req, *ctx);
+                            }
+                            else if (proc_code.IsOk())
+                            {
+                              req->response.headers.set("Content-Type", output_format_mime(options.format));
+                              req->response.headers.set("Vary", "Accept");
+                              req->response.result(200);
+                            }
+                            else
+                            {
+                              req->response.headers.set("Content-Type", "application/json");
+                              req->response.body = error_json(500, proc_code.AsString());
+                              req->response.result(500);
+                            } }));
+
+    server->on_http_request("/cache_stats", "GET", [ctx](auto req, auto args)
+                            {
+                            ResultCache::Stats stats = ctx->result_cache->stats();
+                            rapidjson::StringBuffer buffer;
+                            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                            writer.StartObject();
+                            writer.Key("hits");
+                            writer.Uint64(stats.hits);
+                            writer.Key("misses");
+                            writer.Uint64(stats.misses);
+                            writer.Key("evictions");
+                            writer.Uint64(stats.evictions);
+                            writer.Key("entries");
+                            writer.Uint64(stats.entries);
+                            writer.Key("bytes");
+                            writer.Uint64(stats.bytes);
+                            writer.Key("capacity_bytes");
+                            writer.Uint64(stats.capacity_bytes);
+                            writer.EndObject();
+
+                            req->response.headers.set("Content-Type", "application/json");
+                            req->response.body.assign(buffer.GetString(), buffer.GetSize());
+                            req->response.result(200); });
+
+    server->on_http_request("/metrics", "GET", [ctx](auto req, auto args)
+                            {
+                            std::string &body = req->response.body;
+                            body.clear();
+                            ctx->metrics->render(body);
+                            append_cache_metrics(body, ctx->result_cache->stats());
+                            append_admission_metrics(body, ctx->admission->stats());
+                            if (ctx->pipeline)
+                              append_pipeline_metrics(body, ctx->pipeline->stats());
+
+                            req->response.headers.set("Content-Type", "text/plain; version=0.0.4");
+                            req->response.result(200); });
+}
+
+#endif
@@ -1,10 +1,13 @@
 // Base64 string decoder
 // Source: https://stackoverflow.com/a/13935718
 // Source: http://www.sunshine2k.de/articles/coding/base64/understanding_base64.html
+// Source: http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+// Source: http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
 
 #ifndef BASE64_HPP
 #define BASE64_HPP
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -18,4 +21,29 @@ std::string base64_decode(std::string const &encoded_string);
 /// @return Encoded string data
 std::string base64_encode(std::string const &s);
 
-#endif
\ No newline at end of file
+/// @brief Number of characters produced by encoding `length` bytes
+/// @param length raw data length
+/// @return Encoded length including padding
+std::size_t base64_encoded_length(std::size_t length);
+
+/// @brief Upper bound of bytes produced by decoding `length` characters
+/// @param length encoded data length
+/// @return Maximum decoded length
+std::size_t base64_decoded_length(std::size_t length);
+
+/// @brief Encode raw bytes into a caller-provided buffer
+/// @param bytes data to encode
+/// @param length number of bytes to encode
+/// @param out output buffer, at least base64_encoded_length(length) bytes
+/// @return Number of characters written
+std::size_t base64_encode(const unsigned char *bytes, std::size_t length, char *out);
+
+/// @brief Decode base64 characters into a caller-provided buffer
+/// @param encoded characters to decode
+/// @param length number of characters to decode
+/// @param out output buffer, at least base64_decoded_length(length) bytes
+/// @return Number of bytes written
+/// @throw std::runtime_error if input is not valid base64-encoded data
+std::size_t base64_decode(const char *encoded, std::size_t length, unsigned char *out);
+
+#endif
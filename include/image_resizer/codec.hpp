@@ -0,0 +1,89 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <cstddef>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "image_resizer/output_format.hpp"
+#include "image_resizer/yuv_image.hpp"
+
+/// @brief Decoder and encoder of compressed images
+///
+/// Implementations are shared by every worker thread, any state they keep
+/// must be per thread.
+class ImageCodec
+{
+public:
+    virtual ~ImageCodec() {}
+
+    /// @brief Decode an image into a caller-provided cv::Mat
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param target_size size the image is resized to, lets JPEG decode at a reduced scale
+    /// @param image decoded image, its buffer is reused when size and type already match
+    /// @return false if data is not an image
+    virtual bool decode(const unsigned char *data, std::size_t length, const cv::Size &target_size, cv::Mat &image) = 0;
+
+    /// @brief Encode an image
+    /// @param image image to encode
+    /// @param format output format
+    /// @param quality 1 to 100, -1 for the encoder default
+    /// @param effort 0 to 9, -1 for the encoder default
+    /// @param buffer encoded bytes, replaces the previous content
+    /// @return false if the image could not be encoded
+    virtual bool encode(const cv::Mat &image, OutputFormat format, int quality, int effort, std::vector<uchar> &buffer) = 0;
+
+    /// @brief Whether encode_yuv can produce an output with these settings
+    /// @param format output format
+    /// @param effort 0 to 9, -1 for the encoder default
+    virtual bool yuv_supported(OutputFormat /*format*/, int /*effort*/) const { return false; }
+
+    /// @brief Decode a JPEG into its Y, Cb and Cr planes, skipping the conversion to BGR
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param target_size size the image is resized to, lets JPEG decode at a reduced scale
+    /// @param image decoded planes, their buffers are reused when sizes already match
+    /// @return false if data is not a YCbCr or grayscale JPEG, or planes are not supported
+    virtual bool decode_yuv(const unsigned char * /*data*/, std::size_t /*length*/, const cv::Size & /*target_size*/, YuvImage & /*image*/) { return false; }
+
+    /// @brief Encode Y, Cb and Cr planes into a JPEG keeping their chroma subsampling
+    /// @param image planes to encode
+    /// @param quality 1 to 100, -1 for the encoder default
+    /// @param buffer encoded bytes, replaces the previous content
+    /// @return false if the image could not be encoded
+    virtual bool encode_yuv(const YuvImage & /*image*/, int /*quality*/, std::vector<uchar> & /*buffer*/) { return false; }
+};
+
+/// @brief Every format OpenCV was built with, through cv::imdecode and cv::imencode
+class OpenCVCodec : public ImageCodec
+{
+public:
+    bool decode(const unsigned char *data, std::size_t length, const cv::Size &target_size, cv::Mat &image) override;
+    bool encode(const cv::Mat &image, OutputFormat format, int quality, int effort, std::vector<uchar> &buffer) override;
+};
+
+#ifdef IMAGE_RESIZER_WITH_TURBOJPEG
+/// @brief JPEG through the TurboJPEG API of libjpeg-turbo, OpenCV for everything else
+///
+/// Decodes straight into the caller's cv::Mat at any of the libjpeg-turbo
+/// scaling factors and encodes into the caller's buffer, skipping the format
+/// probing and intermediate copies of cv::imdecode and cv::imencode.
+/// Compressor and decompressor handles are created once per thread.
+class TurboJpegCodec : public ImageCodec
+{
+public:
+    bool decode(const unsigned char *data, std::size_t length, const cv::Size &target_size, cv::Mat &image) override;
+    bool encode(const cv::Mat &image, OutputFormat format, int quality, int effort, std::vector<uchar> &buffer) override;
+    bool yuv_supported(OutputFormat format, int effort) const override;
+    bool decode_yuv(const unsigned char *data, std::size_t length, const cv::Size &target_size, YuvImage &image) override;
+    bool encode_yuv(const YuvImage &image, int quality, std::vector<uchar> &buffer) override;
+
+private:
+    OpenCVCodec fallback_;
+};
+#endif
+
+/// @brief Fastest codec this build has, TurboJpegCodec when available
+ImageCodec &default_codec();
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <cstddef>
+
+/// @brief Runtime settings of the application
+///
+/// Every setting can be overridden with an environment variable so that the
+/// container can be tuned without rebuilding the image.
+struct AppConfig
+{
+    /// @brief Value of admission_pixels standing for 32 Mi per worker, the default
+    static const std::size_t admission_pixels_per_worker = static_cast<std::size_t>(-1);
+
+    /// @brief Port every HTTP shard listens on (IMAGE_RESIZER_PORT)
+    std::size_t http_port = 8080;
+
+    /// @brief Services accepting and parsing HTTP, each on its own thread (IMAGE_RESIZER_HTTP_SHARDS)
+    std::size_t http_shards = 1;
+
+    /// @brief Threads resizing images, 0 for one per core (IMAGE_RESIZER_WORKERS)
+    std::size_t worker_threads = 0;
+
+    /// @brief Requests allowed to wait for a worker, 0 for four per worker (IMAGE_RESIZER_QUEUE_SIZE)
+    std::size_t worker_queue_size = 0;
+
+    /// @brief Run requests through the decode, resize and encode stage pipeline instead of the worker pool (IMAGE_RESIZER_PIPELINE)
+    std::size_t pipeline = 0;
+
+    /// @brief Pipeline threads decoding images, 0 for a third of the cores (IMAGE_RESIZER_DECODE_THREADS)
+    std::size_t decode_threads = 0;
+
+    /// @brief Pipeline threads resizing images, 0 for a third of the cores (IMAGE_RESIZER_RESIZE_THREADS)
+    std::size_t resize_threads = 0;
+
+    /// @brief Pipeline threads encoding images, 0 for a third of the cores (IMAGE_RESIZER_ENCODE_THREADS)
+    std::size_t encode_threads = 0;
+
+    /// @brief Pixels of cost a queued request is credited per millisecond of waiting (IMAGE_RESIZER_AGING_PIXELS_PER_MS)
+    std::size_t aging_pixels_per_ms = 256 * 1024;
+
+    /// @brief Workers resizing only small requests, always less than the workers (IMAGE_RESIZER_RESERVED_WORKERS)
+    std::size_t reserved_workers = 0;
+
+    /// @brief Largest estimated pixels of a request the reserved workers resize (IMAGE_RESIZER_SMALL_JOB_PIXELS)
+    std::size_t small_job_pixels = 4 * 1024 * 1024;
+
+    /// @brief Memory budget of the response cache in bytes, 0 to disable it (IMAGE_RESIZER_CACHE_BYTES)
+    std::size_t cache_bytes = 64 * 1024 * 1024;
+
+    /// @brief Image memory all threads together keep for reuse in bytes, 0 to disable pooling (IMAGE_RESIZER_MAT_POOL_BYTES)
+    std::size_t mat_pool_bytes = 128 * 1024 * 1024;
+
+    /// @brief Sources of at least this many pixels are decoded, resized and encoded strip by strip, 0 never (IMAGE_RESIZER_STREAM_MIN_PIXELS)
+    std::size_t stream_min_pixels = 16 * 1024 * 1024;
+
+    /// @brief JPEG outputs of at least this many pixels are encoded in bands on several threads, 0 never (IMAGE_RESIZER_PARALLEL_JPEG_PIXELS)
+    std::size_t parallel_jpeg_pixels = 4 * 1024 * 1024;
+
+    /// @brief Pixels decoded, resized and encoded at once, 0 for no limit (IMAGE_RESIZER_ADMISSION_PIXELS)
+    std::size_t admission_pixels = admission_pixels_per_worker;
+
+    /// @brief Image memory held by admitted requests in bytes, 0 for no limit (IMAGE_RESIZER_ADMISSION_BYTES)
+    std::size_t admission_bytes = 1024 * 1024 * 1024;
+
+    /// @brief Requests allowed to wait for admission, 0 to answer 503 at once (IMAGE_RESIZER_ADMISSION_QUEUE_SIZE)
+    std::size_t admission_queue_size = 64;
+
+    /// @brief Milliseconds a request waits for admission before answering 503 (IMAGE_RESIZER_ADMISSION_WAIT_MS)
+    std::size_t admission_wait_ms = 250;
+
+    /// @brief Seconds sent in the Retry-After header of 503 answers (IMAGE_RESIZER_RETRY_AFTER)
+    std::size_t retry_after_seconds = 1;
+
+    /// @brief Build the configuration from the process environment
+    /// @return Defaults overridden by every valid environment variable
+    static AppConfig from_env();
+};
+
+#endif
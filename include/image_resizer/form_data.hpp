@@ -0,0 +1,46 @@
+#ifndef FORM_DATA_HPP
+#define FORM_DATA_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief One part of a multipart/form-data body
+struct FormPart
+{
+    /// @brief name parameter of Content-Disposition
+    std::string name;
+
+    /// @brief filename parameter of Content-Disposition, empty for plain fields
+    std::string filename;
+
+    std::string content_type;
+
+    /// @brief Content of the part, a view into the parsed body
+    const char *data = nullptr;
+    std::size_t length = 0;
+};
+
+/// @brief Read a parameter of a header value, e.g. boundary of a Content-Type
+/// @param header_value full header value
+/// @param name parameter name
+/// @param value parameter value without quotes
+/// @return false if the parameter is missing
+bool header_parameter(const std::string &header_value, const std::string &name, std::string &value);
+
+/// @brief Split a multipart/form-data body into its parts without copying their content
+/// @param content_type Content-Type header of the request, holding the boundary
+/// @param body request body, must outlive parts
+/// @param length body size
+/// @param parts parsed parts
+/// @return false if the body is not valid multipart/form-data
+bool parse_multipart(const std::string &content_type, const char *body, std::size_t length, std::vector<FormPart> &parts);
+
+/// @brief Read a parameter of the query string of a request target
+/// @param target request target, e.g. /resize_raw?desired_width=640
+/// @param name parameter name
+/// @param value percent-decoded parameter value
+/// @return false if the parameter is missing
+bool query_parameter(const std::string &target, const std::string &name, std::string &value);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/// @brief 128-bit non-cryptographic hash value
+struct Hash128
+{
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+};
+
+inline bool operator==(const Hash128 &lhs, const Hash128 &rhs)
+{
+    return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+inline bool operator!=(const Hash128 &lhs, const Hash128 &rhs)
+{
+    return !(lhs == rhs);
+}
+
+/// @brief Seeds of hash_bytes and check_bytes, drawn at random once per process
+///
+/// Keys cannot be computed ahead of time by a client, which makes crafting
+/// two inputs with the same key much harder than with a fixed seed.
+struct HashSeeds
+{
+    std::uint64_t hash = 0;
+    std::uint64_t check = 0;
+};
+
+/// @brief Seeds of this process
+const HashSeeds &hash_seeds();
+
+/// @brief Hash a byte range with XXH3-128
+///
+/// Runs at several GB/s so that multi-megabyte payloads can be used as cache
+/// keys.
+///
+/// @param data bytes to hash
+/// @param length number of bytes
+/// @param seed seed of XXH3
+/// @return 128-bit hash
+Hash128 hash_bytes(const void *data, std::size_t length, std::uint64_t seed = 0);
+
+/// @brief Hash a byte range with XXH3-64, a digest to check against hash_bytes with another seed
+/// @param data bytes to hash
+/// @param length number of bytes
+/// @param seed seed of XXH3
+/// @return 64-bit hash
+std::uint64_t check_bytes(const void *data, std::size_t length, std::uint64_t seed = 0);
+
+namespace std
+{
+    template <>
+    struct hash<Hash128>
+    {
+        std::size_t operator()(const Hash128 &value) const { return static_cast<std::size_t>(value.low); }
+    };
+}
+
+#endif
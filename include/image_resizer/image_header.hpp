@@ -0,0 +1,31 @@
+#ifndef IMAGE_HEADER_HPP
+#define IMAGE_HEADER_HPP
+
+#include <cstddef>
+
+/// @brief Basic properties of an encoded image, read from its header only
+struct ImageHeader
+{
+    enum class Format
+    {
+        UNKNOWN,
+        JPEG,
+        PNG,
+    };
+
+    Format format = Format::UNKNOWN;
+    int width = 0;
+    int height = 0;
+
+    /// @brief Components stored in the file, e.g. 1 for grayscale JPEG
+    int channels = 0;
+};
+
+/// @brief Read format and dimensions of a JPEG or PNG without decoding it
+/// @param data encoded image bytes
+/// @param length number of bytes available
+/// @param header parsed header, left untouched on failure
+/// @return true if a complete JPEG SOF or PNG IHDR was found
+bool peek_image_header(const unsigned char *data, std::size_t length, ImageHeader &header);
+
+#endif
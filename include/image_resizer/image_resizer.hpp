@@ -1,7 +1,9 @@
 #ifndef IMAGE_RESIZER_HPP
 #define IMAGE_RESIZER_HPP
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -10,12 +12,93 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include "image_resizer/base64.hpp"
+#include "image_resizer/codec.hpp"
 #include "image_resizer/error.hpp"
+#include "image_resizer/hash.hpp"
+#include "image_resizer/interpolation.hpp"
+#include "image_resizer/metrics.hpp"
+#include "image_resizer/output_format.hpp"
+#include "image_resizer/result_cache.hpp"
+#include "image_resizer/stream_resizer.hpp"
+
+/// @brief Resize parameters read from a request
+struct ResizeOptions
+{
+    /// @brief Target sizes, a single one unless the request lists "sizes"
+    std::vector<cv::Size> sizes;
+
+    /// @brief Largest target width or height, the limit of JPEG
+    static const int max_dimension = 65500;
+
+    /// @brief Answer with an "outputs" array instead of a single "output_jpeg"
+    bool multi_size = false;
+
+    Interpolation interpolation = Interpolation::NEAREST;
+
+    /// @brief Encoding of the resized images
+    OutputFormat format = OutputFormat::JPEG;
+
+    /// @brief Encoder quality from 1 to 100, -1 for the encoder default
+    int quality = -1;
+
+    /// @brief Encoder effort from 0 (fastest) to 9 (smallest output), -1 for the encoder default
+    int effort = -1;
+};
+
+/// @brief Request state handed from one processing stage to the next
+///
+/// ImageResizer::process runs the three stages in a row, ResizePipeline
+/// runs each of them on its own threads.
+struct ResizeJob
+{
+    /// @brief Where the images of the job come from
+    enum class Source
+    {
+        // Response found in the result cache, nothing left to compute
+        CACHED,
+        // Decoded, resized and encoded strip by strip during the decode stage
+        STREAMED,
+        // JPEG decoded into YCbCr planes
+        YUV,
+        // Image decoded into a cv::Mat
+        MAT,
+    };
+
+    ResizeOptions options;
+    Source source = Source::MAT;
+
+    /// @brief Answer with the encoded bytes only, as process_raw does
+    bool raw = false;
+
+    /// @brief Result cache entry to fill, when use_cache is set
+    bool use_cache = false;
+    CacheKey key;
+    /// @brief key was already looked up and missed, by ImageResizer::lookup
+    bool cache_checked = false;
+    std::shared_ptr<const std::string> cached;
+
+    cv::Mat decoded_image;
+    YuvImage decoded_yuv;
+    std::vector<cv::Mat> resized_images;
+    std::vector<YuvImage> resized_yuv;
+    std::vector<std::vector<uchar>> encoded_images;
+};
 
 class ImageResizer
 {
 public:
     ImageResizer() = default;
+
+    /// @brief Create a resizer answering repeated requests from a result cache
+    /// @param cache cache shared with other resizers, nullptr disables caching
+    /// @param metrics stage timings are recorded here, nullptr disables them
+    /// @param stream_min_pixels sources of at least this many pixels are resized strip by strip, 0 never
+    /// @param parallel_jpeg_pixels JPEG outputs of at least this many pixels are encoded on several threads, 0 never
+    explicit ImageResizer(std::shared_ptr<ResultCache> cache, std::shared_ptr<Metrics> metrics = nullptr, std::size_t stream_min_pixels = 0,
+                          std::size_t parallel_jpeg_pixels = 0)
+        : cache_(std::move(cache)), metrics_(std::move(metrics)), stream_min_pixels_(stream_min_pixels),
+          parallel_jpeg_pixels_(parallel_jpeg_pixels) {}
+
     ~ImageResizer(){};
 
     ImageResizer(const ImageResizer &obj) = delete;
@@ -27,17 +110,207 @@ public:
     Error process(const rapidjson::Document &encoded_input, rapidjson::Document &encoded_output);
     Error process(const std::string &encoded_input, std::string &encoded_output);
 
+    /// @brief Resize image request and append the json response to encoded_output
+    /// @param encoded_input validated request object, a document or one item of a batch
+    /// @param encoded_output serialized response, e.g. the outgoing http body
+    /// @param preferred_format format used unless the request sets "output_format", e.g. negotiated from Accept
+    /// @return Error status
+    Error process(const rapidjson::Value &encoded_input, std::string &encoded_output, OutputFormat preferred_format = OutputFormat::JPEG);
+
+    /// @brief Resize an image sent as raw bytes, without base64 nor json
+    /// @param data encoded image bytes, e.g. the body of an octet-stream upload
+    /// @param length number of bytes
+    /// @param options parameters, exactly one target size
+    /// @param output encoded bytes, in options.format, are appended here
+    /// @return Error status
+    Error process_raw(const unsigned char *data, std::size_t length, const ResizeOptions &options, std::string &output);
+
+    /// @brief Check the optional fields and target sizes of a request, as decode reads them
+    /// @param encoded_input request object with input_jpeg, and sizes or desired_width and desired_height
+    /// @return Error status with the reason of a refused field, the client's mistake
+    static Error validate_options(const rapidjson::Value &encoded_input);
+
+    /// @brief Answer a request from the result cache, before it is admitted and queued
+    /// @param encoded_input validated request object
+    /// @param job key and cache_checked are set on a miss, for decode to skip the lookup
+    /// @param preferred_format format used unless the request sets "output_format"
+    /// @param output cached response is appended here on a hit
+    /// @return true on a hit, false on a miss, without a cache and for requests decode refuses
+    bool lookup(const rapidjson::Value &encoded_input, ResizeJob &job, OutputFormat preferred_format, std::string &output);
+
+    /// @brief Answer a raw request from the result cache, before it is admitted and queued
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param job options set by the caller, key and cache_checked are set on a miss
+    /// @param output cached response is appended here on a hit
+    /// @return true on a hit, false on a miss, without a cache and for requests decode_raw refuses
+    bool lookup_raw(const unsigned char *data, std::size_t length, ResizeJob &job, std::string &output);
+
+    /// @brief Decode stage of process: read the options, look the response up in the cache and decode the image
+    /// @param encoded_input validated request object, must outlive the job
+    /// @param job state of the request, ready for resize unless the source is CACHED or STREAMED
+    /// @param preferred_format format used unless the request sets "output_format"
+    /// @return Error status, the job is dropped on failure
+    Error decode(const rapidjson::Value &encoded_input, ResizeJob &job, OutputFormat preferred_format = OutputFormat::JPEG);
+
+    /// @brief Decode stage of process_raw
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param job state of the request, its options set by the caller with exactly one target size
+    /// @return Error status, the job is dropped on failure
+    Error decode_raw(const unsigned char *data, std::size_t length, ResizeJob &job);
+
+    /// @brief Resize stage: resize the decoded image to every target size
+    /// @param job decoded request, nothing is left to do for CACHED and STREAMED sources
+    void resize(ResizeJob &job);
+
+    /// @brief Encode stage: encode the resized images, append the response to output and cache it
+    /// @param job resized request
+    /// @param output json response, or the encoded bytes for raw jobs, left as it was on failure
+    /// @return Error status
+    Error encode(ResizeJob &job, std::string &output);
+
 private:
-    /// @brief Decode image from base64 string data
-    /// @param byte_string encoded string image
-    /// @return Decoded image in cv::Mat format
-    cv::Mat decode_image(const std::string &byte_string);
+    /// @brief Decode base64 string data into a per-thread buffer
+    /// @param encoded encoded image characters, e.g. a view into the json document
+    /// @param length number of encoded characters
+    /// @param decoded_length number of decoded bytes
+    /// @return Decoded bytes, valid until the next call on this thread
+    /// @throw std::runtime_error if input is not valid base64-encoded data
+    const unsigned char *decode_base64(const char *encoded, std::size_t length, std::size_t &decoded_length);
+
+    /// @brief Decode image from its encoded bytes
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param target_size size the image is resized to, lets JPEG decode at a reduced scale
+    /// @return Decoded image in cv::Mat format, empty if data is not an image
+    cv::Mat decode_bytes(const unsigned char *data, std::size_t length, const cv::Size &target_size);
+
+    /// @brief Whether an output of this many pixels is encoded in parallel bands
+    /// @param options output format and effort
+    /// @param pixels pixels of the output
+    bool parallel_jpeg(const ResizeOptions &options, std::size_t pixels) const;
+
+    /// @brief Encode cv::Mat image with the codec, or in parallel bands when it is a large JPEG
+    /// @param image input image to be encoded
+    /// @param options output format, quality and effort
+    /// @param buffer encoded bytes, replaced
+    /// @return false, and buffer empty, if the image could not be encoded
+    bool encode_mat(const cv::Mat &image, const ResizeOptions &options, std::vector<uchar> &buffer);
+
+    /// @brief Encode YCbCr planes as JPEG with the codec
+    /// @param image planes to be encoded
+    /// @param options output quality
+    /// @param buffer encoded bytes, replaced
+    /// @return false, and buffer empty, if the planes could not be encoded
+    bool encode_yuv(const YuvImage &image, const ResizeOptions &options, std::vector<uchar> &buffer);
+
+    /// @brief Encode cv::Mat image and append its base64 string data to output
+    /// @param image input image to be encoded
+    /// @param options output format, quality and effort
+    /// @param output string the encoded image is appended to, untouched on failure
+    /// @return Error status
+    Error encode_image(const cv::Mat &image, const ResizeOptions &options, std::string &output);
 
-    /// @brief Encode cv::Mat image to base64 string data
+    /// @brief Encode cv::Mat image and append its raw bytes to output
     /// @param image input image to be encoded
-    /// @param type Image encoding/compression type
-    /// @return Encoded image in string format
-    std::string encode_image(const cv::Mat &image, const std::string &type);
+    /// @param options output format, quality and effort
+    /// @param output string the encoded bytes are appended to, untouched on failure
+    /// @return Error status
+    Error encode_bytes(const cv::Mat &image, const ResizeOptions &options, std::string &output);
+
+    /// @brief Encode YCbCr planes and append their base64 string data to output
+    /// @param image planes to be encoded
+    /// @param options output quality
+    /// @param output string the encoded image is appended to
+    /// @return Error status
+    Error encode_image(const YuvImage &image, const ResizeOptions &options, std::string &output);
+
+    /// @brief Encode YCbCr planes and append their raw bytes to output
+    /// @param image planes to be encoded
+    /// @param options output quality
+    /// @param output string the encoded bytes are appended to
+    /// @return Error status
+    Error encode_bytes(const YuvImage &image, const ResizeOptions &options, std::string &output);
+
+    /// @brief Append the base64 string data of an already encoded image to output
+    /// @param encoded encoded image bytes
+    /// @param options unused, encoding already happened
+    /// @param output string the encoded image is appended to
+    /// @return Error::Success
+    Error encode_image(const std::vector<uchar> &encoded, const ResizeOptions &options, std::string &output);
+
+    /// @brief Read resize parameters, including optional fields, from a request
+    /// @param encoded_input validated request object
+    /// @param options parsed parameters
+    /// @return Error status
+    static Error parse_options(const rapidjson::Value &encoded_input, ResizeOptions &options);
+
+    /// @brief Decode the image of a request once and resize it to every target size
+    /// @param encoded_input validated request object
+    /// @param options parsed parameters
+    /// @param resized_images one resized image per entry of options.sizes
+    /// @return Error status
+    Error resize_image(const rapidjson::Value &encoded_input, const ResizeOptions &options, std::vector<cv::Mat> &resized_images);
+
+    /// @brief Decode, resize and encode a large source strip by strip
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param options parsed parameters
+    /// @param encoded_images one encoded image per entry of options.sizes
+    /// @return false if the source is below stream_min_pixels_ or cannot be streamed
+    bool resize_streaming(const unsigned char *data, std::size_t length, const ResizeOptions &options, std::vector<std::vector<uchar>> &encoded_images);
+
+    /// @brief Decode a JPEG into YCbCr planes
+    ///
+    /// Skips the BGR round trip of decoding, resizing and encoding JPEG
+    /// through cv::Mat, and resizes subsampled chroma at its own resolution.
+    ///
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param options parsed parameters
+    /// @param decoded_image planes of the source, at a reduced scale when the target sizes allow it
+    /// @return false if the codec, the image or the output format do not allow it, or if an output is
+    /// large enough for the parallel JPEG encoder, which works on cv::Mat
+    bool decode_yuv(const unsigned char *data, std::size_t length, const ResizeOptions &options, YuvImage &decoded_image);
+
+    /// @brief Decode the image of a job, streaming it or into planes when possible
+    /// @param data encoded image bytes
+    /// @param length number of bytes
+    /// @param job request whose source and images are set
+    /// @return Error status
+    Error decode_image(const unsigned char *data, std::size_t length, ResizeJob &job);
+
+    /// @brief Resize a decoded image to every target size
+    /// @param decoded_image source image
+    /// @param options parsed parameters
+    /// @param resized_images one resized image per entry of options.sizes
+    void resize_variants(const cv::Mat &decoded_image, const ResizeOptions &options, std::vector<cv::Mat> &resized_images);
+
+    /// @brief Encode resized images and append the json response to encoded_output
+    /// @param options parsed parameters
+    /// @param resized_images one resized image per entry of options.sizes, cv::Mat, YuvImage or encoded bytes
+    /// @param encoded_output serialized response, partly written on failure
+    /// @return Error status of the first image that could not be encoded
+    template <typename Image>
+    Error write_response(const ResizeOptions &options, const std::vector<Image> &resized_images, std::string &encoded_output);
+
+    /// @brief Content hash identifying the response of a request
+    /// @param input encoded image as sent, base64 or raw bytes
+    /// @param length size of input
+    /// @param options parsed parameters
+    /// @param layout response layout, e.g. "single", "multi" or "raw"
+    /// @return Hash and check digest of the encoded image and every parameter affecting the output
+    static CacheKey cache_key(const void *input, std::size_t length, const ResizeOptions &options, const char *layout);
+
+    std::shared_ptr<ResultCache> cache_;
+    std::shared_ptr<Metrics> metrics_;
+
+    /// @brief Decoder and encoder of every image, shared by all resizers
+    ImageCodec *codec_ = &default_codec();
+
+    std::size_t stream_min_pixels_ = 0;
+    std::size_t parallel_jpeg_pixels_ = 0;
 };
 
 #endif
\ No newline at end of file
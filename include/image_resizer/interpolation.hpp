@@ -0,0 +1,40 @@
+#ifndef INTERPOLATION_HPP
+#define INTERPOLATION_HPP
+
+#include <string>
+#include <opencv2/core.hpp>
+
+/// @brief Resampling filters and named quality/speed presets
+enum class Interpolation
+{
+    NEAREST,
+    LINEAR,
+    AREA,
+    CUBIC,
+    LANCZOS,
+    // Preset: area on downscale, lanczos on upscale
+    QUALITY,
+};
+
+/// @brief Parse an interpolation mode or preset name
+/// @param name one of nearest, linear, area, cubic, lanczos or the presets fast, balanced, quality
+/// @param interpolation parsed mode, left untouched on failure
+/// @return false if the name is unknown
+bool parse_interpolation(const std::string &name, Interpolation &interpolation);
+
+/// @brief Name of an interpolation mode
+std::string interpolation_name(Interpolation interpolation);
+
+/// @brief Resize image, reducing large downscales with cv::pyrDown first
+///
+/// Every mode but NEAREST halves the source with cv::pyrDown while it is at
+/// least twice the target size, so the final filter only ever works on less
+/// than a 2x reduction.
+///
+/// @param src source image
+/// @param dst resized image
+/// @param size target size
+/// @param interpolation resampling filter
+void resample_image(const cv::Mat &src, cv::Mat &dst, const cv::Size &size, Interpolation interpolation);
+
+#endif
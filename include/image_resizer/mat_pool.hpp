@@ -0,0 +1,56 @@
+#ifndef MAT_POOL_HPP
+#define MAT_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <opencv2/core.hpp>
+
+/// @brief Buffers of a MatPool shared by every thread, defined in mat_pool.cpp
+struct MatPoolDepot;
+
+/// @brief cv::MatAllocator recycling pixel buffers within one byte budget
+///
+/// Released buffers are kept, grouped in size classes, for the next images
+/// of similar sizes, which then reuse memory instead of going through malloc,
+/// which fragments the heap with multi-megabyte blocks. Each thread keeps a
+/// couple of buffers per class in a small magazine of its own, the others
+/// go to a pool shared by every thread. Buffers allocated on one thread and
+/// released on another, as between the pipeline stages, are reused by
+/// either. Every kept buffer, in a magazine or shared, counts against the
+/// same budget, so memory does not grow with the number of threads.
+class MatPool : public cv::MatAllocator
+{
+public:
+    /// @brief Create a pool
+    /// @param max_cached_bytes memory all threads together may keep for reuse, larger buffers are never pooled
+    explicit MatPool(std::size_t max_cached_bytes);
+    ~MatPool() override;
+
+    MatPool(const MatPool &obj) = delete;
+    MatPool &operator=(const MatPool &obj) = delete;
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+    /// @brief Size class a buffer of a given size is rounded up to
+    /// @param size requested bytes
+    /// @return Class index, its capacity is class_capacity(index)
+    static std::size_t size_class(std::size_t size);
+
+    /// @brief Bytes held by the buffers of a size class
+    static std::size_t class_capacity(std::size_t index);
+
+    /// @brief Bytes kept for reuse by every thread together
+    std::size_t cached_bytes() const;
+
+    /// @brief Install a pool for every cv::Mat allocated without an explicit allocator
+    /// @param max_cached_bytes memory all threads together may keep for reuse, 0 keeps the OpenCV allocator
+    static void install(std::size_t max_cached_bytes);
+
+private:
+    const std::shared_ptr<MatPoolDepot> depot_;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// @brief Steps of a request timed separately
+enum class Stage
+{
+    REQUEST,
+    PARSE,
+    BASE64_DECODE,
+    IMAGE_DECODE,
+    RESIZE,
+    IMAGE_ENCODE,
+    BASE64_ENCODE,
+    // Decode, resize and encode interleaved strip by strip
+    STREAM,
+    COUNT,
+};
+
+/// @brief Name of a stage, as used in the stage label of /metrics
+const char *stage_name(Stage stage);
+
+/// @brief Latency histograms and request counters exported in Prometheus text format
+///
+/// Every thread records into its own histograms, so recording is a few
+/// uncontended relaxed atomic operations. Histograms are only summed when
+/// the metrics are rendered.
+class Metrics
+{
+public:
+    /// @brief Upper bounds of the histogram buckets in nanoseconds, +Inf excluded
+    static const std::uint64_t bucket_bounds[];
+    static const std::size_t bucket_count;
+
+    Metrics();
+    ~Metrics();
+
+    Metrics(const Metrics &obj) = delete;
+    Metrics &operator=(const Metrics &obj) = delete;
+
+    /// @brief Record the duration of a stage on the calling thread
+    /// @param stage timed stage
+    /// @param nanoseconds elapsed time
+    void observe(Stage stage, std::uint64_t nanoseconds);
+
+    /// @brief Count an answered request
+    /// @param code HTTP status code
+    /// @param bytes_in request body size
+    /// @param bytes_out response body size
+    void count_request(std::uint16_t code, std::size_t bytes_in, std::size_t bytes_out);
+
+    /// @brief Update the number of requests being handled
+    void add_in_flight(std::int64_t delta) { in_flight_.fetch_add(delta, std::memory_order_relaxed); }
+
+    /// @brief Append every metric to output in Prometheus text format
+    /// @param output e.g. the body of a /metrics response
+    void render(std::string &output) const;
+
+private:
+    struct ThreadHistograms;
+
+    /// @brief Histograms of the calling thread, registered on first use
+    ThreadHistograms &local();
+
+    const std::uint64_t id_;
+
+    static const std::size_t max_code = 600;
+    std::atomic<std::uint64_t> requests_[max_code];
+    std::atomic<std::int64_t> in_flight_;
+    std::atomic<std::uint64_t> bytes_in_;
+    std::atomic<std::uint64_t> bytes_out_;
+
+    std::map<std::thread::id, std::unique_ptr<ThreadHistograms>> threads_;
+    mutable std::mutex threads_mutex_;
+};
+
+/// @brief Time the enclosing scope as one stage, a no-op without metrics
+class StageTimer
+{
+public:
+    StageTimer(Metrics *metrics, Stage stage)
+        : metrics_(metrics), stage_(stage)
+    {
+        if (metrics_ != nullptr)
+            start_ = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer()
+    {
+        if (metrics_ != nullptr)
+        {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            metrics_->observe(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+    StageTimer(const StageTimer &obj) = delete;
+    StageTimer &operator=(const StageTimer &obj) = delete;
+
+private:
+    Metrics *metrics_;
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif
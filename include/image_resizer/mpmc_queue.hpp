@@ -0,0 +1,139 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/// @brief Bounded lock-free queue for any number of producers and consumers
+///
+/// Dmitry Vyukov's array queue: every cell carries a sequence number telling
+/// whether it is free for the producer of a given position or holds the
+/// value for the consumer of that position. Producers and consumers each
+/// claim a position with one compare-and-swap and never wait on each other.
+///
+/// @tparam T value type, moved in and out
+template <typename T>
+class MpmcQueue
+{
+public:
+    /// @brief Create an empty queue
+    /// @param capacity maximum number of values, rounded up to a power of two
+    explicit MpmcQueue(std::size_t capacity)
+    {
+        capacity_ = 2;
+        while (capacity_ < capacity)
+            capacity_ *= 2;
+        mask_ = capacity_ - 1;
+
+        cells_.reset(new Cell[capacity_]);
+        for (std::size_t i = 0; i < capacity_; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &obj) = delete;
+    MpmcQueue &operator=(const MpmcQueue &obj) = delete;
+
+    /// @brief Append a value without blocking
+    /// @param value moved into the queue on success only
+    /// @return false if the queue is full
+    bool try_push(T &value)
+    {
+        Cell *cell;
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The cell still holds the value pushed one lap earlier
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Remove the oldest value without blocking
+    /// @param value assigned the removed value
+    /// @return false if the queue is empty
+    bool try_pop(T &value)
+    {
+        Cell *cell;
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        // Free for the producer of the same cell one lap later
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Maximum number of values
+    std::size_t capacity() const { return capacity_; }
+
+    /// @brief Number of values, only a snapshot while other threads use the queue
+    std::size_t size() const
+    {
+        std::size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+        std::size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? std::min(enqueued - dequeued, capacity_) : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    // Padding keeps the positions on their own cache lines, so that producers
+    // and consumers do not invalidate each other's line on every operation
+    static const std::size_t cache_line = 64;
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t capacity_;
+    std::size_t mask_;
+    char padding0_[cache_line];
+    std::atomic<std::size_t> enqueue_pos_;
+    char padding1_[cache_line - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> dequeue_pos_;
+    char padding2_[cache_line - sizeof(std::atomic<std::size_t>)];
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef OUTPUT_FORMAT_HPP
+#define OUTPUT_FORMAT_HPP
+
+#include <string>
+#include <vector>
+
+/// @brief Encodings a resized image can be answered with
+enum class OutputFormat
+{
+    JPEG,
+    PNG,
+    WEBP,
+    AVIF,
+};
+
+/// @brief Parse an output format name
+/// @param name one of jpeg, png, webp or avif
+/// @param format parsed format, left untouched on failure
+/// @return false if the name is unknown
+bool parse_output_format(const std::string &name, OutputFormat &format);
+
+/// @brief Name of an output format
+std::string output_format_name(OutputFormat format);
+
+/// @brief File extension cv::imencode selects the encoder with, e.g. ".jpg"
+const char *output_format_extension(OutputFormat format);
+
+/// @brief Media type of an output format, e.g. "image/jpeg"
+const char *output_format_mime(OutputFormat format);
+
+/// @brief Whether the OpenCV build has an encoder for a format
+bool output_format_supported(OutputFormat format);
+
+/// @brief Build cv::imencode parameters
+/// @param format output format
+/// @param quality 1 to 100 for JPEG, WebP and AVIF, -1 for the encoder default
+/// @param effort 0 (fastest) to 9 (smallest output), -1 for the encoder default
+/// @return Flag and value pairs
+std::vector<int> output_format_params(OutputFormat format, int quality, int effort);
+
+/// @brief Pick the output format from an Accept header
+///
+/// Only image types are considered. The one with the highest q value wins,
+/// ties go to the format producing the smallest output, i.e. AVIF, WebP,
+/// JPEG then PNG. Wildcards never change the default.
+///
+/// @param accept Accept header value
+/// @param format negotiated format, left untouched if no supported image type is accepted
+/// @return false if accept names no supported image type
+bool negotiate_output_format(const std::string &accept, OutputFormat &format);
+
+#endif
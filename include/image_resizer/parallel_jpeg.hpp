@@ -0,0 +1,29 @@
+#ifndef PARALLEL_JPEG_HPP
+#define PARALLEL_JPEG_HPP
+
+#include <cstddef>
+#include <vector>
+#include <opencv2/core.hpp>
+
+/// @brief Encode an image as one baseline JPEG, its horizontal bands on several threads
+///
+/// The image is cut into bands of whole MCU rows and every band is encoded
+/// on its own by libjpeg with a restart marker after each MCU row, which
+/// resets the DC predictors. With the same quantization and standard Huffman
+/// tables the entropy-coded data of a band then does not depend on the bands
+/// above it, so the bands are joined behind the headers of the first one:
+/// the frame height is patched, the restart markers are renumbered and one
+/// more is put between two bands. The result equals the serial encoding
+/// with a restart marker after every MCU row, byte for byte.
+///
+/// Optimized Huffman tables would differ between bands, so this encoder
+/// always uses the standard ones, like libjpeg with optimize_coding off.
+///
+/// @param image 8-bit image with 1, 3 (BGR) or 4 (BGRA, alpha dropped) channels
+/// @param quality encoder quality from 1 to 100, -1 for 95 as cv::imencode
+/// @param bands maximum number of bands, at most one per MCU row is used
+/// @param buffer encoded JPEG, replaced
+/// @return false if the image cannot be encoded this way
+bool encode_jpeg_parallel(const cv::Mat &image, int quality, std::size_t bands, std::vector<uchar> &buffer);
+
+#endif
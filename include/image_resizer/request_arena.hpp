@@ -0,0 +1,50 @@
+#ifndef REQUEST_ARENA_HPP
+#define REQUEST_ARENA_HPP
+
+#include <cstddef>
+#include <rapidjson/document.h>
+
+/// @brief Document whose values and parse stack both live in a memory pool
+typedef rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>, rapidjson::MemoryPoolAllocator<>> RequestDocument;
+
+/// @brief Json document of one request, backed by a chunk recycled across requests
+///
+/// Chunks are kept in a per-thread free list. A default rapidjson::Document
+/// allocates its pool allocator, its first chunk and its parse stack on
+/// every request, a document from an arena allocates nothing as long as it
+/// fits in the chunk. Fibers of one thread may hold several arenas at once.
+class RequestArena
+{
+public:
+    /// @brief Size of the recycled chunk, values and parse stack included
+    static const std::size_t chunk_size = 64 * 1024;
+
+    RequestArena();
+
+    RequestArena(const RequestArena &obj) = delete;
+    RequestArena &operator=(const RequestArena &obj) = delete;
+
+    RequestDocument &document() { return document_; }
+
+private:
+    /// @brief Chunk taken from the free list of the thread and given back on destruction
+    class Chunk
+    {
+    public:
+        Chunk();
+        ~Chunk();
+
+        char *data() { return data_; }
+
+    private:
+        char *data_;
+    };
+
+    // Declaration order matters, the chunk must outlive the allocators using it
+    Chunk chunk_;
+    rapidjson::MemoryPoolAllocator<> value_allocator_;
+    rapidjson::MemoryPoolAllocator<> stack_allocator_;
+    RequestDocument document_;
+};
+
+#endif
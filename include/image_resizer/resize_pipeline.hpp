@@ -0,0 +1,155 @@
+#ifndef RESIZE_PIPELINE_HPP
+#define RESIZE_PIPELINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "image_resizer/error.hpp"
+#include "image_resizer/image_resizer.hpp"
+#include "image_resizer/mpmc_queue.hpp"
+
+/// @brief Threads of each stage of a ResizePipeline
+struct PipelineOptions
+{
+    /// @brief Threads decoding images, 0 for a third of the hardware threads
+    std::size_t decode_threads = 0;
+
+    /// @brief Threads resizing images, 0 for a third of the hardware threads
+    std::size_t resize_threads = 0;
+
+    /// @brief Threads encoding images, 0 for a third of the hardware threads
+    std::size_t encode_threads = 0;
+
+    /// @brief Requests allowed to wait for a decode thread, 0 for four per decode thread
+    std::size_t queue_capacity = 0;
+};
+
+/// @brief Decode, resize and encode requests on separate groups of threads
+///
+/// Every stage has its own threads and takes requests from a bounded
+/// lock-free queue filled by the previous stage, so that one request is
+/// encoded while the next ones are resized and decoded. A thread always runs
+/// the same stage, which keeps its codec state and scratch buffers warm.
+/// A full queue between two stages holds the previous stage back. Only a
+/// full input queue turns requests away.
+class ResizePipeline
+{
+public:
+    /// @brief Decode stage of one request, e.g. ImageResizer::decode bound to its json object
+    typedef std::function<Error(ImageResizer &resizer, ResizeJob &job)> DecodeFunction;
+
+    /// @brief Called once a request left the pipeline, from the thread of the last stage it went through
+    typedef std::function<void(const Error &status)> DoneFunction;
+
+    /// @brief Occupancy of one stage
+    struct StageStats
+    {
+        const char *name = "";
+        std::size_t threads = 0;
+
+        /// @brief Threads running a request right now
+        std::size_t busy = 0;
+
+        /// @brief Requests waiting in the input queue of the stage
+        std::size_t queued = 0;
+        std::size_t capacity = 0;
+
+        /// @brief Requests the stage finished
+        std::uint64_t jobs = 0;
+
+        /// @brief Time the threads of the stage spent running requests, blocked_ns included
+        std::uint64_t busy_ns = 0;
+
+        /// @brief Time the threads of the stage waited for room in the queue of the next stage
+        std::uint64_t blocked_ns = 0;
+    };
+
+    /// @brief Start the threads of every stage
+    /// @param resizer resizer running the stages
+    /// @param options threads of each stage
+    ResizePipeline(std::shared_ptr<ImageResizer> resizer, const PipelineOptions &options = PipelineOptions());
+
+    /// @brief Finish every submitted request, then join the threads
+    ~ResizePipeline();
+
+    ResizePipeline(const ResizePipeline &obj) = delete;
+    ResizePipeline &operator=(const ResizePipeline &obj) = delete;
+
+    /// @brief Queue a request without blocking the caller
+    /// @param decode decode stage of the request
+    /// @param output response is appended here, must stay valid until done is called
+    /// @param done called with the status of the request, must not throw
+    /// @return false if the input queue is full or the pipeline is stopping, done is then never called
+    bool try_submit(DecodeFunction decode, std::string &output, DoneFunction done);
+
+    /// @brief Snapshot of the occupancy of the decode, resize and encode stages, in this order
+    std::vector<StageStats> stats() const;
+
+private:
+    struct Request
+    {
+        DecodeFunction decode;
+        std::string *output;
+        DoneFunction done;
+        ResizeJob job;
+    };
+
+    struct StageExecutor
+    {
+        StageExecutor(const char *name, std::size_t threads, std::size_t capacity);
+
+        const char *name;
+        std::size_t thread_count;
+        MpmcQueue<Request *> queue;
+        std::vector<std::thread> threads;
+
+        std::atomic<bool> stopping;
+        std::atomic<std::size_t> sleeping;
+        std::mutex mutex;
+        std::condition_variable cond;
+
+        /// @brief Threads of the previous stage waiting for room in the queue
+        std::atomic<std::size_t> pushing;
+        std::condition_variable not_full;
+
+        std::atomic<std::size_t> busy;
+        std::atomic<std::uint64_t> jobs;
+        std::atomic<std::uint64_t> busy_ns;
+        std::atomic<std::uint64_t> blocked_ns;
+    };
+
+    /// @brief Hand a request to the next stage, waiting while its queue is full
+    /// @param from stage the request leaves, charged the waiting time
+    /// @param to stage the request is queued on
+    /// @param request request to queue
+    static void push(StageExecutor &from, StageExecutor &to, Request *request);
+
+    /// @brief Wake a thread of a stage sleeping on its empty queue
+    static void wake(StageExecutor &stage);
+
+    /// @brief Wake a thread waiting for room in the queue of a stage, after a request was taken from it
+    static void vacate(StageExecutor &stage);
+
+    /// @brief Stop a stage once its queue is drained and join its threads
+    static void stop(StageExecutor &stage);
+
+    /// @brief Take requests from the queue of a stage until it is stopped
+    void run(StageExecutor &stage);
+
+    /// @brief Run one stage of a request and pass it on to the next one
+    void process(StageExecutor &stage, Request *request);
+
+    std::shared_ptr<ImageResizer> resizer_;
+    std::unique_ptr<StageExecutor> decode_;
+    std::unique_ptr<StageExecutor> resize_;
+    std::unique_ptr<StageExecutor> encode_;
+};
+
+#endif
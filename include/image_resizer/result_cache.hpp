@@ -0,0 +1,100 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "image_resizer/hash.hpp"
+
+/// @brief Identity of a cached response
+///
+/// Entries are found by hash alone. check and length are compared on a hit,
+/// so an input colliding with a cached one on hash is answered by a miss
+/// instead of the response of the other input.
+struct CacheKey
+{
+    /// @brief hash_bytes of the request, seeded with HashSeeds::hash
+    Hash128 hash;
+
+    /// @brief check_bytes of the request, seeded with HashSeeds::check
+    std::uint64_t check = 0;
+
+    /// @brief Size of the encoded input
+    std::uint64_t length = 0;
+};
+
+inline bool operator==(const CacheKey &lhs, const CacheKey &rhs)
+{
+    return lhs.hash == rhs.hash && lhs.check == rhs.check && lhs.length == rhs.length;
+}
+
+inline bool operator!=(const CacheKey &lhs, const CacheKey &rhs)
+{
+    return !(lhs == rhs);
+}
+
+/// @brief Thread safe LRU cache of encoded responses with a byte budget
+class ResultCache
+{
+public:
+    /// @brief Counters describing the cache usage
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+        std::size_t capacity_bytes = 0;
+    };
+
+    /// @brief Create an empty cache
+    /// @param capacity_bytes memory budget for stored responses, 0 disables the cache
+    explicit ResultCache(std::size_t capacity_bytes);
+
+    ResultCache(const ResultCache &obj) = delete;
+    ResultCache &operator=(const ResultCache &obj) = delete;
+
+    /// @brief Look a response up and mark it as most recently used
+    /// @param key content hash and check digest of the request
+    /// @return Stored response, nullptr on a miss or if the entry only shares the hash of key
+    std::shared_ptr<const std::string> get(const CacheKey &key);
+
+    /// @brief Store a response, evicting least recently used ones to fit the budget
+    /// @param key content hash and check digest of the request
+    /// @param value encoded response, ignored if larger than the whole budget or if another request has its hash
+    void put(const CacheKey &key, std::string value);
+
+    /// @brief Snapshot of the counters
+    Stats stats() const;
+
+    bool enabled() const { return capacity_bytes_ > 0; }
+
+private:
+    struct Entry
+    {
+        CacheKey key;
+        std::shared_ptr<const std::string> value;
+        std::size_t bytes;
+    };
+
+    void evict_to_fit(std::size_t bytes);
+
+    std::size_t capacity_bytes_;
+    std::size_t bytes_;
+    std::uint64_t hits_;
+    std::uint64_t misses_;
+    std::uint64_t evictions_;
+
+    // Front is the most recently used entry
+    std::list<Entry> entries_;
+    std::unordered_map<Hash128, std::list<Entry>::iterator> index_;
+
+    mutable std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef STREAM_RESIZER_HPP
+#define STREAM_RESIZER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "image_resizer/codec.hpp"
+#include "image_resizer/interpolation.hpp"
+#include "image_resizer/output_format.hpp"
+
+/// @brief Separable resizer fed one source row at a time
+///
+/// Each source row is resized horizontally once, then added to every output
+/// row whose vertical filter covers it. An output row is handed out as soon
+/// as the last source row it needs arrived, so only the few output rows in
+/// progress are kept, never the source image.
+///
+/// Filters approximate resample_image rather than match it: NEAREST samples,
+/// every other mode averages the covered area when shrinking, in place of the
+/// pyrDown pyramid and kernel of resample_image, and interpolates linearly
+/// with a two-tap tent when enlarging, CUBIC and LANCZOS included.
+class StreamResizer
+{
+public:
+    /// @brief Called with every completed output row, in order
+    typedef std::function<void(const uchar *row)> RowCallback;
+
+    /// @brief Create a resizer
+    /// @param source_size size of the source image
+    /// @param channels interleaved 8-bit channels of source and output rows
+    /// @param target_size size of the output image
+    /// @param interpolation resampling filter
+    StreamResizer(const cv::Size &source_size, int channels, const cv::Size &target_size, Interpolation interpolation);
+
+    /// @brief Feed the next source row
+    /// @param row source_size.width * channels bytes
+    /// @param emit called for every output row this row completes
+    void push_row(const uchar *row, const RowCallback &emit);
+
+    /// @brief Whether every output row was emitted
+    bool done() const { return next_output_ == target_size_.height; }
+
+private:
+    /// @brief Source samples and weights of every output sample along one axis
+    struct Taps
+    {
+        std::vector<int> first;
+        std::vector<int> count;
+        std::vector<int> offset;
+        std::vector<float> weights;
+    };
+
+    static Taps make_taps(int source, int target, Interpolation interpolation);
+
+    cv::Size source_size_;
+    cv::Size target_size_;
+    int channels_;
+    Taps columns_;
+    Taps rows_;
+
+    int next_source_ = 0;
+    int next_output_ = 0;
+    int next_active_ = 0;
+
+    std::vector<float> resized_row_;
+    std::vector<uchar> output_row_;
+
+    /// @brief Accumulators of output rows next_output_ to next_active_ - 1
+    std::deque<std::vector<float>> active_;
+    std::vector<std::vector<float>> spare_;
+};
+
+/// @brief Decode, resize and encode a large JPEG or PNG strip by strip
+///
+/// Peak memory is the outputs plus a strip of source rows, whatever the
+/// source size. JPEG and PNG outputs are encoded row by row as well, other
+/// formats are collected into an image of the output size and handed to codec.
+///
+/// @param data encoded image bytes
+/// @param length number of bytes
+/// @param sizes target sizes
+/// @param interpolation resampling filter
+/// @param format output format
+/// @param quality 1 to 100, -1 for the encoder default
+/// @param effort 0 to 9, -1 for the encoder default
+/// @param codec encoder of the formats not streamed
+/// @param outputs one encoded image per target size
+/// @return false if the source is not an 8-bit, non-interlaced JPEG or PNG, or is corrupt
+bool stream_resize(const unsigned char *data, std::size_t length, const std::vector<cv::Size> &sizes, Interpolation interpolation,
+                   OutputFormat format, int quality, int effort, ImageCodec &codec, std::vector<std::vector<uchar>> &outputs);
+
+#endif
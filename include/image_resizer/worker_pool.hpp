@@ -0,0 +1,105 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Order in which a WorkerPool runs queued tasks
+struct SchedulerOptions
+{
+    /// @brief Cost a queued task is credited per millisecond of waiting
+    ///
+    /// Tasks run cheapest first, a task posted t milliseconds earlier than
+    /// another one runs first unless it costs more than t times this value
+    /// extra. 0 runs strictly cheapest first, a large value in arrival order.
+    std::uint64_t aging_per_ms = 256 * 1024;
+
+    /// @brief Workers running only tasks of at most small_task_cost, always less than the pool size
+    std::size_t reserved_workers = 0;
+
+    /// @brief Largest cost of a task the reserved workers run
+    std::uint64_t small_task_cost = 4 * 1024 * 1024;
+};
+
+/// @brief Fixed size pool of OS threads for CPU bound work
+///
+/// Tasks are queued in a bounded queue so that a burst of requests is turned
+/// away instead of piling up unbounded latency and memory. Queued tasks run
+/// shortest job first: the cheapest task, after crediting its waiting time,
+/// goes first, so that small requests are not stuck behind large ones while
+/// large ones still run once they waited long enough.
+class WorkerPool
+{
+public:
+    /// @brief Start the worker threads
+    /// @param num_workers number of threads, 0 to use every hardware thread
+    /// @param queue_capacity maximum queued tasks, 0 for four per worker
+    /// @param scheduling order of the queued tasks
+    explicit WorkerPool(std::size_t num_workers = 0, std::size_t queue_capacity = 0, const SchedulerOptions &scheduling = SchedulerOptions());
+
+    /// @brief Run every queued task, then join the workers
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &obj) = delete;
+    WorkerPool &operator=(const WorkerPool &obj) = delete;
+
+    /// @brief Queue a task without blocking the caller
+    /// @param task function to run on a worker thread, must not throw
+    /// @param cost estimated work, e.g. pixels processed, tasks of equal cost run in arrival order
+    /// @return false if the queue is full or the pool is stopping
+    bool try_post(std::function<void()> task, std::uint64_t cost = 0);
+
+    /// @brief Number of worker threads
+    std::size_t size() const { return workers_.size(); }
+
+    /// @brief Number of workers running only small tasks
+    std::size_t reserved() const { return scheduling_.reserved_workers; }
+
+    /// @brief Maximum number of queued tasks
+    std::size_t capacity() const { return queue_capacity_; }
+
+    /// @brief Number of tasks waiting for a worker
+    std::size_t pending() const;
+
+private:
+    struct Task
+    {
+        /// @brief Cost plus the credit of the time since start_, lowest runs first
+        ///
+        /// Waiting credits every queued task equally, so this static key
+        /// orders tasks as their cost minus their waiting credit would.
+        double priority;
+        std::uint64_t sequence;
+        std::function<void()> run;
+    };
+
+    /// @brief Heap ordering putting the lowest priority first
+    static bool runs_later(const Task &lhs, const Task &rhs);
+
+    static void push(std::vector<Task> &queue, Task task);
+    static std::function<void()> pop(std::vector<Task> &queue);
+
+    void worker_loop(bool reserved);
+
+    std::vector<std::thread> workers_;
+    SchedulerOptions scheduling_;
+    std::chrono::steady_clock::time_point start_;
+
+    // Heaps of the tasks a reserved worker may run and of the others
+    std::vector<Task> small_tasks_;
+    std::vector<Task> large_tasks_;
+    std::uint64_t next_sequence_;
+    std::size_t queue_capacity_;
+    bool stopping_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+};
+
+#endif
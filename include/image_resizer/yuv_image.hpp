@@ -0,0 +1,37 @@
+#ifndef YUV_IMAGE_HPP
+#define YUV_IMAGE_HPP
+
+#include <vector>
+#include <opencv2/core.hpp>
+#include "image_resizer/interpolation.hpp"
+
+/// @brief Image kept as the separate Y, Cb and Cr planes of a JPEG
+///
+/// Chroma planes are subsampled by chroma_factor, e.g. 2x2 for 4:2:0, and
+/// span ceil(size / chroma_factor) samples. The luma plane is padded to a
+/// multiple of chroma_factor with copies of its last column and row, which
+/// is the layout libjpeg-turbo reads and writes planes in.
+struct YuvImage
+{
+    /// @brief Y, Cb then Cr, only Y for grayscale
+    std::vector<cv::Mat> planes;
+
+    /// @brief Size of the image, without the luma padding
+    cv::Size size;
+
+    /// @brief Horizontal and vertical chroma subsampling
+    cv::Size chroma_factor{1, 1};
+};
+
+/// @brief Resize every plane of an image, keeping its chroma subsampling
+///
+/// Each plane is resized on its own with resample_image, so subsampled
+/// chroma is resized at its own, smaller, resolution.
+///
+/// @param src source image
+/// @param dst resized image
+/// @param size target size
+/// @param interpolation resampling filter
+void resample_yuv(const YuvImage &src, YuvImage &dst, const cv::Size &size, Interpolation interpolation);
+
+#endif
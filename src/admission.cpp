@@ -0,0 +1,182 @@
+#include "image_resizer/admission.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "image_resizer/base64.hpp"
+
+// Decoded pixels assumed per encoded byte when the header can not be read,
+// generous for photographs so that unknown payloads are not underestimated
+static const std::uint64_t unknown_pixels_per_byte = 8;
+
+// Base64 characters decoded to look for a header, enough for the EXIF and
+// ICC segments preceding the frame header of most JPEGs
+static const std::size_t base64_peek_length = 64 * 1024 / 3 * 4;
+
+AdmissionController::AdmissionController(std::uint64_t pixel_budget, std::uint64_t byte_budget, std::size_t max_waiting, std::size_t stream_min_pixels)
+    : pixel_budget_(pixel_budget), byte_budget_(byte_budget), max_waiting_(max_waiting), stream_min_pixels_(stream_min_pixels)
+{
+}
+
+RequestCost AdmissionController::estimate(const unsigned char *data, std::size_t length, std::uint64_t output_pixels) const
+{
+    ImageHeader header;
+    bool found = peek_image_header(data, length, header);
+    return estimate(found ? &header : nullptr, length, output_pixels);
+}
+
+RequestCost AdmissionController::estimate_base64(const char *encoded, std::size_t length, std::uint64_t output_pixels) const
+{
+    std::size_t peek_length = std::min(length, base64_peek_length) / 4 * 4;
+    std::vector<unsigned char> prefix(base64_decoded_length(peek_length));
+
+    ImageHeader header;
+    bool found = false;
+    try
+    {
+        std::size_t decoded = base64_decode(encoded, peek_length, prefix.data());
+        found = peek_image_header(prefix.data(), decoded, header);
+    }
+    catch (const std::runtime_error &)
+    {
+        // Rejected later by the resizer, estimated from its size meanwhile
+    }
+
+    std::uint64_t decoded_length = base64_decoded_length(length);
+    RequestCost cost = estimate(found ? &header : nullptr, decoded_length, output_pixels);
+    cost.bytes += decoded_length;
+    return cost;
+}
+
+RequestCost AdmissionController::estimate(const ImageHeader *header, std::uint64_t encoded_bytes, std::uint64_t output_pixels) const
+{
+    std::uint64_t source_pixels = encoded_bytes * unknown_pixels_per_byte;
+    std::uint64_t pixel_bytes = 3;
+    bool streamed = false;
+    if (header != nullptr)
+    {
+        source_pixels = static_cast<std::uint64_t>(header->width) * static_cast<std::uint64_t>(header->height);
+        pixel_bytes = header->channels == 4 ? 4 : 3;
+        streamed = stream_min_pixels_ > 0 && source_pixels >= stream_min_pixels_;
+    }
+
+    RequestCost cost;
+    // Every source pixel is decoded, every output pixel resized then encoded
+    cost.pixels = source_pixels + 2 * output_pixels;
+
+    // Decoded source, or a strip of it when streamed, then the resized
+    // outputs and their encoded copies
+    std::uint64_t source_bytes = source_pixels * pixel_bytes;
+    if (streamed)
+        source_bytes = static_cast<std::uint64_t>(header->width) * pixel_bytes * 16;
+    cost.bytes = source_bytes + 2 * output_pixels * pixel_bytes;
+    return cost;
+}
+
+RequestCost AdmissionController::clamp(const RequestCost &cost) const
+{
+    RequestCost clamped = cost;
+    if (pixel_budget_ > 0)
+        clamped.pixels = std::min(clamped.pixels, pixel_budget_);
+    if (byte_budget_ > 0)
+        clamped.bytes = std::min(clamped.bytes, byte_budget_);
+    return clamped;
+}
+
+bool AdmissionController::fits(const RequestCost &cost) const
+{
+    return (pixel_budget_ == 0 || pixels_in_use_ + cost.pixels <= pixel_budget_) &&
+           (byte_budget_ == 0 || bytes_in_use_ + cost.bytes <= byte_budget_);
+}
+
+AdmissionController::Result AdmissionController::acquire(const RequestCost &cost, std::function<void()> on_admit, std::uint64_t &ticket)
+{
+    RequestCost clamped = clamp(cost);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Arrivals queue behind waiting requests even when they would fit
+    if (waiting_.empty() && fits(clamped))
+    {
+        pixels_in_use_ += clamped.pixels;
+        bytes_in_use_ += clamped.bytes;
+        ++admitted_;
+        return Result::ADMITTED;
+    }
+
+    if (waiting_.size() >= max_waiting_)
+    {
+        ++rejected_;
+        return Result::REJECTED;
+    }
+
+    ticket = next_ticket_++;
+    waiting_.push_back(Waiter{ticket, clamped, std::move(on_admit)});
+    ++queued_;
+    return Result::QUEUED;
+}
+
+bool AdmissionController::cancel(std::uint64_t ticket)
+{
+    std::vector<std::function<void()>> admitted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto waiter = std::find_if(waiting_.begin(), waiting_.end(), [ticket](const Waiter &waiter)
+                                   { return waiter.ticket == ticket; });
+        if (waiter == waiting_.end())
+            return false;
+
+        // Requests behind a cancelled head may fit already
+        waiting_.erase(waiter);
+        ++timed_out_;
+        admit_waiting(admitted);
+    }
+
+    for (auto &on_admit : admitted)
+        on_admit();
+    return true;
+}
+
+void AdmissionController::release(const RequestCost &cost)
+{
+    RequestCost clamped = clamp(cost);
+    std::vector<std::function<void()>> admitted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pixels_in_use_ -= std::min(pixels_in_use_, clamped.pixels);
+        bytes_in_use_ -= std::min(bytes_in_use_, clamped.bytes);
+
+        admit_waiting(admitted);
+    }
+
+    for (auto &on_admit : admitted)
+        on_admit();
+}
+
+void AdmissionController::admit_waiting(std::vector<std::function<void()>> &admitted)
+{
+    while (!waiting_.empty() && fits(waiting_.front().cost))
+    {
+        Waiter &waiter = waiting_.front();
+        pixels_in_use_ += waiter.cost.pixels;
+        bytes_in_use_ += waiter.cost.bytes;
+        ++admitted_;
+        admitted.push_back(std::move(waiter.on_admit));
+        waiting_.pop_front();
+    }
+}
+
+AdmissionController::Stats AdmissionController::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.admitted = admitted_;
+    stats.queued = queued_;
+    stats.rejected = rejected_;
+    stats.timed_out = timed_out_;
+    stats.waiting = waiting_.size();
+    stats.pixels_in_use = pixels_in_use_;
+    stats.bytes_in_use = bytes_in_use_;
+    stats.pixel_budget = pixel_budget_;
+    stats.byte_budget = byte_budget_;
+    return stats;
+}
@@ -0,0 +1,340 @@
+#include "image_resizer/app.hpp"
+#include <thread>
+
+uint16_t getCode(const HTTP_CODE &code)
+{
+    return std::get<0>(code);
+}
+
+std::string getReason(const HTTP_CODE &code)
+{
+    return std::get<1>(code);
+}
+
+void append_status(std::string &body, uint16_t code, const char *message)
+{
+    // Serialized on the stack, this runs for every successful request
+    alignas(16) char stack_buffer[1024];
+    rapidjson::MemoryPoolAllocator<> allocator(stack_buffer, sizeof(stack_buffer));
+    typedef rapidjson::GenericStringBuffer<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>> StackStringBuffer;
+    StackStringBuffer buffer(&allocator, 128);
+    rapidjson::Writer<StackStringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>> writer(buffer, &allocator, 4);
+    writer.StartObject();
+    writer.Key("code");
+    writer.Uint(code);
+    writer.Key("message");
+    writer.String(message);
+    writer.EndObject();
+
+    // Merge both objects in place: drop the closing brace of body and the
+    // opening brace of the status members
+    body.back() = ',';
+    body.append(buffer.GetString() + 1, buffer.GetSize() - 1);
+}
+
+std::string error_json(uint16_t code, const std::string &message)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("code");
+    writer.Uint(code);
+    writer.Key("Message");
+    writer.String(message.c_str(), static_cast<rapidjson::SizeType>(message.size()));
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+boost::fibers::future<Error> post_to_worker(WorkerPool &pool, std::function<Error()> func, std::uint64_t cost)
+{
+    // The task keeps the shared state alive until set_value has returned
+    auto promise = std::make_shared<boost::fibers::promise<Error>>();
+    boost::fibers::future<Error> future = promise->get_future();
+
+    bool queued = pool.try_post([promise, func]()
+                                {
+                                    try
+                                    {
+                                        promise->set_value(func());
+                                    }
+                                    catch (const std::exception &err)
+                                    {
+                                        promise->set_value(Error(Error::Code::FAILED, err.what()));
+                                    } },
+                                cost);
+    if (!queued)
+        return boost::fibers::future<Error>();
+
+    return future;
+}
+
+HTTP_CODE validate_fields(const rapidjson::Value &doc)
+{
+    if (!doc.IsObject())
+    {
+        return std::make_tuple(400, "request must be a json object.");
+    }
+    else if (!doc.HasMember("input_jpeg"))
+    {
+        return std::make_tuple(400, "input_jpeg is not available in data.");
+    }
+    else if (!doc["input_jpeg"].IsString())
+    {
+        return std::make_tuple(400, "input_jpeg must be a base64 encoded string.");
+    }
+    else if (!doc.HasMember("sizes"))
+    {
+        // Without a list of target sizes, desired_width and desired_height are required
+        if (!doc.HasMember("desired_width"))
+        {
+            return std::make_tuple(400, "desired_width is not available in data.");
+        }
+        else if (!doc.HasMember("desired_height"))
+        {
+            return std::make_tuple(400, "desired_height is not available in data.");
+        }
+        else if (!doc["desired_width"].IsInt() || !doc["desired_height"].IsInt())
+        {
+            return std::make_tuple(400, "desired_width and desired_height must be integers.");
+        }
+    }
+
+    // Refused here, before the request is admitted and queued, the optional
+    // fields are client mistakes like the missing ones
+    Error options_code = ImageResizer::validate_options(doc);
+    if (!options_code.IsOk())
+    {
+        return std::make_tuple(400, options_code.Message());
+    }
+
+    return std::make_tuple(200, "");
+}
+
+bool parse_dimension(const std::string &str, int &value)
+{
+    char *end = nullptr;
+    long parsed = std::strtol(str.c_str(), &end, 10);
+    if (str.empty() || *end != '\0' || parsed <= 0 || parsed > ResizeOptions::max_dimension)
+        return false;
+
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+boost::fibers::future<Error> post_request(const AppContext &ctx, ResizePipeline::DecodeFunction decode, std::string &output, std::uint64_t cost)
+{
+    if (!ctx.pipeline)
+    {
+        std::shared_ptr<ImageResizer> resizer = ctx.image_resizer;
+        return post_to_worker(*ctx.worker_pool, [resizer, decode, &output]()
+                              {
+                                  ResizeJob job;
+                                  Error status = decode(*resizer, job);
+                                  if (status.IsOk())
+                                  {
+                                      resizer->resize(job);
+                                      status = resizer->encode(job, output);
+                                  }
+                                  return status; },
+                              cost);
+    }
+
+    // The callback keeps the shared state alive until set_value has returned
+    auto promise = std::make_shared<boost::fibers::promise<Error>>();
+    boost::fibers::future<Error> future = promise->get_future();
+    bool queued = ctx.pipeline->try_submit(std::move(decode), output, [promise](const Error &status)
+                                           { promise->set_value(status); });
+    if (!queued)
+        return boost::fibers::future<Error>();
+
+    return future;
+}
+
+bool run_request(const AppContext &ctx, ResizePipeline::DecodeFunction decode, std::string &output, std::uint64_t cost, Error &result)
+{
+    boost::fibers::future<Error> future = post_request(ctx, std::move(decode), output, cost);
+    if (!future.valid())
+        return false;
+
+    // Suspends the fiber only, other connections keep being served
+    result = future.get();
+    return true;
+}
+
+std::uint64_t requested_pixels(const rapidjson::Value &doc)
+{
+    auto area = [](const rapidjson::Value &object, const char *width, const char *height) -> std::uint64_t
+    {
+        rapidjson::Value::ConstMemberIterator w = object.FindMember(width);
+        rapidjson::Value::ConstMemberIterator h = object.FindMember(height);
+        if (w == object.MemberEnd() || h == object.MemberEnd() || !w->value.IsUint() || !h->value.IsUint())
+            return 0;
+        return static_cast<std::uint64_t>(w->value.GetUint()) * h->value.GetUint();
+    };
+
+    rapidjson::Value::ConstMemberIterator sizes = doc.FindMember("sizes");
+    if (sizes == doc.MemberEnd())
+        return area(doc, "desired_width", "desired_height");
+
+    std::uint64_t pixels = 0;
+    if (sizes->value.IsArray())
+    {
+        for (rapidjson::SizeType i = 0; i < sizes->value.Size(); ++i)
+        {
+            if (sizes->value[i].IsObject())
+                pixels += area(sizes->value[i], "width", "height");
+        }
+    }
+    return pixels;
+}
+
+RequestCost estimate_cost(const AppContext &ctx, const rapidjson::Value &doc)
+{
+    const rapidjson::Value &input = doc["input_jpeg"];
+    return ctx.admission->estimate_base64(input.GetString(), input.GetStringLength(), requested_pixels(doc));
+}
+
+bool admit(const AppContext &ctx, const RequestCost &cost)
+{
+    // The callback keeps the shared state alive when it runs after a timeout
+    auto promise = std::make_shared<boost::fibers::promise<void>>();
+    boost::fibers::future<void> admitted = promise->get_future();
+    std::uint64_t ticket = 0;
+
+    AdmissionController::Result result = ctx.admission->acquire(cost, [promise]()
+                                                                { promise->set_value(); },
+                                                                ticket);
+    if (result != AdmissionController::Result::QUEUED)
+        return result == AdmissionController::Result::ADMITTED;
+
+    if (admitted.wait_for(std::chrono::milliseconds(ctx.config.admission_wait_ms)) == boost::fibers::future_status::ready)
+        return true;
+
+    // Admitted between the timeout and the cancellation otherwise
+    return !ctx.admission->cancel(ticket);
+}
+
+void append_cache_metrics(std::string &output, const ResultCache::Stats &stats)
+{
+    std::stringstream metrics;
+    metrics << "# HELP image_resizer_cache_hits_total Requests answered from the result cache.\n"
+            << "# TYPE image_resizer_cache_hits_total counter\n"
+            << "image_resizer_cache_hits_total " << stats.hits << "\n"
+            << "# HELP image_resizer_cache_misses_total Requests not found in the result cache.\n"
+            << "# TYPE image_resizer_cache_misses_total counter\n"
+            << "image_resizer_cache_misses_total " << stats.misses << "\n"
+            << "# HELP image_resizer_cache_evictions_total Responses evicted from the result cache.\n"
+            << "# TYPE image_resizer_cache_evictions_total counter\n"
+            << "image_resizer_cache_evictions_total " << stats.evictions << "\n"
+            << "# HELP image_resizer_cache_entries Responses held by the result cache.\n"
+            << "# TYPE image_resizer_cache_entries gauge\n"
+            << "image_resizer_cache_entries " << stats.entries << "\n"
+            << "# HELP image_resizer_cache_bytes Memory used by the result cache.\n"
+            << "# TYPE image_resizer_cache_bytes gauge\n"
+            << "image_resizer_cache_bytes " << stats.bytes << "\n";
+    output.append(metrics.str());
+}
+
+void append_admission_metrics(std::string &output, const AdmissionController::Stats &stats)
+{
+    std::stringstream metrics;
+    metrics << "# HELP image_resizer_admission_admitted_total Requests admitted, at once or after waiting.\n"
+            << "# TYPE image_resizer_admission_admitted_total counter\n"
+            << "image_resizer_admission_admitted_total " << stats.admitted << "\n"
+            << "# HELP image_resizer_admission_queued_total Requests that waited for admission.\n"
+            << "# TYPE image_resizer_admission_queued_total counter\n"
+            << "image_resizer_admission_queued_total " << stats.queued << "\n"
+            << "# HELP image_resizer_admission_shed_total Requests answered 503 without being admitted, by reason.\n"
+            << "# TYPE image_resizer_admission_shed_total counter\n"
+            << "image_resizer_admission_shed_total{reason=\"queue_full\"} " << stats.rejected << "\n"
+            << "image_resizer_admission_shed_total{reason=\"timeout\"} " << stats.timed_out << "\n"
+            << "# HELP image_resizer_admission_waiting Requests waiting for admission.\n"
+            << "# TYPE image_resizer_admission_waiting gauge\n"
+            << "image_resizer_admission_waiting " << stats.waiting << "\n"
+            << "# HELP image_resizer_admission_pixels Pixels charged by admitted requests.\n"
+            << "# TYPE image_resizer_admission_pixels gauge\n"
+            << "image_resizer_admission_pixels " << stats.pixels_in_use << "\n"
+            << "# HELP image_resizer_admission_pixels_budget Pixels admitted requests may charge, 0 for no limit.\n"
+            << "# TYPE image_resizer_admission_pixels_budget gauge\n"
+            << "image_resizer_admission_pixels_budget " << stats.pixel_budget << "\n"
+            << "# HELP image_resizer_admission_bytes Memory charged by admitted requests.\n"
+            << "# TYPE image_resizer_admission_bytes gauge\n"
+            << "image_resizer_admission_bytes " << stats.bytes_in_use << "\n"
+            << "# HELP image_resizer_admission_bytes_budget Memory admitted requests may charge, 0 for no limit.\n"
+            << "# TYPE image_resizer_admission_bytes_budget gauge\n"
+            << "image_resizer_admission_bytes_budget " << stats.byte_budget << "\n";
+    output.append(metrics.str());
+}
+
+void append_pipeline_metrics(std::string &output, const std::vector<ResizePipeline::StageStats> &stats)
+{
+    std::stringstream metrics;
+    metrics << "# HELP image_resizer_pipeline_threads Threads of each pipeline stage.\n"
+            << "# TYPE image_resizer_pipeline_threads gauge\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_threads{stage=\"" << stage.name << "\"} " << stage.threads << "\n";
+    metrics << "# HELP image_resizer_pipeline_busy_threads Threads of each pipeline stage running a request.\n"
+            << "# TYPE image_resizer_pipeline_busy_threads gauge\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_busy_threads{stage=\"" << stage.name << "\"} " << stage.busy << "\n";
+    metrics << "# HELP image_resizer_pipeline_queued Requests waiting for each pipeline stage.\n"
+            << "# TYPE image_resizer_pipeline_queued gauge\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_queued{stage=\"" << stage.name << "\"} " << stage.queued << "\n";
+    metrics << "# HELP image_resizer_pipeline_queue_capacity Requests each pipeline stage may have waiting.\n"
+            << "# TYPE image_resizer_pipeline_queue_capacity gauge\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_queue_capacity{stage=\"" << stage.name << "\"} " << stage.capacity << "\n";
+    metrics << "# HELP image_resizer_pipeline_jobs_total Requests each pipeline stage finished.\n"
+            << "# TYPE image_resizer_pipeline_jobs_total counter\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_jobs_total{stage=\"" << stage.name << "\"} " << stage.jobs << "\n";
+    metrics << "# HELP image_resizer_pipeline_busy_seconds_total Time the threads of each pipeline stage spent on requests.\n"
+            << "# TYPE image_resizer_pipeline_busy_seconds_total counter\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_busy_seconds_total{stage=\"" << stage.name << "\"} " << stage.busy_ns / 1e9 << "\n";
+    metrics << "# HELP image_resizer_pipeline_blocked_seconds_total Time the threads of each pipeline stage waited for the next stage.\n"
+            << "# TYPE image_resizer_pipeline_blocked_seconds_total counter\n";
+    for (const ResizePipeline::StageStats &stage : stats)
+        metrics << "image_resizer_pipeline_blocked_seconds_total{stage=\"" << stage.name << "\"} " << stage.blocked_ns / 1e9 << "\n";
+    output.append(metrics.str());
+}
+
+std::shared_ptr<AppContext> make_app_context(const AppConfig &config)
+{
+    auto ctx = std::make_shared<AppContext>();
+    ctx->config = config;
+    ctx->result_cache = std::make_shared<ResultCache>(ctx->config.cache_bytes);
+    ctx->metrics = std::make_shared<Metrics>();
+    ctx->image_resizer = std::make_shared<ImageResizer>(ctx->result_cache, ctx->metrics, ctx->config.stream_min_pixels,
+                                                        ctx->config.parallel_jpeg_pixels);
+
+    std::size_t workers;
+    if (ctx->config.pipeline != 0)
+    {
+        PipelineOptions pipeline_options;
+        pipeline_options.decode_threads = ctx->config.decode_threads;
+        pipeline_options.resize_threads = ctx->config.resize_threads;
+        pipeline_options.encode_threads = ctx->config.encode_threads;
+        pipeline_options.queue_capacity = ctx->config.worker_queue_size;
+        ctx->pipeline = std::make_shared<ResizePipeline>(ctx->image_resizer, pipeline_options);
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    else
+    {
+        SchedulerOptions scheduling;
+        scheduling.aging_per_ms = ctx->config.aging_pixels_per_ms;
+        scheduling.reserved_workers = ctx->config.reserved_workers;
+        scheduling.small_task_cost = ctx->config.small_job_pixels;
+        ctx->worker_pool = std::make_shared<WorkerPool>(ctx->config.worker_threads, ctx->config.worker_queue_size, scheduling);
+        workers = ctx->worker_pool->size();
+    }
+
+    std::size_t admission_pixels = ctx->config.admission_pixels;
+    if (admission_pixels == AppConfig::admission_pixels_per_worker)
+        admission_pixels = workers * 32 * 1024 * 1024;
+    ctx->admission = std::make_shared<AdmissionController>(admission_pixels, ctx->config.admission_bytes,
+                                                           ctx->config.admission_queue_size, ctx->config.stream_min_pixels);
+
+    return ctx;
+}
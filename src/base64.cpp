@@ -1,105 +1,380 @@
 #include "image_resizer/base64.hpp"
+#include <cstdint>
 #include <stdexcept>
 
-static const std::string base64_chars = {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static const char base64_chars[] = {
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/"};
 
-static unsigned char pos_char_table(const unsigned char chr)
+static const unsigned char invalid_char = 0xff;
+
+/// @brief Map every input byte to its 6-bit value, invalid_char otherwise
+struct DecodeTable
 {
+    unsigned char values[256];
+
+    DecodeTable()
+    {
+        for (int i = 0; i < 256; ++i)
+            values[i] = invalid_char;
+        for (int i = 0; i < 64; ++i)
+            values[static_cast<unsigned char>(base64_chars[i])] = static_cast<unsigned char>(i);
+    }
+};
+
+static const DecodeTable decode_table;
 
-    if (chr >= 'A' && chr <= 'Z')
-        return chr - 'A';
-    else if (chr >= 'a' && chr <= 'z')
-        return chr - 'a' + ('Z' - 'A') + 1;
-    else if (chr >= '0' && chr <= '9')
-        return chr - '0' + ('Z' - 'A') + ('z' - 'a') + 2;
-    else if (chr == '+')
-        return 62;
-    else if (chr == '/')
-        return 63;
-    else
-        throw std::runtime_error("Input is not valid base64-encoded data.");
+static void throw_invalid_input()
+{
+    throw std::runtime_error("Input is not valid base64-encoded data.");
 }
 
-std::string base64_encode(std::string const &bytes_string)
+static inline unsigned char pos_char_table(const char chr)
 {
-    if (bytes_string.empty())
-        return std::string();
+    unsigned char value = decode_table.values[static_cast<unsigned char>(chr)];
+    if (value == invalid_char)
+        throw_invalid_input();
+    return value;
+}
 
-    int str_length = bytes_string.length();
-    int enc_length = (str_length + 2) / 3 * 4;
+static std::size_t encode_scalar(const unsigned char *src, std::size_t length, char *out)
+{
+    char *dst = out;
+    std::size_t i = 0;
 
-    std::string enc;
-    enc.reserve(enc_length);
+    for (; i + 3 <= length; i += 3)
+    {
+        std::uint32_t triple = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+        dst[0] = base64_chars[(triple >> 18) & 0x3f];
+        dst[1] = base64_chars[(triple >> 12) & 0x3f];
+        dst[2] = base64_chars[(triple >> 6) & 0x3f];
+        dst[3] = base64_chars[triple & 0x3f];
+        dst += 4;
+    }
 
-    for (int i = 0; i < str_length; i += 3)
+    if (i + 1 == length)
     {
-        unsigned char b0 = base64_chars[(bytes_string[i] & 0xfc) >> 2];
-        enc.push_back(b0);
+        // Pad with double trailling
+        dst[0] = base64_chars[(src[i] & 0xfc) >> 2];
+        dst[1] = base64_chars[(src[i] & 0x03) << 4];
+        dst[2] = '=';
+        dst[3] = '=';
+        dst += 4;
+    }
+    else if (i + 2 == length)
+    {
+        // Pad last with trailing
+        dst[0] = base64_chars[(src[i] & 0xfc) >> 2];
+        dst[1] = base64_chars[((src[i] & 0x03) << 4) + ((src[i + 1] & 0xf0) >> 4)];
+        dst[2] = base64_chars[(src[i + 1] & 0x0f) << 2];
+        dst[3] = '=';
+        dst += 4;
+    }
+
+    return dst - out;
+}
+
+static std::size_t decode_scalar(const char *src, std::size_t length, unsigned char *out)
+{
+    unsigned char *dst = out;
+    std::size_t i = 0;
+
+    // Fast path: complete quadruplets without padding
+    for (; i + 4 <= length; i += 4)
+    {
+        const unsigned char *values = decode_table.values;
+        unsigned char b0 = values[static_cast<unsigned char>(src[i])];
+        unsigned char b1 = values[static_cast<unsigned char>(src[i + 1])];
+        unsigned char b2 = values[static_cast<unsigned char>(src[i + 2])];
+        unsigned char b3 = values[static_cast<unsigned char>(src[i + 3])];
+        if ((b0 | b1 | b2 | b3) == invalid_char)
+            break;
+
+        dst[0] = static_cast<unsigned char>(b0 << 2 | b1 >> 4);
+        dst[1] = static_cast<unsigned char>(b1 << 4 | b2 >> 2);
+        dst[2] = static_cast<unsigned char>(b2 << 6 | b3);
+        dst += 3;
+    }
 
-        if (i + 1 < str_length)
+    // Slow path: padding, truncated quadruplets and invalid characters
+    for (; i < length; i += 4)
+    {
+        if (i + 1 >= length)
+            throw_invalid_input();
+
+        unsigned char b0 = pos_char_table(src[i]);
+        unsigned char b1 = pos_char_table(src[i + 1]);
+        *dst++ = static_cast<unsigned char>(b0 << 2 | ((b1 & 0xF0) >> 4));
+
+        if ((i + 2 < length) && (src[i + 2] != '='))
         {
-            unsigned char b1 = base64_chars[((bytes_string[i] & 0x03) << 4) + ((bytes_string[i + 1] & 0xf0) >> 4)];
-            enc.push_back(b1);
+            unsigned char b2 = pos_char_table(src[i + 2]);
+            *dst++ = static_cast<unsigned char>(((b1 & 0x0f) << 4) + ((b2 & 0x3c) >> 2));
 
-            if (i + 2 < str_length)
+            if ((i + 3 < length) && (src[i + 3] != '='))
             {
-                unsigned char b2 = base64_chars[((bytes_string[i + 1] & 0x0f) << 2) + ((bytes_string[i + 2] & 0xc0) >> 6)];
-                unsigned char b3 = base64_chars[bytes_string[i + 2] & 0x3f];
-                enc.push_back(b2);
-                enc.push_back(b3);
+                *dst++ = static_cast<unsigned char>(((b2 & 0x03) << 6) + pos_char_table(src[i + 3]));
             }
-            else
-            {
-                // Pad last with trailing
-                unsigned char b2 = base64_chars[(bytes_string[i + 1] & 0x0f) << 2];
-                enc.push_back(b2);
-                enc.push_back('=');
-            }
-        }
-        else
-        {
-            // Pad with double trailling
-            unsigned char b1 = base64_chars[(bytes_string[i] & 0x03) << 4];
-            enc.push_back(b1);
-            enc.push_back('=');
-            enc.push_back('=');
         }
     }
 
-    return enc;
+    return dst - out;
 }
 
-std::string base64_decode(std::string const &encoded_string)
+#ifdef BASE64_X86_SIMD
+
+// Vectorized codecs follow Wojciech Muła's pshufb based translation: 12 input
+// bytes per 128-bit lane are split into 16 sextets and mapped to ASCII (and
+// back) with nibble-indexed lookup tables. Any block holding a character the
+// tables reject, including padding, is left to the scalar path so that errors
+// and padding behave exactly as in the scalar codec.
+
+__attribute__((target("sse4.1"))) static inline __m128i enc_reshuffle(__m128i in)
 {
-    if (encoded_string.empty())
-        return std::string();
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
 
-    int str_length = encoded_string.length();
-    int dec_length = str_length / 4 * 3;
-    std::string dec;
-    dec.reserve(dec_length);
+__attribute__((target("sse4.1"))) static inline __m128i enc_translate(__m128i indices)
+{
+    const __m128i shift_lut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    result = _mm_shuffle_epi8(shift_lut, result);
+    return _mm_add_epi8(result, indices);
+}
+
+__attribute__((target("sse4.1"))) static std::size_t encode_sse41(const unsigned char *src, std::size_t length, char *out)
+{
+    std::size_t i = 0;
+    char *dst = out;
 
-    for (int i = 0; i < str_length; i += 4)
+    // Each step loads 16 bytes and consumes 12 of them
+    for (; i + 16 <= length; i += 12)
     {
-        unsigned char b0 = pos_char_table(encoded_string[i]);
-        unsigned char b1 = pos_char_table(encoded_string[i + 1]);
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), enc_translate(enc_reshuffle(in)));
+        dst += 16;
+    }
 
-        dec.push_back(static_cast<std::string::value_type>((b0 << 2 | ((b1 & 0xF0) >> 4))));
+    return (dst - out) + encode_scalar(src + i, length - i, dst);
+}
 
-        if ((i + 2 < str_length) && (encoded_string[i + 2] != '='))
-        {
-            unsigned char b2 = pos_char_table(encoded_string[i + 2]);
-            dec.push_back(static_cast<std::string::value_type>(((b1 & 0x0f) << 4) + ((b2 & 0x3c) >> 2)));
+__attribute__((target("avx2"))) static inline __m256i enc_reshuffle_avx2(__m256i in)
+{
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+                                     10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                     10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
 
-            if ((i + 3 < str_length) && (encoded_string[i + 3] != '='))
-            {
-                dec.push_back(static_cast<std::string::value_type>(((b2 & 0x03) << 6) + pos_char_table(encoded_string[i + 3])));
-            }
-        }
+__attribute__((target("avx2"))) static inline __m256i enc_translate_avx2(__m256i indices)
+{
+    const __m256i shift_lut = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    result = _mm256_shuffle_epi8(shift_lut, result);
+    return _mm256_add_epi8(result, indices);
+}
+
+__attribute__((target("avx2"))) static std::size_t encode_avx2(const unsigned char *src, std::size_t length, char *out)
+{
+    std::size_t i = 0;
+    char *dst = out;
+
+    // Each step loads 12 + 16 bytes and consumes 24 of them
+    for (; i + 28 <= length; i += 24)
+    {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), enc_translate_avx2(enc_reshuffle_avx2(in)));
+        dst += 32;
     }
 
+    return (dst - out) + encode_sse41(src + i, length - i, dst);
+}
+
+__attribute__((target("sse4.1"))) static std::size_t decode_sse41(const char *src, std::size_t length, unsigned char *out)
+{
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71,
+        0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i pack_shuffle = _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    std::size_t i = 0;
+    unsigned char *dst = out;
+
+    // The 16-byte store writes 4 bytes past the 12 decoded ones, keep enough
+    // input behind the block so that those bytes are still inside `out`
+    for (; i + 24 <= length; i += 16)
+    {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+        const __m128i lo_nibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+        const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm_testz_si128(lo, hi))
+            break;
+
+        const __m128i eq_2f = _mm_cmpeq_epi8(in, _mm_set1_epi8(0x2f));
+        const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        const __m128i values = _mm_add_epi8(in, roll);
+
+        const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_shuffle_epi8(packed, pack_shuffle));
+        dst += 12;
+    }
+
+    return (dst - out) + decode_scalar(src + i, length - i, dst);
+}
+
+__attribute__((target("avx2"))) static std::size_t decode_avx2(const char *src, std::size_t length, unsigned char *out)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71,
+        0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack_shuffle = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    std::size_t i = 0;
+    unsigned char *dst = out;
+
+    // Same reasoning as the SSE loop, the upper lane store overruns by 4 bytes
+    for (; i + 48 <= length; i += 32)
+    {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+        const __m256i lo_nibbles = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+
+        const __m256i eq_2f = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(0x2f));
+        const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        const __m256i values = _mm256_add_epi8(in, roll);
+
+        const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i packed = _mm256_shuffle_epi8(_mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000)), pack_shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12), _mm256_extracti128_si256(packed, 1));
+        dst += 24;
+    }
+
+    return (dst - out) + decode_sse41(src + i, length - i, dst);
+}
+
+#endif
+
+typedef std::size_t (*encode_fn)(const unsigned char *, std::size_t, char *);
+typedef std::size_t (*decode_fn)(const char *, std::size_t, unsigned char *);
+
+static encode_fn select_encoder()
+{
+#ifdef BASE64_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return encode_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return encode_sse41;
+#endif
+    return encode_scalar;
+}
+
+static decode_fn select_decoder()
+{
+#ifdef BASE64_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return decode_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return decode_sse41;
+#endif
+    return decode_scalar;
+}
+
+std::size_t base64_encoded_length(std::size_t length)
+{
+    return (length + 2) / 3 * 4;
+}
+
+std::size_t base64_decoded_length(std::size_t length)
+{
+    return (length + 3) / 4 * 3;
+}
+
+std::size_t base64_encode(const unsigned char *bytes, std::size_t length, char *out)
+{
+    static const encode_fn encode = select_encoder();
+    return encode(bytes, length, out);
+}
+
+std::size_t base64_decode(const char *encoded, std::size_t length, unsigned char *out)
+{
+    static const decode_fn decode = select_decoder();
+    return decode(encoded, length, out);
+}
+
+std::string base64_encode(std::string const &bytes_string)
+{
+    if (bytes_string.empty())
+        return std::string();
+
+    std::string enc(base64_encoded_length(bytes_string.length()), '\0');
+    enc.resize(base64_encode(reinterpret_cast<const unsigned char *>(bytes_string.data()), bytes_string.length(), &enc[0]));
+    return enc;
+}
+
+std::string base64_decode(std::string const &encoded_string)
+{
+    if (encoded_string.empty())
+        return std::string();
+
+    std::string dec(base64_decoded_length(encoded_string.length()), '\0');
+    dec.resize(base64_decode(encoded_string.data(), encoded_string.length(), reinterpret_cast<unsigned char *>(&dec[0])));
     return dec;
-}
\ No newline at end of file
+}
@@ -0,0 +1,258 @@
+#include "image_resizer/codec.hpp"
+#include "image_resizer/image_header.hpp"
+#include <limits>
+#include <opencv2/imgcodecs.hpp>
+#ifdef IMAGE_RESIZER_WITH_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+/// @brief Pick the cheapest cv::imdecode flags still producing at least target_size
+/// @param data encoded image bytes
+/// @param length number of bytes
+/// @param target_size size the decoded image is resized to
+/// @return IMREAD_REDUCED_* flags for JPEG sources larger than needed, IMREAD_UNCHANGED otherwise
+static int decode_flags(const uchar *data, std::size_t length, const cv::Size &target_size)
+{
+    // libjpeg scales by 1/2, 1/4 or 1/8 while decoding, other codecs
+    // would decode at full resolution and resize internally anyway
+    ImageHeader header;
+    if (!peek_image_header(data, length, header) || header.format != ImageHeader::Format::JPEG)
+        return cv::IMREAD_UNCHANGED;
+
+    if (header.channels != 1 && header.channels != 3)
+        return cv::IMREAD_UNCHANGED;
+
+    static const int scales[] = {8, 4, 2};
+    static const int grayscale_flags[] = {cv::IMREAD_REDUCED_GRAYSCALE_8, cv::IMREAD_REDUCED_GRAYSCALE_4, cv::IMREAD_REDUCED_GRAYSCALE_2};
+    static const int color_flags[] = {cv::IMREAD_REDUCED_COLOR_8, cv::IMREAD_REDUCED_COLOR_4, cv::IMREAD_REDUCED_COLOR_2};
+
+    for (int i = 0; i < 3; ++i)
+    {
+        int scale = scales[i];
+        if ((header.width + scale - 1) / scale >= target_size.width && (header.height + scale - 1) / scale >= target_size.height)
+        {
+            // IMREAD_UNCHANGED ignores EXIF orientation, reduced reads must too
+            int flags = header.channels == 1 ? grayscale_flags[i] : color_flags[i];
+            return flags | cv::IMREAD_IGNORE_ORIENTATION;
+        }
+    }
+
+    return cv::IMREAD_UNCHANGED;
+}
+
+bool OpenCVCodec::decode(const unsigned char *data, std::size_t length, const cv::Size &target_size, cv::Mat &image)
+{
+    // Header only, imdecode reads straight from the caller's buffer
+    cv::Mat buffer(1, static_cast<int>(length), CV_8UC1, const_cast<unsigned char *>(data));
+    cv::imdecode(buffer, decode_flags(data, length, target_size), &image);
+    return !image.empty();
+}
+
+bool OpenCVCodec::encode(const cv::Mat &image, OutputFormat format, int quality, int effort, std::vector<uchar> &buffer)
+{
+    return cv::imencode(output_format_extension(format), image, buffer, output_format_params(format, quality, effort));
+}
+
+#ifdef IMAGE_RESIZER_WITH_TURBOJPEG
+
+/// @brief TurboJPEG handles of the calling thread, created on first use
+struct TurboJpegHandles
+{
+    tjhandle decompressor = tjInitDecompress();
+    tjhandle compressor = tjInitCompress();
+
+    ~TurboJpegHandles()
+    {
+        if (decompressor != nullptr)
+            tjDestroy(decompressor);
+        if (compressor != nullptr)
+            tjDestroy(compressor);
+    }
+};
+
+static TurboJpegHandles &thread_handles()
+{
+    thread_local TurboJpegHandles handles;
+    return handles;
+}
+
+/// @brief Smallest libjpeg-turbo scaling factor still producing at least target_size
+static tjscalingfactor scaling_factor(int width, int height, const cv::Size &target_size)
+{
+    tjscalingfactor best = {1, 1};
+    int count = 0;
+    const tjscalingfactor *factors = tjGetScalingFactors(&count);
+    for (int i = 0; factors != nullptr && i < count; ++i)
+    {
+        const tjscalingfactor &factor = factors[i];
+        bool reduces = factor.num * best.denom < best.num * factor.denom;
+        if (reduces && TJSCALED(width, factor) >= target_size.width && TJSCALED(height, factor) >= target_size.height)
+            best = factor;
+    }
+    return best;
+}
+
+bool TurboJpegCodec::decode(const unsigned char *data, std::size_t length, const cv::Size &target_size, cv::Mat &image)
+{
+    tjhandle handle = thread_handles().decompressor;
+    bool jpeg = length >= 2 && data[0] == 0xFF && data[1] == 0xD8;
+    if (!jpeg || handle == nullptr || length > std::numeric_limits<unsigned long>::max())
+        return fallback_.decode(data, length, target_size, image);
+
+    // CMYK and YCCK are left to OpenCV, which converts them to BGR
+    int width, height, subsampling, colorspace;
+    if (tjDecompressHeader3(handle, data, static_cast<unsigned long>(length), &width, &height, &subsampling, &colorspace) != 0 ||
+        colorspace == TJCS_CMYK || colorspace == TJCS_YCCK)
+        return fallback_.decode(data, length, target_size, image);
+
+    tjscalingfactor factor = scaling_factor(width, height, target_size);
+    int scaled_width = TJSCALED(width, factor);
+    int scaled_height = TJSCALED(height, factor);
+    bool grayscale = colorspace == TJCS_GRAY;
+
+    image.create(scaled_height, scaled_width, grayscale ? CV_8UC1 : CV_8UC3);
+    if (tjDecompress2(handle, data, static_cast<unsigned long>(length), image.data, scaled_width, static_cast<int>(image.step),
+                      scaled_height, grayscale ? TJPF_GRAY : TJPF_BGR, 0) != 0 &&
+        tjGetErrorCode(handle) != TJERR_WARNING)
+    {
+        // Corrupt data libjpeg-turbo refuses, OpenCV decides what is left of it
+        return fallback_.decode(data, length, target_size, image);
+    }
+
+    return true;
+}
+
+bool TurboJpegCodec::encode(const cv::Mat &image, OutputFormat format, int quality, int effort, std::vector<uchar> &buffer)
+{
+    // The TurboJPEG API has no switch for optimized Huffman tables
+    tjhandle handle = thread_handles().compressor;
+    if (format != OutputFormat::JPEG || effort >= 5 || image.depth() != CV_8U || image.dims != 2 || handle == nullptr)
+        return fallback_.encode(image, format, quality, effort, buffer);
+
+    int pixel_format, subsampling;
+    switch (image.channels())
+    {
+    case 1:
+        pixel_format = TJPF_GRAY;
+        subsampling = TJSAMP_GRAY;
+        break;
+    case 3:
+        pixel_format = TJPF_BGR;
+        subsampling = TJSAMP_420;
+        break;
+    case 4:
+        pixel_format = TJPF_BGRX;
+        subsampling = TJSAMP_420;
+        break;
+    default:
+        return fallback_.encode(image, format, quality, effort, buffer);
+    }
+
+    // Same defaults as cv::imencode: quality 95, 4:2:0 chroma
+    buffer.resize(tjBufSize(image.cols, image.rows, subsampling));
+    unsigned char *output = buffer.data();
+    unsigned long output_size = static_cast<unsigned long>(buffer.size());
+    if (tjCompress2(handle, image.data, image.cols, static_cast<int>(image.step), image.rows, pixel_format,
+                    &output, &output_size, subsampling, quality > 0 ? quality : 95, TJFLAG_NOREALLOC) != 0)
+        return fallback_.encode(image, format, quality, effort, buffer);
+
+    buffer.resize(output_size);
+    return true;
+}
+
+bool TurboJpegCodec::yuv_supported(OutputFormat format, int effort) const
+{
+    // Same limit as encode, optimized Huffman tables need OpenCV
+    return format == OutputFormat::JPEG && effort < 5;
+}
+
+bool TurboJpegCodec::decode_yuv(const unsigned char *data, std::size_t length, const cv::Size &target_size, YuvImage &image)
+{
+    tjhandle handle = thread_handles().decompressor;
+    bool jpeg = length >= 2 && data[0] == 0xFF && data[1] == 0xD8;
+    if (!jpeg || handle == nullptr || length > std::numeric_limits<unsigned long>::max())
+        return false;
+
+    // RGB, CMYK and YCCK JPEGs have no planes an encoder takes back as they are
+    int width, height, subsampling, colorspace;
+    if (tjDecompressHeader3(handle, data, static_cast<unsigned long>(length), &width, &height, &subsampling, &colorspace) != 0 ||
+        (colorspace != TJCS_YCbCr && colorspace != TJCS_GRAY) || subsampling < 0 || subsampling >= TJ_NUMSAMP)
+        return false;
+
+    tjscalingfactor factor = scaling_factor(width, height, target_size);
+    int scaled_width = TJSCALED(width, factor);
+    int scaled_height = TJSCALED(height, factor);
+
+    int count = subsampling == TJSAMP_GRAY ? 1 : 3;
+    unsigned char *planes[3] = {};
+    int strides[3] = {};
+    image.planes.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        image.planes[i].create(tjPlaneHeight(i, scaled_height, subsampling), tjPlaneWidth(i, scaled_width, subsampling), CV_8UC1);
+        planes[i] = image.planes[i].data;
+        strides[i] = static_cast<int>(image.planes[i].step);
+    }
+    image.size = cv::Size(scaled_width, scaled_height);
+    image.chroma_factor = cv::Size(tjMCUWidth[subsampling] / 8, tjMCUHeight[subsampling] / 8);
+
+    return tjDecompressToYUVPlanes(handle, data, static_cast<unsigned long>(length), planes, scaled_width, strides, scaled_height, 0) == 0 ||
+           tjGetErrorCode(handle) == TJERR_WARNING;
+}
+
+bool TurboJpegCodec::encode_yuv(const YuvImage &image, int quality, std::vector<uchar> &buffer)
+{
+    tjhandle handle = thread_handles().compressor;
+    if (handle == nullptr || (image.planes.size() != 1 && image.planes.size() != 3))
+        return false;
+
+    int subsampling = -1;
+    for (int i = 0; i < TJ_NUMSAMP; ++i)
+    {
+        bool grayscale = i == TJSAMP_GRAY;
+        if (grayscale == (image.planes.size() == 1) &&
+            (grayscale || cv::Size(tjMCUWidth[i] / 8, tjMCUHeight[i] / 8) == image.chroma_factor))
+        {
+            subsampling = i;
+            break;
+        }
+    }
+    if (subsampling < 0)
+        return false;
+
+    const unsigned char *planes[3] = {};
+    int strides[3] = {};
+    for (std::size_t i = 0; i < image.planes.size(); ++i)
+    {
+        const cv::Mat &plane = image.planes[i];
+        int component = static_cast<int>(i);
+        if (plane.type() != CV_8UC1 || plane.cols < tjPlaneWidth(component, image.size.width, subsampling) ||
+            plane.rows < tjPlaneHeight(component, image.size.height, subsampling))
+            return false;
+
+        planes[i] = plane.data;
+        strides[i] = static_cast<int>(plane.step);
+    }
+
+    buffer.resize(tjBufSize(image.size.width, image.size.height, subsampling));
+    unsigned char *output = buffer.data();
+    unsigned long output_size = static_cast<unsigned long>(buffer.size());
+    if (tjCompressFromYUVPlanes(handle, planes, image.size.width, strides, image.size.height, subsampling,
+                                &output, &output_size, quality > 0 ? quality : 95, TJFLAG_NOREALLOC) != 0)
+        return false;
+
+    buffer.resize(output_size);
+    return true;
+}
+
+#endif
+
+ImageCodec &default_codec()
+{
+#ifdef IMAGE_RESIZER_WITH_TURBOJPEG
+    static TurboJpegCodec codec;
+#else
+    static OpenCVCodec codec;
+#endif
+    return codec;
+}
@@ -0,0 +1,45 @@
+#include "image_resizer/config.hpp"
+#include <cerrno>
+#include <cstdlib>
+
+/// @brief Read an unsigned environment variable
+/// @param name variable name
+/// @param value updated only when the variable holds a valid number
+static void read_env(const char *name, std::size_t &value)
+{
+    const char *str = std::getenv(name);
+    if (str == nullptr || *str == '\0')
+        return;
+
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(str, &end, 10);
+    if (errno == 0 && *end == '\0' && *str != '-')
+        value = static_cast<std::size_t>(parsed);
+}
+
+AppConfig AppConfig::from_env()
+{
+    AppConfig config;
+    read_env("IMAGE_RESIZER_PORT", config.http_port);
+    read_env("IMAGE_RESIZER_HTTP_SHARDS", config.http_shards);
+    read_env("IMAGE_RESIZER_WORKERS", config.worker_threads);
+    read_env("IMAGE_RESIZER_QUEUE_SIZE", config.worker_queue_size);
+    read_env("IMAGE_RESIZER_PIPELINE", config.pipeline);
+    read_env("IMAGE_RESIZER_DECODE_THREADS", config.decode_threads);
+    read_env("IMAGE_RESIZER_RESIZE_THREADS", config.resize_threads);
+    read_env("IMAGE_RESIZER_ENCODE_THREADS", config.encode_threads);
+    read_env("IMAGE_RESIZER_AGING_PIXELS_PER_MS", config.aging_pixels_per_ms);
+    read_env("IMAGE_RESIZER_RESERVED_WORKERS", config.reserved_workers);
+    read_env("IMAGE_RESIZER_SMALL_JOB_PIXELS", config.small_job_pixels);
+    read_env("IMAGE_RESIZER_CACHE_BYTES", config.cache_bytes);
+    read_env("IMAGE_RESIZER_MAT_POOL_BYTES", config.mat_pool_bytes);
+    read_env("IMAGE_RESIZER_STREAM_MIN_PIXELS", config.stream_min_pixels);
+    read_env("IMAGE_RESIZER_PARALLEL_JPEG_PIXELS", config.parallel_jpeg_pixels);
+    read_env("IMAGE_RESIZER_ADMISSION_PIXELS", config.admission_pixels);
+    read_env("IMAGE_RESIZER_ADMISSION_BYTES", config.admission_bytes);
+    read_env("IMAGE_RESIZER_ADMISSION_QUEUE_SIZE", config.admission_queue_size);
+    read_env("IMAGE_RESIZER_ADMISSION_WAIT_MS", config.admission_wait_ms);
+    read_env("IMAGE_RESIZER_RETRY_AFTER", config.retry_after_seconds);
+    return config;
+}
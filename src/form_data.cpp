@@ -0,0 +1,188 @@
+#include "image_resizer/form_data.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+/// @brief Case insensitive comparison of ASCII strings
+static bool iequals(const std::string &lhs, const std::string &rhs)
+{
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b)
+                      { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+}
+
+static std::string trim(const std::string &str)
+{
+    std::size_t begin = str.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return std::string();
+    std::size_t end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+bool header_parameter(const std::string &header_value, const std::string &name, std::string &value)
+{
+    // Parameters follow the first ';', e.g. form-data; name="image"; filename="a.jpg"
+    std::size_t pos = header_value.find(';');
+    while (pos != std::string::npos)
+    {
+        std::size_t begin = pos + 1;
+        std::size_t equals = header_value.find('=', begin);
+        if (equals == std::string::npos)
+            return false;
+
+        std::string key = trim(header_value.substr(begin, equals - begin));
+        std::size_t value_begin = equals + 1;
+        std::string parsed;
+        if (value_begin < header_value.size() && header_value[value_begin] == '"')
+        {
+            std::size_t quote = header_value.find('"', value_begin + 1);
+            if (quote == std::string::npos)
+                return false;
+            parsed = header_value.substr(value_begin + 1, quote - value_begin - 1);
+            pos = header_value.find(';', quote);
+        }
+        else
+        {
+            pos = header_value.find(';', value_begin);
+            parsed = trim(header_value.substr(value_begin, pos == std::string::npos ? std::string::npos : pos - value_begin));
+        }
+
+        if (iequals(key, name))
+        {
+            value = parsed;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Parse the headers of one part, i.e. everything before its empty line
+static bool parse_part_headers(const char *begin, const char *end, FormPart &part)
+{
+    bool has_disposition = false;
+    while (begin < end)
+    {
+        const char *line_end = std::search(begin, end, "\r\n", "\r\n" + 2);
+        std::string line(begin, line_end);
+        begin = line_end == end ? end : line_end + 2;
+
+        std::size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            return false;
+
+        std::string key = trim(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+        if (iequals(key, "Content-Disposition"))
+        {
+            has_disposition = header_parameter(value, "name", part.name);
+            header_parameter(value, "filename", part.filename);
+        }
+        else if (iequals(key, "Content-Type"))
+        {
+            part.content_type = value;
+        }
+    }
+    return has_disposition;
+}
+
+bool parse_multipart(const std::string &content_type, const char *body, std::size_t length, std::vector<FormPart> &parts)
+{
+    std::string boundary;
+    if (!header_parameter(content_type, "boundary", boundary) || boundary.empty())
+        return false;
+
+    // Every part starts after "--boundary\r\n" and ends before "\r\n--boundary"
+    const std::string delimiter = "\r\n--" + boundary;
+    const char *end = body + length;
+
+    // The first delimiter may start the body without a leading CRLF
+    const char *pos;
+    if (length >= delimiter.size() - 2 && std::memcmp(body, delimiter.data() + 2, delimiter.size() - 2) == 0)
+        pos = body + delimiter.size() - 2;
+    else
+    {
+        pos = std::search(body, end, delimiter.begin(), delimiter.end());
+        if (pos == end)
+            return false;
+        pos += delimiter.size();
+    }
+
+    while (true)
+    {
+        // "--" right after a delimiter closes the body
+        if (end - pos >= 2 && pos[0] == '-' && pos[1] == '-')
+            return !parts.empty();
+        if (end - pos < 2 || pos[0] != '\r' || pos[1] != '\n')
+            return false;
+        pos += 2;
+
+        const char *headers_end = std::search(pos, end, "\r\n\r\n", "\r\n\r\n" + 4);
+        if (headers_end == end)
+            return false;
+
+        FormPart part;
+        if (!parse_part_headers(pos, headers_end, part))
+            return false;
+
+        const char *content = headers_end + 4;
+        const char *content_end = std::search(content, end, delimiter.begin(), delimiter.end());
+        if (content_end == end)
+            return false;
+
+        part.data = content;
+        part.length = static_cast<std::size_t>(content_end - content);
+        parts.push_back(part);
+
+        pos = content_end + delimiter.size();
+    }
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static std::string percent_decode(const std::string &str)
+{
+    std::string decoded;
+    decoded.reserve(str.size());
+    for (std::size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == '+')
+            decoded.push_back(' ');
+        else if (str[i] == '%' && i + 2 < str.size() && hex_value(str[i + 1]) >= 0 && hex_value(str[i + 2]) >= 0)
+        {
+            decoded.push_back(static_cast<char>(hex_value(str[i + 1]) * 16 + hex_value(str[i + 2])));
+            i += 2;
+        }
+        else
+            decoded.push_back(str[i]);
+    }
+    return decoded;
+}
+
+bool query_parameter(const std::string &target, const std::string &name, std::string &value)
+{
+    std::size_t pos = target.find('?');
+    while (pos != std::string::npos)
+    {
+        std::size_t begin = pos + 1;
+        pos = target.find('&', begin);
+        std::string pair = target.substr(begin, pos == std::string::npos ? std::string::npos : pos - begin);
+
+        std::size_t equals = pair.find('=');
+        if (percent_decode(pair.substr(0, equals)) == name)
+        {
+            value = equals == std::string::npos ? std::string() : percent_decode(pair.substr(equals + 1));
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,38 @@
+#include "image_resizer/hash.hpp"
+#include <random>
+
+// Header-only, nothing to link
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
+static std::uint64_t random_seed(std::random_device &device)
+{
+    return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+}
+
+const HashSeeds &hash_seeds()
+{
+    static const HashSeeds seeds = []()
+    {
+        std::random_device device;
+        HashSeeds drawn;
+        drawn.hash = random_seed(device);
+        drawn.check = random_seed(device);
+        return drawn;
+    }();
+    return seeds;
+}
+
+Hash128 hash_bytes(const void *data, std::size_t length, std::uint64_t seed)
+{
+    XXH128_hash_t hash = XXH3_128bits_withSeed(data, length, seed);
+    Hash128 result;
+    result.low = hash.low64;
+    result.high = hash.high64;
+    return result;
+}
+
+std::uint64_t check_bytes(const void *data, std::size_t length, std::uint64_t seed)
+{
+    return XXH3_64bits_withSeed(data, length, seed);
+}
@@ -0,0 +1,122 @@
+#include "image_resizer/image_header.hpp"
+
+static unsigned read_be16(const unsigned char *data)
+{
+    return (data[0] << 8) | data[1];
+}
+
+static unsigned long read_be32(const unsigned char *data)
+{
+    return (static_cast<unsigned long>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static bool peek_jpeg_header(const unsigned char *data, std::size_t length, ImageHeader &header)
+{
+    std::size_t pos = 2;
+    while (pos + 4 <= length)
+    {
+        if (data[pos] != 0xFF)
+            return false;
+
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xFF)
+        {
+            // Fill byte before the actual marker
+            ++pos;
+            continue;
+        }
+
+        // Markers without a segment
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+        {
+            pos += 2;
+            continue;
+        }
+
+        // Entropy coded data starts before any frame header was seen
+        if (marker == 0xDA || marker == 0xD9)
+            return false;
+
+        unsigned segment_length = read_be16(data + pos + 2);
+        if (segment_length < 2)
+            return false;
+
+        // SOF0..SOF15 except DHT, JPG and DAC
+        bool is_sof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (is_sof)
+        {
+            // length(2) precision(1) height(2) width(2) components(1)
+            if (segment_length < 8 || pos + 2 + 8 > length)
+                return false;
+
+            const unsigned char *sof = data + pos + 4;
+            header.format = ImageHeader::Format::JPEG;
+            header.height = static_cast<int>(read_be16(sof + 1));
+            header.width = static_cast<int>(read_be16(sof + 3));
+            header.channels = sof[5];
+            return true;
+        }
+
+        pos += 2 + segment_length;
+    }
+
+    return false;
+}
+
+static bool peek_png_header(const unsigned char *data, std::size_t length, ImageHeader &header)
+{
+    // signature(8) chunk length(4) "IHDR"(4) width(4) height(4) depth(1) color type(1)
+    if (length < 26 || read_be32(data + 8) < 13 || data[12] != 'I' || data[13] != 'H' || data[14] != 'D' || data[15] != 'R')
+        return false;
+
+    unsigned long width = read_be32(data + 16);
+    unsigned long height = read_be32(data + 20);
+    if (width > 0x7fffffffUL || height > 0x7fffffffUL)
+        return false;
+
+    int channels = 0;
+    switch (data[25])
+    {
+    case 0: // grayscale
+        channels = 1;
+        break;
+    case 2: // truecolor
+    case 3: // palette
+        channels = 3;
+        break;
+    case 4: // grayscale with alpha
+        channels = 2;
+        break;
+    case 6: // truecolor with alpha
+        channels = 4;
+        break;
+    default:
+        return false;
+    }
+
+    header.format = ImageHeader::Format::PNG;
+    header.width = static_cast<int>(width);
+    header.height = static_cast<int>(height);
+    header.channels = channels;
+    return true;
+}
+
+bool peek_image_header(const unsigned char *data, std::size_t length, ImageHeader &header)
+{
+    static const unsigned char png_signature[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+    if (length >= 2 && data[0] == 0xFF && data[1] == 0xD8)
+        return peek_jpeg_header(data, length, header);
+
+    if (length >= sizeof(png_signature))
+    {
+        for (std::size_t i = 0; i < sizeof(png_signature); ++i)
+        {
+            if (data[i] != png_signature[i])
+                return false;
+        }
+        return peek_png_header(data, length, header);
+    }
+
+    return false;
+}
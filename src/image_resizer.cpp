@@ -1,26 +1,361 @@
 #include "image_resizer/image_resizer.hpp"
+#include "image_resizer/image_header.hpp"
+#include "image_resizer/parallel_jpeg.hpp"
+#include <algorithm>
 
-cv::Mat ImageResizer::decode_image(const std::string &byte_string)
+/// @brief Per-thread scratch buffer reused across requests for decoded bytes
+static std::vector<uchar> &decode_buffer()
 {
-    std::string decoded_img_str = base64_decode(byte_string);
-    std::vector<uchar> data(decoded_img_str.begin(), decoded_img_str.end());
-    cv::Mat image = cv::imdecode(data, cv::IMREAD_UNCHANGED);
+    thread_local std::vector<uchar> buffer;
+    return buffer;
+}
+
+/// @brief Per-thread scratch buffer reused across requests for encoded bytes
+static std::vector<uchar> &encode_buffer()
+{
+    thread_local std::vector<uchar> buffer;
+    return buffer;
+}
+
+/// @brief Per-thread scratch buffer reused across requests for json parsed in place
+static std::vector<char> &json_buffer()
+{
+    thread_local std::vector<char> buffer;
+    return buffer;
+}
+
+const unsigned char *ImageResizer::decode_base64(const char *encoded, std::size_t length, std::size_t &decoded_length)
+{
+    std::vector<uchar> &buffer = decode_buffer();
+    std::size_t max_length = base64_decoded_length(length);
+    if (buffer.size() < max_length)
+        buffer.resize(max_length);
+
+    StageTimer timer(metrics_.get(), Stage::BASE64_DECODE);
+    decoded_length = base64_decode(encoded, length, buffer.data());
+    return buffer.data();
+}
+
+cv::Mat ImageResizer::decode_bytes(const unsigned char *data, std::size_t length, const cv::Size &target_size)
+{
+    cv::Mat image;
+    if (length == 0)
+        return image;
+
+    StageTimer timer(metrics_.get(), Stage::IMAGE_DECODE);
+    if (!codec_->decode(data, length, target_size, image))
+        image.release();
     return image;
 }
 
-std::string ImageResizer::encode_image(const cv::Mat &image, const std::string &type)
+bool ImageResizer::parallel_jpeg(const ResizeOptions &options, std::size_t pixels) const
+{
+    // Optimized Huffman tables (effort 5 and up) cannot be shared by the bands
+    return options.format == OutputFormat::JPEG && options.effort < 5 && parallel_jpeg_pixels_ > 0 &&
+           pixels >= parallel_jpeg_pixels_;
+}
+
+bool ImageResizer::encode_mat(const cv::Mat &image, const ResizeOptions &options, std::vector<uchar> &buffer)
+{
+    if (parallel_jpeg(options, image.total()) &&
+        encode_jpeg_parallel(image, options.quality, std::max(1, cv::getNumThreads()), buffer))
+        return true;
+
+    // The buffer is reused by the thread, it must not keep an earlier image
+    if (!codec_->encode(image, options.format, options.quality, options.effort, buffer))
+    {
+        buffer.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ImageResizer::encode_yuv(const YuvImage &image, const ResizeOptions &options, std::vector<uchar> &buffer)
+{
+    // Same as encode_mat, the buffer must not keep an earlier image
+    if (!codec_->encode_yuv(image, options.quality, buffer))
+    {
+        buffer.clear();
+        return false;
+    }
+    return true;
+}
+
+Error ImageResizer::encode_image(const cv::Mat &image, const ResizeOptions &options, std::string &output)
+{
+    std::vector<uchar> &buffer = encode_buffer();
+    {
+        StageTimer timer(metrics_.get(), Stage::IMAGE_ENCODE);
+        if (!encode_mat(image, options, buffer))
+            return Error(Error::Code::FAILED, "Unable to encode the resized image.");
+    }
+
+    return encode_image(buffer, options, output);
+}
+
+Error ImageResizer::encode_bytes(const cv::Mat &image, const ResizeOptions &options, std::string &output)
+{
+    std::vector<uchar> &buffer = encode_buffer();
+    {
+        StageTimer timer(metrics_.get(), Stage::IMAGE_ENCODE);
+        if (!encode_mat(image, options, buffer))
+            return Error(Error::Code::FAILED, "Unable to encode the resized image.");
+    }
+
+    output.append(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    return Error::Success;
+}
+
+Error ImageResizer::encode_image(const std::vector<uchar> &encoded, const ResizeOptions &, std::string &output)
+{
+    StageTimer timer(metrics_.get(), Stage::BASE64_ENCODE);
+    std::size_t offset = output.size();
+    output.resize(offset + base64_encoded_length(encoded.size()));
+    base64_encode(encoded.data(), encoded.size(), &output[offset]);
+    return Error::Success;
+}
+
+Error ImageResizer::encode_image(const YuvImage &image, const ResizeOptions &options, std::string &output)
+{
+    std::vector<uchar> &buffer = encode_buffer();
+    {
+        StageTimer timer(metrics_.get(), Stage::IMAGE_ENCODE);
+        if (!encode_yuv(image, options, buffer))
+            return Error(Error::Code::FAILED, "Unable to encode the resized image.");
+    }
+
+    return encode_image(buffer, options, output);
+}
+
+Error ImageResizer::encode_bytes(const YuvImage &image, const ResizeOptions &options, std::string &output)
+{
+    std::vector<uchar> &buffer = encode_buffer();
+    {
+        StageTimer timer(metrics_.get(), Stage::IMAGE_ENCODE);
+        if (!encode_yuv(image, options, buffer))
+            return Error(Error::Code::FAILED, "Unable to encode the resized image.");
+    }
+
+    output.append(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    return Error::Success;
+}
+
+Error ImageResizer::parse_options(const rapidjson::Value &encoded_input_doc, ResizeOptions &options)
+{
+    rapidjson::Value::ConstMemberIterator sizes = encoded_input_doc.FindMember("sizes");
+    if (sizes != encoded_input_doc.MemberEnd())
+    {
+        const rapidjson::Value &sizes_array = sizes->value;
+        if (!sizes_array.IsArray() || sizes_array.Empty())
+        {
+            return Error(Error::Code::FAILED, "sizes must be a non-empty array of {width, height} objects.");
+        }
+
+        for (rapidjson::SizeType i = 0; i < sizes_array.Size(); ++i)
+        {
+            const rapidjson::Value &size = sizes_array[i];
+            if (!size.IsObject() || !size.HasMember("width") || !size.HasMember("height") || !size["width"].IsInt() || !size["height"].IsInt())
+            {
+                return Error(Error::Code::FAILED, "sizes must be a non-empty array of {width, height} objects.");
+            }
+            options.sizes.emplace_back(size["width"].GetInt(), size["height"].GetInt());
+        }
+        options.multi_size = true;
+    }
+    else
+    {
+        options.sizes.emplace_back(encoded_input_doc["desired_width"].GetInt(), encoded_input_doc["desired_height"].GetInt());
+    }
+
+    for (const cv::Size &size : options.sizes)
+    {
+        if (size.width <= 0 || size.height <= 0 || size.width > ResizeOptions::max_dimension || size.height > ResizeOptions::max_dimension)
+        {
+            return Error(Error::Code::FAILED, "Target width and height must be integers between 1 and 65500.");
+        }
+    }
+
+    rapidjson::Value::ConstMemberIterator interpolation = encoded_input_doc.FindMember("interpolation");
+    if (interpolation != encoded_input_doc.MemberEnd())
+    {
+        if (!interpolation->value.IsString() ||
+            !parse_interpolation(std::string(interpolation->value.GetString(), interpolation->value.GetStringLength()), options.interpolation))
+        {
+            return Error(Error::Code::FAILED, "interpolation must be one of nearest, linear, area, cubic, lanczos, fast, balanced or quality.");
+        }
+    }
+
+    rapidjson::Value::ConstMemberIterator format = encoded_input_doc.FindMember("output_format");
+    if (format != encoded_input_doc.MemberEnd())
+    {
+        if (!format->value.IsString() ||
+            !parse_output_format(std::string(format->value.GetString(), format->value.GetStringLength()), options.format))
+        {
+            return Error(Error::Code::FAILED, "output_format must be one of jpeg, png, webp or avif.");
+        }
+    }
+
+    if (!output_format_supported(options.format))
+    {
+        return Error(Error::Code::FAILED, "output_format " + output_format_name(options.format) + " is not supported by this server.");
+    }
+
+    rapidjson::Value::ConstMemberIterator quality = encoded_input_doc.FindMember("quality");
+    if (quality != encoded_input_doc.MemberEnd())
+    {
+        if (!quality->value.IsInt() || quality->value.GetInt() < 1 || quality->value.GetInt() > 100)
+        {
+            return Error(Error::Code::FAILED, "quality must be an integer between 1 and 100.");
+        }
+        options.quality = quality->value.GetInt();
+    }
+
+    rapidjson::Value::ConstMemberIterator effort = encoded_input_doc.FindMember("effort");
+    if (effort != encoded_input_doc.MemberEnd())
+    {
+        if (!effort->value.IsInt() || effort->value.GetInt() < 0 || effort->value.GetInt() > 9)
+        {
+            return Error(Error::Code::FAILED, "effort must be an integer between 0 and 9.");
+        }
+        options.effort = effort->value.GetInt();
+    }
+
+    return Error::Success;
+}
+
+Error ImageResizer::validate_options(const rapidjson::Value &encoded_input_doc)
+{
+    ResizeOptions options;
+    return parse_options(encoded_input_doc, options);
+}
+
+/// @brief Size covering every target size of a request
+static cv::Size largest_size(const ResizeOptions &options)
+{
+    cv::Size largest;
+    for (const cv::Size &size : options.sizes)
+    {
+        largest.width = std::max(largest.width, size.width);
+        largest.height = std::max(largest.height, size.height);
+    }
+    return largest;
+}
+
+Error ImageResizer::resize_image(const rapidjson::Value &encoded_input_doc, const ResizeOptions &options, std::vector<cv::Mat> &resized_images)
+{
+    const unsigned char *data;
+    std::size_t length;
+    try
+    {
+        const rapidjson::Value &input_img = encoded_input_doc["input_jpeg"];
+        data = decode_base64(input_img.GetString(), input_img.GetStringLength(), length);
+    }
+    catch (const std::runtime_error &err)
+    {
+        return Error(Error::Code::FAILED, err.what());
+    }
+
+    // A reduced decode must still cover the largest variant
+    cv::Mat decoded_image = decode_bytes(data, length, largest_size(options));
+    if (decoded_image.empty())
+        return Error(Error::Code::FAILED, "String input is not a valid image encoded data.");
+
+    resize_variants(decoded_image, options, resized_images);
+    return Error::Success;
+}
+
+bool ImageResizer::resize_streaming(const unsigned char *data, std::size_t length, const ResizeOptions &options, std::vector<std::vector<uchar>> &encoded_images)
+{
+    // Smaller sources are cheaper to decode at once, their memory is bounded anyway
+    ImageHeader header;
+    if (stream_min_pixels_ == 0 || !peek_image_header(data, length, header) ||
+        static_cast<std::size_t>(header.width) * static_cast<std::size_t>(header.height) < stream_min_pixels_)
+        return false;
+
+    StageTimer timer(metrics_.get(), Stage::STREAM);
+    return stream_resize(data, length, options.sizes, options.interpolation, options.format, options.quality, options.effort,
+                         *codec_, encoded_images);
+}
+
+bool ImageResizer::decode_yuv(const unsigned char *data, std::size_t length, const ResizeOptions &options, YuvImage &decoded_image)
+{
+    if (length == 0 || !codec_->yuv_supported(options.format, options.effort))
+        return false;
+
+    // Large outputs are worth more on the parallel encoder than in YCbCr
+    for (const cv::Size &size : options.sizes)
+        if (parallel_jpeg(options, static_cast<std::size_t>(size.width) * static_cast<std::size_t>(size.height)))
+            return false;
+
+    StageTimer timer(metrics_.get(), Stage::IMAGE_DECODE);
+    return codec_->decode_yuv(data, length, largest_size(options), decoded_image);
+}
+
+Error ImageResizer::decode_image(const unsigned char *data, std::size_t length, ResizeJob &job)
 {
-    std::vector<uchar> buf;
-    cv::imencode(type, image, buf);
-    std::string buf_str(buf.begin(), buf.end());
-    std::string encoded_img_str = base64_encode(buf_str);
-    return encoded_img_str;
+    // Large sources are streamed, JPEG to JPEG stays in YCbCr when the codec allows it
+    if (resize_streaming(data, length, job.options, job.encoded_images))
+    {
+        job.source = ResizeJob::Source::STREAMED;
+        return Error::Success;
+    }
+
+    if (decode_yuv(data, length, job.options, job.decoded_yuv))
+    {
+        job.source = ResizeJob::Source::YUV;
+        return Error::Success;
+    }
+
+    job.decoded_image = decode_bytes(data, length, largest_size(job.options));
+    if (job.decoded_image.empty())
+        return Error(Error::Code::FAILED, job.raw ? "Input is not a valid image encoded data." : "String input is not a valid image encoded data.");
+
+    job.source = ResizeJob::Source::MAT;
+    return Error::Success;
+}
+
+void ImageResizer::resize_variants(const cv::Mat &decoded_image, const ResizeOptions &options, std::vector<cv::Mat> &resized_images)
+{
+    // Produce the largest variants first, every smaller one is then resized
+    // from the smallest variant that still covers it instead of the source
+    std::vector<std::size_t> order(options.sizes.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&options](std::size_t lhs, std::size_t rhs)
+                     { return options.sizes[lhs].area() > options.sizes[rhs].area(); });
+
+    StageTimer timer(metrics_.get(), Stage::RESIZE);
+    resized_images.assign(options.sizes.size(), cv::Mat());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        const cv::Size &size = options.sizes[order[i]];
+        const cv::Mat *source = &decoded_image;
+        for (std::size_t j = 0; j < i; ++j)
+        {
+            const cv::Mat &variant = resized_images[order[j]];
+            if (variant.cols >= size.width && variant.rows >= size.height && variant.total() < source->total())
+                source = &variant;
+        }
+
+        resample_image(*source, resized_images[order[i]], size, options.interpolation);
+    }
 }
 
 Error ImageResizer::process(const std::string &encoded_input_str, std::string &encoded_output_str)
 {
-    rapidjson::Document input_doc, output_doc;
-    if (input_doc.Parse(encoded_input_str.c_str(), encoded_input_str.size()).HasParseError())
+    // One reused copy of the request, parsed in place so that input_jpeg is
+    // decoded from it directly instead of from a second copy in the document
+    std::vector<char> &buffer = json_buffer();
+    buffer.assign(encoded_input_str.begin(), encoded_input_str.end());
+    buffer.push_back('\0');
+
+    rapidjson::Document input_doc;
+    bool parse_error;
+    {
+        StageTimer timer(metrics_.get(), Stage::PARSE);
+        parse_error = input_doc.ParseInsitu(buffer.data()).HasParseError();
+    }
+    if (parse_error)
     {
         return Error(Error::Code::FAILED, "Unable to parse input str to json.");
     }
@@ -30,54 +365,333 @@ Error ImageResizer::process(const std::string &encoded_input_str, std::string &e
         return Error(Error::Code::FAILED, "input_jpeg is not available in data.");
     }
 
-    else if (!input_doc.HasMember("desired_width"))
+    // A "sizes" list replaces both, parse_options validates it
+    if (!input_doc.HasMember("sizes"))
     {
-        return Error(Error::Code::FAILED, "desired_width is not available in data.");
+        if (!input_doc.HasMember("desired_width"))
+        {
+            return Error(Error::Code::FAILED, "desired_width is not available in data.");
+        }
+
+        else if (!input_doc.HasMember("desired_height"))
+        {
+            return Error(Error::Code::FAILED, "desired_height is not available in data.");
+        }
     }
 
-    else if (!input_doc.HasMember("desired_height"))
+    encoded_output_str.clear();
+    return process(input_doc, encoded_output_str);
+}
+
+CacheKey ImageResizer::cache_key(const void *input, std::size_t length, const ResizeOptions &options, const char *layout)
+{
+    // Both digests of the input come first, the parameters after them
+    const HashSeeds &seeds = hash_seeds();
+    Hash128 input_hash = hash_bytes(input, length, seeds.hash);
+    std::uint64_t input_check = check_bytes(input, length, seeds.check);
+    std::string params(reinterpret_cast<const char *>(&input_hash), sizeof(input_hash));
+    params.append(reinterpret_cast<const char *>(&input_check), sizeof(input_check));
+    params.append(interpolation_name(options.interpolation));
+    params.push_back(';');
+    params.append(layout);
+    params.push_back(';');
+    params.append(output_format_name(options.format));
+    params.push_back(';');
+    params.append(std::to_string(options.quality));
+    params.push_back(';');
+    params.append(std::to_string(options.effort));
+    for (const cv::Size &size : options.sizes)
     {
-        return Error(Error::Code::FAILED, "desired_height is not available in data.");
+        params.push_back(';');
+        params.append(std::to_string(size.width));
+        params.push_back('x');
+        params.append(std::to_string(size.height));
     }
 
-    Error res = process(input_doc, output_doc);
-    if (!res.IsOk())
+    CacheKey key;
+    key.hash = hash_bytes(params.data(), params.size(), seeds.hash);
+    // The check digest skips the 16 bytes of input_hash
+    key.check = check_bytes(params.data() + sizeof(input_hash), params.size() - sizeof(input_hash), seeds.check);
+    key.length = length;
+    return key;
+}
+
+template <typename Image>
+Error ImageResizer::write_response(const ResizeOptions &options, const std::vector<Image> &resized_images, std::string &encoded_output_str)
+{
+    // Base64 never needs json escaping, so the encoded image is written
+    // straight between the quotes instead of going through a rapidjson value.
+    // JPEG keeps the original "output_jpeg" member, other formats are named
+    // by "output_format" next to a neutral "output_image"
+    bool jpeg = options.format == OutputFormat::JPEG;
+    std::string image_member = jpeg ? "\"output_jpeg\":\"" : "\"output_format\":\"" + output_format_name(options.format) + "\",\"output_image\":\"";
+
+    if (!options.multi_size)
     {
+        encoded_output_str.push_back('{');
+        encoded_output_str.append(image_member);
+        Error res = encode_image(resized_images[0], options, encoded_output_str);
+        encoded_output_str.append("\"}");
         return res;
     }
 
-    rapidjson ::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    output_doc.Accept(writer);
-    encoded_output_str = std::string(buffer.GetString());
+    encoded_output_str.append("{\"outputs\":[");
+    for (std::size_t i = 0; i < resized_images.size(); ++i)
+    {
+        if (i > 0)
+            encoded_output_str.push_back(',');
 
+        encoded_output_str.append("{\"width\":");
+        encoded_output_str.append(std::to_string(options.sizes[i].width));
+        encoded_output_str.append(",\"height\":");
+        encoded_output_str.append(std::to_string(options.sizes[i].height));
+        encoded_output_str.push_back(',');
+        encoded_output_str.append(image_member);
+        Error res = encode_image(resized_images[i], options, encoded_output_str);
+        if (!res.IsOk())
+            return res;
+        encoded_output_str.append("\"}");
+    }
+    encoded_output_str.append("]}");
     return Error::Success;
 }
 
-Error ImageResizer::process(const rapidjson::Document &encoded_input_doc, rapidjson::Document &encoded_output_doc)
+bool ImageResizer::lookup(const rapidjson::Value &encoded_input_doc, ResizeJob &job, OutputFormat preferred_format, std::string &output)
 {
-    cv::Mat decoded_image;
+    if (!cache_ || !cache_->enabled())
+        return false;
+
+    // Parsed again by decode, into the options of the job
+    ResizeOptions options;
+    options.format = preferred_format;
+    if (!parse_options(encoded_input_doc, options).IsOk())
+        return false;
+
+    const rapidjson::Value &input_img = encoded_input_doc["input_jpeg"];
+    job.key = cache_key(input_img.GetString(), input_img.GetStringLength(), options, options.multi_size ? "multi" : "single");
+    job.cache_checked = true;
+    std::shared_ptr<const std::string> cached = cache_->get(job.key);
+    if (!cached)
+        return false;
+
+    output.append(*cached);
+    return true;
+}
+
+bool ImageResizer::lookup_raw(const unsigned char *data, std::size_t length, ResizeJob &job, std::string &output)
+{
+    if (!cache_ || !cache_->enabled() || job.options.sizes.size() != 1 || !output_format_supported(job.options.format))
+        return false;
+
+    job.key = cache_key(data, length, job.options, "raw");
+    job.cache_checked = true;
+    std::shared_ptr<const std::string> cached = cache_->get(job.key);
+    if (!cached)
+        return false;
+
+    output.append(*cached);
+    return true;
+}
+
+Error ImageResizer::decode(const rapidjson::Value &encoded_input_doc, ResizeJob &job, OutputFormat preferred_format)
+{
+    job.options.format = preferred_format;
+    Error res = parse_options(encoded_input_doc, job.options);
+    if (!res.IsOk())
+    {
+        return res;
+    }
+
+    // A hit skips decoding, resizing and encoding altogether
+    const rapidjson::Value &input_img = encoded_input_doc["input_jpeg"];
+    job.use_cache = cache_ && cache_->enabled();
+    if (job.use_cache && !job.cache_checked)
+    {
+        job.key = cache_key(input_img.GetString(), input_img.GetStringLength(), job.options, job.options.multi_size ? "multi" : "single");
+        job.cached = cache_->get(job.key);
+        if (job.cached)
+        {
+            job.source = ResizeJob::Source::CACHED;
+            return Error::Success;
+        }
+    }
+
+    const unsigned char *data;
+    std::size_t length;
     try
     {
-        std::string input_img_str(encoded_input_doc["input_jpeg"].GetString());
-        decoded_image = decode_image(input_img_str);
+        data = decode_base64(input_img.GetString(), input_img.GetStringLength(), length);
     }
     catch (const std::runtime_error &err)
     {
         return Error(Error::Code::FAILED, err.what());
     }
 
-    cv::Size resized_mat_size{encoded_input_doc["desired_width"].GetInt(), encoded_input_doc["desired_height"].GetInt()};
+    return decode_image(data, length, job);
+}
 
-    if (decoded_image.empty())
-        return Error(Error::Code::FAILED, "String input is not a valid image encoded data.");
+Error ImageResizer::decode_raw(const unsigned char *data, std::size_t length, ResizeJob &job)
+{
+    job.raw = true;
+    if (job.options.sizes.size() != 1)
+    {
+        return Error(Error::Code::FAILED, "Raw requests take exactly one target size.");
+    }
+
+    if (!output_format_supported(job.options.format))
+    {
+        return Error(Error::Code::FAILED, "output_format " + output_format_name(job.options.format) + " is not supported by this server.");
+    }
+
+    job.use_cache = cache_ && cache_->enabled();
+    if (job.use_cache && !job.cache_checked)
+    {
+        job.key = cache_key(data, length, job.options, "raw");
+        job.cached = cache_->get(job.key);
+        if (job.cached)
+        {
+            job.source = ResizeJob::Source::CACHED;
+            return Error::Success;
+        }
+    }
+
+    return decode_image(data, length, job);
+}
+
+void ImageResizer::resize(ResizeJob &job)
+{
+    if (job.source == ResizeJob::Source::YUV)
+    {
+        StageTimer timer(metrics_.get(), Stage::RESIZE);
+        job.resized_yuv.resize(job.options.sizes.size());
+        for (std::size_t i = 0; i < job.options.sizes.size(); ++i)
+            resample_yuv(job.decoded_yuv, job.resized_yuv[i], job.options.sizes[i], job.options.interpolation);
+        job.decoded_yuv = YuvImage();
+    }
+    else if (job.source == ResizeJob::Source::MAT)
+    {
+        resize_variants(job.decoded_image, job.options, job.resized_images);
+        job.decoded_image.release();
+    }
+}
+
+Error ImageResizer::encode(ResizeJob &job, std::string &output)
+{
+    std::size_t offset = output.size();
+    Error res = Error::Success;
+    switch (job.source)
+    {
+    case ResizeJob::Source::CACHED:
+        output.append(*job.cached);
+        return Error::Success;
+    case ResizeJob::Source::STREAMED:
+        if (job.raw)
+            output.append(reinterpret_cast<const char *>(job.encoded_images[0].data()), job.encoded_images[0].size());
+        else
+            res = write_response(job.options, job.encoded_images, output);
+        break;
+    case ResizeJob::Source::YUV:
+        if (job.raw)
+            res = encode_bytes(job.resized_yuv[0], job.options, output);
+        else
+            res = write_response(job.options, job.resized_yuv, output);
+        break;
+    case ResizeJob::Source::MAT:
+        if (job.raw)
+            res = encode_bytes(job.resized_images[0], job.options, output);
+        else
+            res = write_response(job.options, job.resized_images, output);
+        break;
+    }
+
+    // Nothing of a failed response is answered nor cached
+    if (!res.IsOk())
+    {
+        output.resize(offset);
+        return res;
+    }
+
+    if (job.use_cache)
+        cache_->put(job.key, output.substr(offset));
+    return Error::Success;
+}
+
+Error ImageResizer::process(const rapidjson::Value &encoded_input_doc, std::string &encoded_output_str, OutputFormat preferred_format)
+{
+    ResizeJob job;
+    Error res = decode(encoded_input_doc, job, preferred_format);
+    if (!res.IsOk())
+    {
+        return res;
+    }
 
-    cv::Mat resized_image;
-    cv::resize(decoded_image, resized_image, resized_mat_size, cv::INTER_NEAREST);
+    resize(job);
+    return encode(job, encoded_output_str);
+}
 
-    std::string encoded_image_str = encode_image(resized_image, ".jpg");
+Error ImageResizer::process_raw(const unsigned char *data, std::size_t length, const ResizeOptions &options, std::string &output)
+{
+    ResizeJob job;
+    job.options = options;
+    Error res = decode_raw(data, length, job);
+    if (!res.IsOk())
+    {
+        return res;
+    }
+
+    resize(job);
+    return encode(job, output);
+}
 
-    rapidjson::SetValueByPointer(encoded_output_doc, "/output_jpeg", encoded_image_str.c_str());
+Error ImageResizer::process(const rapidjson::Document &encoded_input_doc, rapidjson::Document &encoded_output_doc)
+{
+    ResizeOptions options;
+    Error res = parse_options(encoded_input_doc, options);
+    if (!res.IsOk())
+    {
+        return res;
+    }
+
+    std::vector<cv::Mat> resized_images;
+    res = resize_image(encoded_input_doc, options, resized_images);
+    if (!res.IsOk())
+    {
+        return res;
+    }
+
+    // Same members as write_response
+    const char *image_member = options.format == OutputFormat::JPEG ? "output_jpeg" : "output_image";
+    std::string format_name = output_format_name(options.format);
+
+    if (!options.multi_size)
+    {
+        std::string encoded_image_str;
+        res = encode_image(resized_images[0], options, encoded_image_str);
+        if (!res.IsOk())
+        {
+            return res;
+        }
+        if (options.format != OutputFormat::JPEG)
+            rapidjson::SetValueByPointer(encoded_output_doc, "/output_format", format_name.c_str());
+        rapidjson::Pointer((std::string("/") + image_member).c_str()).Set(encoded_output_doc, encoded_image_str.c_str());
+        return Error::Success;
+    }
+
+    for (std::size_t i = 0; i < resized_images.size(); ++i)
+    {
+        std::string output_path = "/outputs/" + std::to_string(i);
+        std::string encoded_image_str;
+        res = encode_image(resized_images[i], options, encoded_image_str);
+        if (!res.IsOk())
+        {
+            return res;
+        }
+        rapidjson::Pointer((output_path + "/width").c_str()).Set(encoded_output_doc, options.sizes[i].width);
+        rapidjson::Pointer((output_path + "/height").c_str()).Set(encoded_output_doc, options.sizes[i].height);
+        if (options.format != OutputFormat::JPEG)
+            rapidjson::Pointer((output_path + "/output_format").c_str()).Set(encoded_output_doc, format_name.c_str());
+        rapidjson::Pointer((output_path + "/" + image_member).c_str()).Set(encoded_output_doc, encoded_image_str.c_str());
+    }
 
     return Error::Success;
 }
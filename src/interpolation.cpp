@@ -0,0 +1,87 @@
+#include "image_resizer/interpolation.hpp"
+#include <opencv2/imgproc.hpp>
+
+bool parse_interpolation(const std::string &name, Interpolation &interpolation)
+{
+    if (name == "nearest" || name == "fast")
+        interpolation = Interpolation::NEAREST;
+    else if (name == "linear" || name == "balanced")
+        interpolation = Interpolation::LINEAR;
+    else if (name == "area")
+        interpolation = Interpolation::AREA;
+    else if (name == "cubic")
+        interpolation = Interpolation::CUBIC;
+    else if (name == "lanczos")
+        interpolation = Interpolation::LANCZOS;
+    else if (name == "quality")
+        interpolation = Interpolation::QUALITY;
+    else
+        return false;
+
+    return true;
+}
+
+std::string interpolation_name(Interpolation interpolation)
+{
+    switch (interpolation)
+    {
+    case Interpolation::NEAREST:
+        return "nearest";
+    case Interpolation::LINEAR:
+        return "linear";
+    case Interpolation::AREA:
+        return "area";
+    case Interpolation::CUBIC:
+        return "cubic";
+    case Interpolation::LANCZOS:
+        return "lanczos";
+    case Interpolation::QUALITY:
+        return "quality";
+    }
+
+    return "<invalid interpolation>";
+}
+
+/// @brief OpenCV flag of a mode for a given scale change
+static int interpolation_flag(Interpolation interpolation, const cv::Size &src, const cv::Size &dst)
+{
+    switch (interpolation)
+    {
+    case Interpolation::NEAREST:
+        return cv::INTER_NEAREST;
+    case Interpolation::LINEAR:
+        return cv::INTER_LINEAR;
+    case Interpolation::AREA:
+        return cv::INTER_AREA;
+    case Interpolation::CUBIC:
+        return cv::INTER_CUBIC;
+    case Interpolation::LANCZOS:
+        return cv::INTER_LANCZOS4;
+    case Interpolation::QUALITY:
+        return (dst.width < src.width && dst.height < src.height) ? cv::INTER_AREA : cv::INTER_LANCZOS4;
+    }
+
+    return cv::INTER_NEAREST;
+}
+
+void resample_image(const cv::Mat &src, cv::Mat &dst, const cv::Size &size, Interpolation interpolation)
+{
+    int flag = interpolation_flag(interpolation, src.size(), size);
+
+    cv::Mat reduced = src;
+    if (interpolation != Interpolation::NEAREST)
+    {
+        // Each level is a 5x5 gaussian and a 2x decimation, far cheaper than
+        // running the wide area or lanczos kernels over the full source
+        cv::Mat levels[2];
+        int level = 0;
+        while (size.width > 0 && size.height > 0 && reduced.cols >= 2 * size.width && reduced.rows >= 2 * size.height)
+        {
+            cv::pyrDown(reduced, levels[level]);
+            reduced = levels[level];
+            level ^= 1;
+        }
+    }
+
+    cv::resize(reduced, dst, size, 0, 0, flag);
+}
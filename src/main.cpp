@@ -1,110 +1,84 @@
 #include <libasyik/service.hpp>
 #include <libasyik/http.hpp>
+#include <cstdint>
+#include <functional>
+#include <iostream>
 #include <memory>
-#include <string>
-#include <sstream>
-#include <rapidjson/document.h>
-#include <rapidjson/error/en.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
-#include "image_resizer/error.hpp"
-#include "image_resizer/image_resizer.hpp"
+#include <thread>
+#include <vector>
+#include "image_resizer/app.hpp"
+#include "image_resizer/config.hpp"
+#include "image_resizer/mat_pool.hpp"
 
-/// @brief Helper variable to store error code and reasoning
-typedef std::tuple<uint16_t, std::string> HTTP_CODE;
-uint16_t getCode(const HTTP_CODE &code)
+/// @brief Run one HTTP shard: a libasyik service with its own listener
+/// @param ctx shared application state
+/// @param listening called once the listener is bound, before serving
+void run_shard(const std::shared_ptr<AppContext> &ctx, const std::function<void()> &listening)
 {
-    return std::get<0>(code);
-}
+    auto as = asyik::make_service();
+#ifdef IMAGE_RESIZER_WITH_REUSE_PORT
+    // Every listener of the port must set SO_REUSEPORT before its bind
+    auto server = asyik::make_http_server(as, "0.0.0.0", static_cast<uint16_t>(ctx->config.http_port), ctx->config.http_shards > 1);
+#else
+    auto server = asyik::make_http_server(as, "0.0.0.0", static_cast<uint16_t>(ctx->config.http_port));
+#endif
+    register_routes(server, ctx);
 
-std::string getReason(const HTTP_CODE &code)
-{
-    return std::get<1>(code);
+    listening();
+    as->run();
 }
 
-/// @brief Validate incoming data request
-/// @param req_ptr ptr to http_request_ptr
-/// @param doc document to store data in json format
-/// @return HTTP_CODE code error and reasing
-HTTP_CODE validate_requests(const auto &req_ptr, rapidjson::Document &doc)
+int main()
 {
+    AppConfig config = AppConfig::from_env();
+    MatPool::install(config.mat_pool_bytes);
+    std::shared_ptr<AppContext> ctx = make_app_context(config);
 
-    if (req_ptr->headers["Content-Type"] != "application/json")
+#ifndef IMAGE_RESIZER_WITH_REUSE_PORT
+    if (ctx->config.http_shards > 1)
     {
-        return std::make_tuple(415, "Content-Type error: payload must be defined as application/json");
+        std::cerr << "IMAGE_RESIZER_HTTP_SHARDS needs a libasyik whose make_http_server sets SO_REUSEPORT, serving on one shard" << std::endl;
+        ctx->config.http_shards = 1;
     }
+#endif
 
-    if (doc.Parse(req_ptr->body.c_str(), req_ptr->body.size()).HasParseError())
+    // Every shard opens its own listener on the same port with SO_REUSEPORT
+    // so that the kernel spreads connections between them. The primary shard
+    // on the main thread binds first, so a port in use stops the server, and
+    // the others start once it listens. A shard that can not bind only
+    // reduces the parallelism, the primary one still serves every request.
+    std::vector<std::thread> shards;
+    auto start_shards = [&ctx, &shards]()
     {
-        std::stringstream err;
-        err << "JSON parse error: " << doc.GetParseError() << " - " << rapidjson::GetParseError_En(doc.GetParseError());
-        return std::make_tuple(422, err.str());
-    }
+        for (std::size_t i = 1; i < ctx->config.http_shards; ++i)
+        {
+            shards.emplace_back([ctx, i]()
+                                {
+                                    try
+                                    {
+                                        run_shard(ctx, []() {});
+                                    }
+                                    catch (const std::exception &err)
+                                    {
+                                        std::cerr << "HTTP shard " << i << " stopped: " << err.what() << std::endl;
+                                    } });
+        }
+    };
 
-    if (!doc.HasMember("input_jpeg"))
+    try
     {
-        return std::make_tuple(400, "input_jpeg is not available in data.");
+        run_shard(ctx, start_shards);
     }
-    else if (!doc.HasMember("desired_width"))
+    catch (const std::exception &err)
     {
-        return std::make_tuple(400, "desired_width is not available in data.");
-    }
-    else if (!doc.HasMember("desired_height"))
-    {
-        return std::make_tuple(400, "desired_height is not available in data.");
+        std::cerr << "HTTP server stopped: " << err.what() << std::endl;
+        for (auto &shard : shards)
+            shard.detach();
+        return 1;
     }
 
-    return std::make_tuple(200, "");
-}
-
-int main()
-{
-    auto as = asyik::make_service();
-    auto server = asyik::make_http_server(as, "0.0.0.0", 8080);
-    server->set_request_body_limit(10485760); // 10MB
-
-    std::shared_ptr<ImageResizer> image_resizer = std::make_shared<ImageResizer>();
-
-    // accept string argument
-    server->on_http_request("/resize_image", "POST", [image_resizer](auto req, auto args)
-                            {
-                            HTTP_CODE val_code;
-                            rapidjson::Document payload_data, payload_result;
-                            rapidjson::StringBuffer buffer; buffer.Clear();
-                            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-
-                            req->response.headers.set("Content-Type", "application/json");
-
-                            val_code = validate_requests(req, payload_data);
-                            if (getCode(val_code) != 200)
-                            {
-                              rapidjson::SetValueByPointer(payload_result, "/code", getCode(val_code));
-                              rapidjson::SetValueByPointer(payload_result, "/Message", getReason(val_code).c_str());
-                              payload_result.Accept(writer);
-                              req->response.body = buffer.GetString();
-                              req->response.result(getCode(val_code));
-                            }
-                            else
-                            {
-                              Error proc_code = image_resizer->process(payload_data, payload_result);
-
-                              if (proc_code.IsOk()) {
-                                rapidjson::SetValueByPointer(payload_result, "/code", 200);
-                                rapidjson::SetValueByPointer(payload_result, "/message", "success");
-                                payload_result.Accept(writer);
-                                req->response.body = buffer.GetString();
-                                req->response.result(200);
-                              }
-                              else {
-                                rapidjson::SetValueByPointer(payload_result, "/code", 500);
-                                rapidjson::SetValueByPointer(payload_result, "/Message", proc_code.AsString().c_str());
-                                payload_result.Accept(writer);
-                                req->response.body = buffer.GetString();
-                                req->response.result(500);
-                              }
-                            } });
-
-    as->run();
+    for (auto &shard : shards)
+        shard.join();
 
     return 0;
-}
\ No newline at end of file
+}
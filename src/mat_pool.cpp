@@ -0,0 +1,296 @@
+#include "image_resizer/mat_pool.hpp"
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Four classes per power of two, so a buffer wastes less than a fifth of its capacity
+static const std::size_t steps_per_octave = 4;
+static const std::size_t min_class_bits = 12;
+static const std::size_t class_count = (64 - min_class_bits) * steps_per_octave + 1;
+
+// Buffers of one size class a thread keeps before sharing them
+static const std::size_t magazine_depth = 2;
+// A thread keeps at most this fraction of the budget
+static const std::size_t magazine_share = 16;
+// Released headers a thread keeps, they are small and not budgeted
+static const std::size_t max_headers = 64;
+
+/// @brief Buffers shared by every thread, and the budget of the pool
+struct MatPoolDepot
+{
+    explicit MatPoolDepot(std::size_t budget)
+        : budget(budget) {}
+
+    ~MatPoolDepot()
+    {
+        for (std::size_t i = 0; i < class_count; ++i)
+            for (void *buffer : buffers[i])
+                cv::fastFree(buffer);
+    }
+
+    /// @brief Charge a kept buffer, in a magazine or here, to the budget
+    /// @return false if it does not fit
+    bool reserve(std::size_t bytes)
+    {
+        std::size_t cached = cached_bytes.load(std::memory_order_relaxed);
+        do
+        {
+            if (cached + bytes > budget)
+                return false;
+        } while (!cached_bytes.compare_exchange_weak(cached, cached + bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    /// @brief Uncharge a buffer taken back into use
+    void release(std::size_t bytes)
+    {
+        cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    /// @brief Take a shared buffer of a size class, nullptr if there is none
+    void *take(std::size_t index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (buffers[index].empty())
+            return nullptr;
+
+        void *buffer = buffers[index].back();
+        buffers[index].pop_back();
+        return buffer;
+    }
+
+    /// @brief Share a buffer already charged to the budget
+    void put(std::size_t index, void *buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers[index].push_back(buffer);
+    }
+
+    const std::size_t budget;
+    std::atomic<std::size_t> cached_bytes{0};
+    std::mutex mutex;
+    std::vector<void *> buffers[class_count];
+};
+
+// Set once the cache of the thread is destroyed, trivially destructible so it outlives it
+thread_local bool thread_cache_destroyed = false;
+
+/// @brief Magazine of the calling thread: buffers it released, per size class
+struct ThreadCache
+{
+    // Depot the buffers below are charged to, kept alive while they are
+    std::shared_ptr<MatPoolDepot> depot;
+    std::vector<void *> buffers[class_count];
+    std::size_t cached_bytes = 0;
+    std::vector<void *> headers;
+
+    /// @brief Use the magazine for another pool, sharing the buffers of the previous one
+    void bind(const std::shared_ptr<MatPoolDepot> &next)
+    {
+        if (depot == next)
+            return;
+
+        flush();
+        depot = next;
+    }
+
+    /// @brief Hand every buffer of the magazine to the depot
+    void flush()
+    {
+        if (!depot)
+            return;
+
+        for (std::size_t i = 0; i < class_count; ++i)
+        {
+            for (void *buffer : buffers[i])
+                depot->put(i, buffer);
+            buffers[i].clear();
+        }
+        cached_bytes = 0;
+    }
+
+    ~ThreadCache()
+    {
+        flush();
+        depot.reset();
+        for (void *header : headers)
+            ::operator delete(header);
+        thread_cache_destroyed = true;
+    }
+};
+
+/// @brief Cache of the calling thread, nullptr once the thread is shutting down
+static ThreadCache *thread_cache()
+{
+    if (thread_cache_destroyed)
+        return nullptr;
+
+    thread_local ThreadCache cache;
+    return &cache;
+}
+
+std::size_t MatPool::size_class(std::size_t size)
+{
+    if (size <= (std::size_t(1) << min_class_bits))
+        return 0;
+
+    // size lies in (2^bits, 2^(bits+1)], split into steps_per_octave classes
+    std::size_t bits = 63 - __builtin_clzll(static_cast<unsigned long long>(size - 1));
+    std::size_t octave_start = std::size_t(1) << bits;
+    std::size_t step = octave_start / steps_per_octave;
+    std::size_t sub = (size - 1 - octave_start) / step;
+    return (bits - min_class_bits) * steps_per_octave + sub + 1;
+}
+
+std::size_t MatPool::class_capacity(std::size_t index)
+{
+    if (index == 0)
+        return std::size_t(1) << min_class_bits;
+
+    std::size_t bits = (index - 1) / steps_per_octave + min_class_bits;
+    std::size_t sub = (index - 1) % steps_per_octave;
+    std::size_t octave_start = std::size_t(1) << bits;
+    return octave_start + (sub + 1) * (octave_start / steps_per_octave);
+}
+
+MatPool::MatPool(std::size_t max_cached_bytes)
+    : depot_(std::make_shared<MatPoolDepot>(max_cached_bytes))
+{
+}
+
+MatPool::~MatPool() = default;
+
+std::size_t MatPool::cached_bytes() const
+{
+    return depot_->cached_bytes.load(std::memory_order_relaxed);
+}
+
+cv::UMatData *MatPool::allocate(int dims, const int *sizes, int type, void *data0, size_t *step,
+                                cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    // Same layout as the default OpenCV allocator
+    std::size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data0 && step[i] != CV_AUTOSTEP)
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    ThreadCache *cache = thread_cache();
+    uchar *data = static_cast<uchar *>(data0);
+    if (data == nullptr)
+    {
+        std::size_t index = size_class(total);
+        std::size_t capacity = class_capacity(index);
+        bool poolable = capacity <= depot_->budget;
+        if (poolable && cache != nullptr)
+        {
+            cache->bind(depot_);
+            if (!cache->buffers[index].empty())
+            {
+                data = static_cast<uchar *>(cache->buffers[index].back());
+                cache->buffers[index].pop_back();
+                cache->cached_bytes -= capacity;
+            }
+        }
+        if (poolable && data == nullptr)
+            data = static_cast<uchar *>(depot_->take(index));
+
+        if (data != nullptr)
+        {
+            depot_->release(capacity);
+        }
+        else
+        {
+            // Poolable buffers get their whole class capacity so that they fit any size of the class
+            data = static_cast<uchar *>(cv::fastMalloc(poolable ? capacity : total));
+        }
+    }
+
+    void *header = nullptr;
+    if (cache != nullptr && !cache->headers.empty())
+    {
+        header = cache->headers.back();
+        cache->headers.pop_back();
+    }
+    else
+    {
+        header = ::operator new(sizeof(cv::UMatData));
+    }
+
+    cv::UMatData *u = new (header) cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0)
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+bool MatPool::allocate(cv::UMatData *u, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    return u != nullptr;
+}
+
+void MatPool::deallocate(cv::UMatData *u) const
+{
+    if (u == nullptr)
+        return;
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+
+    ThreadCache *cache = thread_cache();
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        std::size_t index = size_class(u->size);
+        std::size_t capacity = class_capacity(index);
+        if (capacity <= depot_->budget && depot_->reserve(capacity))
+        {
+            if (cache != nullptr)
+                cache->bind(depot_);
+            if (cache != nullptr && cache->buffers[index].size() < magazine_depth &&
+                cache->cached_bytes + capacity <= depot_->budget / magazine_share)
+            {
+                cache->buffers[index].push_back(u->origdata);
+                cache->cached_bytes += capacity;
+            }
+            else
+            {
+                depot_->put(index, u->origdata);
+            }
+        }
+        else
+        {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = nullptr;
+    }
+
+    u->~UMatData();
+    if (cache != nullptr && cache->headers.size() < max_headers)
+        cache->headers.push_back(u);
+    else
+        ::operator delete(u);
+}
+
+void MatPool::install(std::size_t max_cached_bytes)
+{
+    if (max_cached_bytes == 0)
+        return;
+
+    // Never destroyed, cv::Mat objects may be released during static destruction
+    static MatPool *pool = new MatPool(max_cached_bytes);
+    cv::Mat::setDefaultAllocator(pool);
+}
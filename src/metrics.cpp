@@ -0,0 +1,186 @@
+#include "image_resizer/metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+
+// 50us to 10s, roughly three buckets per decade
+const std::uint64_t Metrics::bucket_bounds[] = {
+    50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+    1000000000, 2500000000, 5000000000, 10000000000};
+const std::size_t Metrics::bucket_count = sizeof(bucket_bounds) / sizeof(bucket_bounds[0]);
+
+static const std::size_t stage_count = static_cast<std::size_t>(Stage::COUNT);
+
+/// @brief Histograms written by a single thread
+///
+/// Only the owning thread writes, so increments are a relaxed load and store
+/// instead of a locked read-modify-write. Readers may see a slightly stale
+/// but never torn value.
+struct Metrics::ThreadHistograms
+{
+    // The last bucket of every stage is +Inf
+    std::atomic<std::uint64_t> buckets[stage_count][sizeof(bucket_bounds) / sizeof(bucket_bounds[0]) + 1];
+    std::atomic<std::uint64_t> sum_ns[stage_count];
+
+    ThreadHistograms()
+    {
+        for (auto &stage : buckets)
+            for (auto &bucket : stage)
+                bucket.store(0, std::memory_order_relaxed);
+        for (auto &sum : sum_ns)
+            sum.store(0, std::memory_order_relaxed);
+    }
+};
+
+static inline void increment(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+const char *stage_name(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::REQUEST:
+        return "request";
+    case Stage::PARSE:
+        return "parse";
+    case Stage::BASE64_DECODE:
+        return "base64_decode";
+    case Stage::IMAGE_DECODE:
+        return "image_decode";
+    case Stage::RESIZE:
+        return "resize";
+    case Stage::IMAGE_ENCODE:
+        return "image_encode";
+    case Stage::BASE64_ENCODE:
+        return "base64_encode";
+    case Stage::STREAM:
+        return "stream";
+    default:
+        return "unknown";
+    }
+}
+
+/// @brief Distinguishes instances in the per-thread lookup cache
+static std::atomic<std::uint64_t> next_metrics_id(1);
+
+Metrics::Metrics()
+    : id_(next_metrics_id.fetch_add(1)), in_flight_(0), bytes_in_(0), bytes_out_(0)
+{
+    for (auto &counter : requests_)
+        counter.store(0, std::memory_order_relaxed);
+}
+
+Metrics::~Metrics() = default;
+
+Metrics::ThreadHistograms &Metrics::local()
+{
+    struct LocalCache
+    {
+        std::uint64_t id = 0;
+        ThreadHistograms *histograms = nullptr;
+    };
+    thread_local LocalCache cache;
+
+    if (cache.id != id_)
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex_);
+        std::unique_ptr<ThreadHistograms> &histograms = threads_[std::this_thread::get_id()];
+        if (!histograms)
+            histograms.reset(new ThreadHistograms());
+
+        cache.id = id_;
+        cache.histograms = histograms.get();
+    }
+    return *cache.histograms;
+}
+
+void Metrics::observe(Stage stage, std::uint64_t nanoseconds)
+{
+    std::size_t index = static_cast<std::size_t>(stage);
+    std::size_t bucket = std::lower_bound(bucket_bounds, bucket_bounds + bucket_count, nanoseconds) - bucket_bounds;
+
+    ThreadHistograms &histograms = local();
+    increment(histograms.buckets[index][bucket], 1);
+    increment(histograms.sum_ns[index], nanoseconds);
+}
+
+void Metrics::count_request(std::uint16_t code, std::size_t bytes_in, std::size_t bytes_out)
+{
+    if (code < max_code)
+        requests_[code].fetch_add(1, std::memory_order_relaxed);
+    bytes_in_.fetch_add(bytes_in, std::memory_order_relaxed);
+    bytes_out_.fetch_add(bytes_out, std::memory_order_relaxed);
+}
+
+void Metrics::render(std::string &output) const
+{
+    std::uint64_t buckets[stage_count][sizeof(bucket_bounds) / sizeof(bucket_bounds[0]) + 1] = {};
+    std::uint64_t sum_ns[stage_count] = {};
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex_);
+        for (const auto &thread : threads_)
+        {
+            for (std::size_t s = 0; s < stage_count; ++s)
+            {
+                for (std::size_t b = 0; b <= bucket_count; ++b)
+                    buckets[s][b] += thread.second->buckets[s][b].load(std::memory_order_relaxed);
+                sum_ns[s] += thread.second->sum_ns[s].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    char line[512];
+    output.append("# HELP image_resizer_stage_duration_seconds Time spent in each stage of a request.\n"
+                  "# TYPE image_resizer_stage_duration_seconds histogram\n");
+    for (std::size_t s = 0; s < stage_count; ++s)
+    {
+        const char *name = stage_name(static_cast<Stage>(s));
+        std::uint64_t cumulative = 0;
+        for (std::size_t b = 0; b < bucket_count; ++b)
+        {
+            cumulative += buckets[s][b];
+            std::snprintf(line, sizeof(line), "image_resizer_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n",
+                          name, bucket_bounds[b] / 1e9, static_cast<unsigned long long>(cumulative));
+            output.append(line);
+        }
+        cumulative += buckets[s][bucket_count];
+        std::snprintf(line, sizeof(line),
+                      "image_resizer_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n"
+                      "image_resizer_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n"
+                      "image_resizer_stage_duration_seconds_count{stage=\"%s\"} %llu\n",
+                      name, static_cast<unsigned long long>(cumulative), name, sum_ns[s] / 1e9,
+                      name, static_cast<unsigned long long>(cumulative));
+        output.append(line);
+    }
+
+    output.append("# HELP image_resizer_requests_total Requests answered, by HTTP status code.\n"
+                  "# TYPE image_resizer_requests_total counter\n");
+    for (std::size_t code = 0; code < max_code; ++code)
+    {
+        std::uint64_t count = requests_[code].load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        std::snprintf(line, sizeof(line), "image_resizer_requests_total{code=\"%zu\"} %llu\n", code, static_cast<unsigned long long>(count));
+        output.append(line);
+    }
+
+    std::snprintf(line, sizeof(line),
+                  "# HELP image_resizer_requests_in_flight Requests being handled.\n"
+                  "# TYPE image_resizer_requests_in_flight gauge\n"
+                  "image_resizer_requests_in_flight %lld\n",
+                  static_cast<long long>(in_flight_.load(std::memory_order_relaxed)));
+    output.append(line);
+
+    std::snprintf(line, sizeof(line),
+                  "# HELP image_resizer_request_bytes_total Bytes received in request bodies.\n"
+                  "# TYPE image_resizer_request_bytes_total counter\n"
+                  "image_resizer_request_bytes_total %llu\n"
+                  "# HELP image_resizer_response_bytes_total Bytes sent in response bodies.\n"
+                  "# TYPE image_resizer_response_bytes_total counter\n"
+                  "image_resizer_response_bytes_total %llu\n",
+                  static_cast<unsigned long long>(bytes_in_.load(std::memory_order_relaxed)),
+                  static_cast<unsigned long long>(bytes_out_.load(std::memory_order_relaxed)));
+    output.append(line);
+}
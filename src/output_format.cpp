@@ -0,0 +1,183 @@
+#include "image_resizer/output_format.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+// AVIF parameters appeared in OpenCV 4.9
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 9)
+#define IMAGE_RESIZER_HAVE_AVIF_PARAMS 1
+#endif
+
+bool parse_output_format(const std::string &name, OutputFormat &format)
+{
+    if (name == "jpeg" || name == "jpg")
+        format = OutputFormat::JPEG;
+    else if (name == "png")
+        format = OutputFormat::PNG;
+    else if (name == "webp")
+        format = OutputFormat::WEBP;
+    else if (name == "avif")
+        format = OutputFormat::AVIF;
+    else
+        return false;
+
+    return true;
+}
+
+std::string output_format_name(OutputFormat format)
+{
+    switch (format)
+    {
+    case OutputFormat::JPEG:
+        return "jpeg";
+    case OutputFormat::PNG:
+        return "png";
+    case OutputFormat::WEBP:
+        return "webp";
+    case OutputFormat::AVIF:
+        return "avif";
+    }
+
+    return "<invalid output format>";
+}
+
+const char *output_format_extension(OutputFormat format)
+{
+    switch (format)
+    {
+    case OutputFormat::PNG:
+        return ".png";
+    case OutputFormat::WEBP:
+        return ".webp";
+    case OutputFormat::AVIF:
+        return ".avif";
+    case OutputFormat::JPEG:
+    default:
+        return ".jpg";
+    }
+}
+
+const char *output_format_mime(OutputFormat format)
+{
+    switch (format)
+    {
+    case OutputFormat::PNG:
+        return "image/png";
+    case OutputFormat::WEBP:
+        return "image/webp";
+    case OutputFormat::AVIF:
+        return "image/avif";
+    case OutputFormat::JPEG:
+    default:
+        return "image/jpeg";
+    }
+}
+
+bool output_format_supported(OutputFormat format)
+{
+    // Probed once, the codecs of an OpenCV build never change
+    static const bool supported[] = {
+        cv::haveImageWriter(output_format_extension(OutputFormat::JPEG)),
+        cv::haveImageWriter(output_format_extension(OutputFormat::PNG)),
+        cv::haveImageWriter(output_format_extension(OutputFormat::WEBP)),
+#ifdef IMAGE_RESIZER_HAVE_AVIF_PARAMS
+        cv::haveImageWriter(output_format_extension(OutputFormat::AVIF)),
+#else
+        false,
+#endif
+    };
+
+    return supported[static_cast<int>(format)];
+}
+
+std::vector<int> output_format_params(OutputFormat format, int quality, int effort)
+{
+    std::vector<int> params;
+    switch (format)
+    {
+    case OutputFormat::JPEG:
+        if (quality > 0)
+            params.insert(params.end(), {cv::IMWRITE_JPEG_QUALITY, quality});
+        // Optimized Huffman tables, a few percent smaller for one more pass
+        if (effort >= 5)
+            params.insert(params.end(), {cv::IMWRITE_JPEG_OPTIMIZE, 1});
+        break;
+    case OutputFormat::PNG:
+        if (effort >= 0)
+            params.insert(params.end(), {cv::IMWRITE_PNG_COMPRESSION, effort});
+        break;
+    case OutputFormat::WEBP:
+        if (quality > 0)
+            params.insert(params.end(), {cv::IMWRITE_WEBP_QUALITY, quality});
+        break;
+    case OutputFormat::AVIF:
+#ifdef IMAGE_RESIZER_HAVE_AVIF_PARAMS
+        if (quality > 0)
+            params.insert(params.end(), {cv::IMWRITE_AVIF_QUALITY, quality});
+        if (effort >= 0)
+            params.insert(params.end(), {cv::IMWRITE_AVIF_SPEED, 9 - effort});
+#endif
+        break;
+    }
+
+    return params;
+}
+
+static std::string lowercase_trim(const std::string &str)
+{
+    std::size_t begin = str.find_first_not_of(" \t");
+    std::size_t end = str.find_last_not_of(" \t");
+    std::string result = begin == std::string::npos ? std::string() : str.substr(begin, end - begin + 1);
+    for (char &c : result)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return result;
+}
+
+bool negotiate_output_format(const std::string &accept, OutputFormat &format)
+{
+    // Ordered from the smallest output to the largest, earlier wins ties
+    static const OutputFormat preference[] = {OutputFormat::AVIF, OutputFormat::WEBP, OutputFormat::JPEG, OutputFormat::PNG};
+
+    bool found = false;
+    double best_q = 0.0;
+    int best_rank = 0;
+
+    std::stringstream ranges(accept);
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        // e.g. "image/webp;q=0.9"
+        std::stringstream fields(range);
+        std::string type, param;
+        std::getline(fields, type, ';');
+        type = lowercase_trim(type);
+
+        double q = 1.0;
+        while (std::getline(fields, param, ';'))
+        {
+            param = lowercase_trim(param);
+            if (param.compare(0, 2, "q=") == 0)
+                q = std::atof(param.c_str() + 2);
+        }
+
+        for (int rank = 0; rank < 4; ++rank)
+        {
+            OutputFormat candidate = preference[rank];
+            if (type != output_format_mime(candidate) || q <= 0.0 || !output_format_supported(candidate))
+                continue;
+
+            if (!found || q > best_q || (q == best_q && rank < best_rank))
+            {
+                found = true;
+                best_q = q;
+                best_rank = rank;
+            }
+        }
+    }
+
+    if (found)
+        format = preference[best_rank];
+    return found;
+}
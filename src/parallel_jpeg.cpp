@@ -0,0 +1,229 @@
+#include "image_resizer/parallel_jpeg.hpp"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <jpeglib.h>
+
+/// @brief libjpeg error manager returning to the caller instead of exiting
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+static void jpeg_error_exit(j_common_ptr cinfo)
+{
+    std::longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jump, 1);
+}
+
+static void jpeg_silent_message(j_common_ptr)
+{
+}
+
+/// @brief Rows of an image encoded as a complete JPEG of their own
+struct JpegBand
+{
+    JpegBand() = default;
+    JpegBand(const JpegBand &obj) = delete;
+    JpegBand &operator=(const JpegBand &obj) = delete;
+    ~JpegBand() { std::free(data); }
+
+    int first_row = 0;
+    int rows = 0;
+    unsigned char *data = nullptr;
+    unsigned long size = 0;
+    bool encoded = false;
+};
+
+/// @brief Encode the rows of a band with a restart marker after every MCU row
+static bool encode_band(const cv::Mat &image, int quality, JpegBand &band)
+{
+    jpeg_compress_struct cinfo;
+    JpegError error;
+    std::memset(&cinfo, 0, sizeof(cinfo));
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = jpeg_error_exit;
+    error.manager.output_message = jpeg_silent_message;
+    int channels = image.channels();
+#ifndef JCS_EXTENSIONS
+    std::vector<uchar> rgb_row(static_cast<std::size_t>(image.cols) * 3);
+#endif
+
+    if (setjmp(error.jump))
+    {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &band.data, &band.size);
+    cinfo.image_width = image.cols;
+    cinfo.image_height = band.rows;
+#ifdef JCS_EXTENSIONS
+    // Alpha is dropped, as cv::imencode does
+    cinfo.input_components = channels;
+    cinfo.in_color_space = channels == 1 ? JCS_GRAYSCALE : (channels == 3 ? JCS_EXT_BGR : JCS_EXT_BGRX);
+#else
+    cinfo.input_components = channels == 1 ? 1 : 3;
+    cinfo.in_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality > 0 ? quality : 95, TRUE);
+    cinfo.restart_in_rows = 1;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    for (int y = band.first_row; y < band.first_row + band.rows; ++y)
+    {
+        JSAMPROW rows[1] = {const_cast<uchar *>(image.ptr<uchar>(y))};
+#ifndef JCS_EXTENSIONS
+        if (channels > 1)
+        {
+            const uchar *row = rows[0];
+            for (int x = 0; x < image.cols; ++x)
+            {
+                rgb_row[3 * x] = row[channels * x + 2];
+                rgb_row[3 * x + 1] = row[channels * x + 1];
+                rgb_row[3 * x + 2] = row[channels * x];
+            }
+            rows[0] = rgb_row.data();
+        }
+#endif
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+/// @brief Encode a range of bands, one stripe of cv::parallel_for_
+class BandEncoder : public cv::ParallelLoopBody
+{
+public:
+    BandEncoder(const cv::Mat &image, int quality, std::vector<JpegBand> &bands)
+        : image_(image), quality_(quality), bands_(bands) {}
+
+    void operator()(const cv::Range &range) const override
+    {
+        for (int i = range.start; i < range.end; ++i)
+            bands_[i].encoded = encode_band(image_, quality_, bands_[i]);
+    }
+
+private:
+    const cv::Mat &image_;
+    int quality_;
+    std::vector<JpegBand> &bands_;
+};
+
+/// @brief Find the frame header and the entropy-coded data of a JPEG
+/// @param data JPEG with a single scan, as libjpeg writes baseline images
+/// @param size number of bytes
+/// @param frame_offset offset of the SOF marker
+/// @return offset of the first byte after the SOS header, 0 if it is missing
+static std::size_t scan_offset(const unsigned char *data, std::size_t size, std::size_t &frame_offset)
+{
+    frame_offset = 0;
+    std::size_t offset = 2;
+    while (offset + 4 <= size && data[offset] == 0xFF)
+    {
+        unsigned char marker = data[offset + 1];
+        std::size_t length = (static_cast<std::size_t>(data[offset + 2]) << 8) | data[offset + 3];
+        if (marker >= 0xC0 && marker <= 0xC2)
+            frame_offset = offset;
+        offset += 2 + length;
+        if (marker == 0xDA)
+            return frame_offset > 0 && offset <= size ? offset : 0;
+    }
+    return 0;
+}
+
+/// @brief Append entropy-coded data, renumbering its restart markers
+/// @param begin first byte after the SOS header
+/// @param end first byte of the EOI marker
+/// @param restart number of the next restart marker, advanced past every copied one
+/// @param output data is appended here
+static void append_scan(const unsigned char *begin, const unsigned char *end, unsigned int &restart, std::vector<uchar> &output)
+{
+    while (begin < end)
+    {
+        const unsigned char *marker = static_cast<const unsigned char *>(std::memchr(begin, 0xFF, end - begin));
+        if (marker == nullptr || marker + 1 >= end)
+        {
+            output.insert(output.end(), begin, end);
+            return;
+        }
+
+        output.insert(output.end(), begin, marker + 2);
+        // Anything but a stuffed zero byte is one of our restart markers
+        if (marker[1] >= 0xD0 && marker[1] <= 0xD7)
+            output.back() = static_cast<uchar>(0xD0 + (restart++ & 7));
+        begin = marker + 2;
+    }
+}
+
+bool encode_jpeg_parallel(const cv::Mat &image, int quality, std::size_t bands, std::vector<uchar> &buffer)
+{
+    int channels = image.channels();
+    if (image.empty() || image.dims != 2 || image.depth() != CV_8U || (channels != 1 && channels != 3 && channels != 4) ||
+        image.rows > 65500 || image.cols > 65500)
+        return false;
+
+    // libjpeg defaults to 4:2:0 chroma, so a color MCU is 16 rows high
+    int mcu_height = channels == 1 ? 8 : 16;
+    int mcu_rows = (image.rows + mcu_height - 1) / mcu_height;
+    int count = static_cast<int>(std::min<std::size_t>(std::max<std::size_t>(bands, 1), mcu_rows));
+
+    std::vector<JpegBand> encoded(count);
+    for (int i = 0; i < count; ++i)
+    {
+        encoded[i].first_row = i * mcu_rows / count * mcu_height;
+        int last_row = std::min((i + 1) * mcu_rows / count * mcu_height, image.rows);
+        encoded[i].rows = last_row - encoded[i].first_row;
+    }
+
+    cv::parallel_for_(cv::Range(0, count), BandEncoder(image, quality, encoded), count);
+
+    std::size_t total = 0;
+    for (const JpegBand &band : encoded)
+    {
+        if (!band.encoded || band.size < 4 || band.data[band.size - 2] != 0xFF || band.data[band.size - 1] != 0xD9)
+            return false;
+        total += band.size;
+    }
+
+    std::size_t frame_offset;
+    std::size_t header_size = scan_offset(encoded[0].data, encoded[0].size, frame_offset);
+    if (header_size == 0)
+        return false;
+
+    buffer.clear();
+    buffer.reserve(total + 2 * count);
+    buffer.assign(encoded[0].data, encoded[0].data + header_size);
+    // Frame header: marker, length, precision, then the height
+    buffer[frame_offset + 5] = static_cast<uchar>(image.rows >> 8);
+    buffer[frame_offset + 6] = static_cast<uchar>(image.rows & 0xFF);
+
+    unsigned int restart = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const JpegBand &band = encoded[i];
+        std::size_t band_frame_offset;
+        std::size_t offset = i == 0 ? header_size : scan_offset(band.data, band.size, band_frame_offset);
+        if (offset == 0)
+            return false;
+
+        // The last MCU row of a band ends without a marker, the next band needs one
+        if (i > 0)
+        {
+            buffer.push_back(0xFF);
+            buffer.push_back(static_cast<uchar>(0xD0 + (restart++ & 7)));
+        }
+        append_scan(band.data + offset, band.data + band.size - 2, restart, buffer);
+    }
+
+    buffer.push_back(0xFF);
+    buffer.push_back(0xD9);
+    return true;
+}
@@ -0,0 +1,59 @@
+#include "image_resizer/request_arena.hpp"
+#include <memory>
+#include <vector>
+
+// Values get three quarters of the chunk, the parse stack the rest
+static const std::size_t stack_size = RequestArena::chunk_size / 4;
+static const std::size_t value_size = RequestArena::chunk_size - stack_size;
+
+// Chunks allocated once a document outgrows its recycled chunk
+static const std::size_t spill_chunk_size = 64 * 1024;
+
+// Most chunks a thread keeps for later requests
+static const std::size_t max_free_chunks = 64;
+
+/// @brief Allocator for whatever does not fit in a chunk, shared so that no pool allocates its own
+static rapidjson::CrtAllocator &base_allocator()
+{
+    static rapidjson::CrtAllocator allocator;
+    return allocator;
+}
+
+/// @brief Free chunks of the calling thread
+static std::vector<std::unique_ptr<char[]>> &free_chunks()
+{
+    thread_local std::vector<std::unique_ptr<char[]>> chunks;
+    return chunks;
+}
+
+RequestArena::Chunk::Chunk()
+{
+    std::vector<std::unique_ptr<char[]>> &chunks = free_chunks();
+    if (chunks.empty())
+    {
+        data_ = new char[chunk_size];
+        return;
+    }
+
+    data_ = chunks.back().release();
+    chunks.pop_back();
+}
+
+RequestArena::Chunk::~Chunk()
+{
+    std::vector<std::unique_ptr<char[]>> &chunks = free_chunks();
+    if (chunks.size() >= max_free_chunks)
+    {
+        delete[] data_;
+        return;
+    }
+
+    chunks.emplace_back(data_);
+}
+
+RequestArena::RequestArena()
+    : value_allocator_(chunk_.data(), value_size, spill_chunk_size, &base_allocator()),
+      stack_allocator_(chunk_.data() + value_size, stack_size, spill_chunk_size, &base_allocator()),
+      document_(&value_allocator_, stack_size / 2, &stack_allocator_)
+{
+}
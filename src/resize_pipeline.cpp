@@ -0,0 +1,202 @@
+#include "image_resizer/resize_pipeline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+ResizePipeline::StageExecutor::StageExecutor(const char *name, std::size_t threads, std::size_t capacity)
+    : name(name), thread_count(threads), queue(capacity), stopping(false), sleeping(0), pushing(0), busy(0), jobs(0), busy_ns(0), blocked_ns(0)
+{
+}
+
+ResizePipeline::ResizePipeline(std::shared_ptr<ImageResizer> resizer, const PipelineOptions &options)
+    : resizer_(std::move(resizer))
+{
+    std::size_t default_threads = std::max(1u, std::thread::hardware_concurrency() / 3);
+    std::size_t decode_threads = options.decode_threads > 0 ? options.decode_threads : default_threads;
+    std::size_t resize_threads = options.resize_threads > 0 ? options.resize_threads : default_threads;
+    std::size_t encode_threads = options.encode_threads > 0 ? options.encode_threads : default_threads;
+    std::size_t queue_capacity = options.queue_capacity > 0 ? options.queue_capacity : decode_threads * 4;
+
+    // Between stages a couple of requests per thread are enough to keep the
+    // next stage busy, more would only hold decoded images in memory
+    decode_.reset(new StageExecutor("decode", decode_threads, queue_capacity));
+    resize_.reset(new StageExecutor("resize", resize_threads, resize_threads * 2));
+    encode_.reset(new StageExecutor("encode", encode_threads, encode_threads * 2));
+
+    for (StageExecutor *stage : {decode_.get(), resize_.get(), encode_.get()})
+    {
+        stage->threads.reserve(stage->thread_count);
+        for (std::size_t i = 0; i < stage->thread_count; ++i)
+            stage->threads.emplace_back(&ResizePipeline::run, this, std::ref(*stage));
+    }
+}
+
+ResizePipeline::~ResizePipeline()
+{
+    // Upstream first, so that every stage is drained before the next one stops
+    stop(*decode_);
+    stop(*resize_);
+    stop(*encode_);
+}
+
+bool ResizePipeline::try_submit(DecodeFunction decode, std::string &output, DoneFunction done)
+{
+    std::unique_ptr<Request> request(new Request());
+    request->decode = std::move(decode);
+    request->output = &output;
+    request->done = std::move(done);
+
+    // Checked under the lock stop() takes, so that a request is either
+    // refused or queued before the decode threads drain the queue and exit
+    std::lock_guard<std::mutex> lock(decode_->mutex);
+    if (decode_->stopping.load(std::memory_order_relaxed))
+        return false;
+
+    Request *pointer = request.get();
+    if (!decode_->queue.try_push(pointer))
+        return false;
+
+    request.release();
+    if (decode_->sleeping.load(std::memory_order_relaxed) > 0)
+        decode_->cond.notify_one();
+    return true;
+}
+
+void ResizePipeline::push(StageExecutor &from, StageExecutor &to, Request *request)
+{
+    if (!to.queue.try_push(request))
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(to.mutex);
+            to.pushing.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!to.queue.try_push(request))
+                to.not_full.wait(lock);
+            to.pushing.fetch_sub(1, std::memory_order_relaxed);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        from.blocked_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+    }
+    wake(to);
+}
+
+void ResizePipeline::wake(StageExecutor &stage)
+{
+    // Pairs with the fence of a thread going to sleep: either it sees the
+    // request in the queue or this thread sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (stage.sleeping.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        stage.cond.notify_one();
+    }
+}
+
+void ResizePipeline::vacate(StageExecutor &stage)
+{
+    // Pairs with the fence of a thread waiting for room, like wake()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (stage.pushing.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        stage.not_full.notify_one();
+    }
+}
+
+void ResizePipeline::stop(StageExecutor &stage)
+{
+    {
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        stage.stopping.store(true, std::memory_order_release);
+    }
+    stage.cond.notify_all();
+
+    for (auto &thread : stage.threads)
+        thread.join();
+}
+
+void ResizePipeline::run(StageExecutor &stage)
+{
+    for (;;)
+    {
+        Request *request = nullptr;
+        if (!stage.queue.try_pop(request))
+        {
+            std::unique_lock<std::mutex> lock(stage.mutex);
+            stage.sleeping.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!stage.queue.try_pop(request) && !stage.stopping.load(std::memory_order_acquire))
+                stage.cond.wait(lock);
+            stage.sleeping.fetch_sub(1, std::memory_order_relaxed);
+
+            // Stopping and drained
+            if (request == nullptr)
+                return;
+        }
+        vacate(stage);
+
+        stage.busy.fetch_add(1, std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        process(stage, request);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        stage.busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+        stage.jobs.fetch_add(1, std::memory_order_relaxed);
+        stage.busy.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void ResizePipeline::process(StageExecutor &stage, Request *request)
+{
+    std::unique_ptr<Request> owned(request);
+    Error status = Error::Success;
+    try
+    {
+        if (&stage == decode_.get())
+        {
+            status = request->decode(*resizer_, request->job);
+            if (status.IsOk())
+            {
+                // Cached and streamed requests have nothing left to resize
+                bool resized = request->job.source == ResizeJob::Source::CACHED || request->job.source == ResizeJob::Source::STREAMED;
+                push(stage, resized ? *encode_ : *resize_, owned.release());
+                return;
+            }
+        }
+        else if (&stage == resize_.get())
+        {
+            resizer_->resize(request->job);
+            push(stage, *encode_, owned.release());
+            return;
+        }
+        else
+        {
+            status = resizer_->encode(request->job, *request->output);
+        }
+    }
+    catch (const std::exception &err)
+    {
+        status = Error(Error::Code::FAILED, err.what());
+    }
+
+    owned->done(status);
+}
+
+std::vector<ResizePipeline::StageStats> ResizePipeline::stats() const
+{
+    std::vector<StageStats> stats;
+    for (const StageExecutor *stage : {decode_.get(), resize_.get(), encode_.get()})
+    {
+        StageStats stage_stats;
+        stage_stats.name = stage->name;
+        stage_stats.threads = stage->thread_count;
+        stage_stats.busy = stage->busy.load(std::memory_order_relaxed);
+        stage_stats.queued = stage->queue.size();
+        stage_stats.capacity = stage->queue.capacity();
+        stage_stats.jobs = stage->jobs.load(std::memory_order_relaxed);
+        stage_stats.busy_ns = stage->busy_ns.load(std::memory_order_relaxed);
+        stage_stats.blocked_ns = stage->blocked_ns.load(std::memory_order_relaxed);
+        stats.push_back(stage_stats);
+    }
+    return stats;
+}
@@ -0,0 +1,73 @@
+#include "image_resizer/result_cache.hpp"
+
+// Bookkeeping cost of an entry on top of its value: list node, hash node, string header
+static const std::size_t entry_overhead = 128;
+
+ResultCache::ResultCache(std::size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes), bytes_(0), hits_(0), misses_(0), evictions_(0)
+{
+}
+
+std::shared_ptr<const std::string> ResultCache::get(const CacheKey &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(key.hash);
+    if (found == index_.end() || found->second->key != key)
+    {
+        ++misses_;
+        return nullptr;
+    }
+
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return found->second->value;
+}
+
+void ResultCache::put(const CacheKey &key, std::string value)
+{
+    std::size_t bytes = value.size() + entry_overhead;
+    if (bytes > capacity_bytes_)
+        return;
+
+    auto shared_value = std::make_shared<const std::string>(std::move(value));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(key.hash);
+    if (found != index_.end())
+    {
+        // Concurrent misses on the same key keep the first result, and a
+        // colliding request never replaces the entry it collides with
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return;
+    }
+
+    evict_to_fit(bytes);
+    entries_.push_front(Entry{key, std::move(shared_value), bytes});
+    index_.emplace(key.hash, entries_.begin());
+    bytes_ += bytes;
+}
+
+ResultCache::Stats ResultCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.entries = entries_.size();
+    stats.bytes = bytes_;
+    stats.capacity_bytes = capacity_bytes_;
+    return stats;
+}
+
+void ResultCache::evict_to_fit(std::size_t bytes)
+{
+    while (!entries_.empty() && bytes_ + bytes > capacity_bytes_)
+    {
+        const Entry &oldest = entries_.back();
+        bytes_ -= oldest.bytes;
+        index_.erase(oldest.key.hash);
+        entries_.pop_back();
+        ++evictions_;
+    }
+}
@@ -0,0 +1,652 @@
+#include "image_resizer/stream_resizer.hpp"
+#include "image_resizer/image_header.hpp"
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <jpeglib.h>
+#include <png.h>
+
+// Source rows decoded per libjpeg call
+static const int strip_rows = 16;
+
+StreamResizer::Taps StreamResizer::make_taps(int source, int target, Interpolation interpolation)
+{
+    Taps taps;
+    taps.first.resize(target);
+    taps.count.resize(target);
+    taps.offset.resize(target);
+
+    double scale = static_cast<double>(source) / target;
+    // Shrinking averages the covered area for every filter but NEAREST, as
+    // resample_image low-passes with pyrDown before its kernel. A two-tap
+    // tent would skip source samples and alias.
+    bool area = interpolation != Interpolation::NEAREST && source > target;
+
+    for (int j = 0; j < target; ++j)
+    {
+        taps.offset[j] = static_cast<int>(taps.weights.size());
+
+        if (interpolation == Interpolation::NEAREST)
+        {
+            taps.first[j] = std::min(static_cast<int>(std::floor(j * scale)), source - 1);
+            taps.weights.push_back(1.0f);
+        }
+        else if (area)
+        {
+            // Share of every source sample inside [begin, end)
+            double begin = j * scale;
+            double end = (j + 1) * scale;
+            int first = static_cast<int>(std::floor(begin));
+            int last = std::min(static_cast<int>(std::ceil(end - 1e-9)), source);
+            taps.first[j] = first;
+            for (int i = first; i < last; ++i)
+            {
+                double weight = std::min(end, i + 1.0) - std::max(begin, static_cast<double>(i));
+                taps.weights.push_back(static_cast<float>(weight / scale));
+            }
+        }
+        else
+        {
+            // Pixel centers aligned as in cv::resize
+            double center = std::max((j + 0.5) * scale - 0.5, 0.0);
+            int first = static_cast<int>(std::floor(center));
+            double fraction = center - first;
+            if (first >= source - 1)
+            {
+                first = source - 1;
+                fraction = 0.0;
+            }
+            taps.first[j] = first;
+            taps.weights.push_back(static_cast<float>(1.0 - fraction));
+            if (fraction > 0.0)
+                taps.weights.push_back(static_cast<float>(fraction));
+        }
+
+        taps.count[j] = static_cast<int>(taps.weights.size()) - taps.offset[j];
+    }
+
+    return taps;
+}
+
+StreamResizer::StreamResizer(const cv::Size &source_size, int channels, const cv::Size &target_size, Interpolation interpolation)
+    : source_size_(source_size), target_size_(target_size), channels_(channels),
+      columns_(make_taps(source_size.width, target_size.width, interpolation)),
+      rows_(make_taps(source_size.height, target_size.height, interpolation)),
+      resized_row_(static_cast<std::size_t>(target_size.width) * channels),
+      output_row_(static_cast<std::size_t>(target_size.width) * channels)
+{
+}
+
+void StreamResizer::push_row(const uchar *row, const RowCallback &emit)
+{
+    int y = next_source_++;
+
+    // Output rows whose filter starts at this row
+    while (next_active_ < target_size_.height && rows_.first[next_active_] <= y)
+    {
+        if (spare_.empty())
+        {
+            active_.emplace_back(resized_row_.size(), 0.0f);
+        }
+        else
+        {
+            active_.push_back(std::move(spare_.back()));
+            spare_.pop_back();
+            std::fill(active_.back().begin(), active_.back().end(), 0.0f);
+        }
+        ++next_active_;
+    }
+
+    // Rows no output needs, e.g. skipped by NEAREST, are not resized at all
+    bool used = false;
+    for (int j = next_output_; j < next_active_ && !used; ++j)
+        used = y < rows_.first[j] + rows_.count[j];
+
+    if (used)
+    {
+        for (int x = 0; x < target_size_.width; ++x)
+        {
+            const float *weights = &columns_.weights[columns_.offset[x]];
+            const uchar *source = row + static_cast<std::size_t>(columns_.first[x]) * channels_;
+            float *resized = &resized_row_[static_cast<std::size_t>(x) * channels_];
+            for (int c = 0; c < channels_; ++c)
+            {
+                float sum = 0.0f;
+                for (int t = 0; t < columns_.count[x]; ++t)
+                    sum += weights[t] * source[t * channels_ + c];
+                resized[c] = sum;
+            }
+        }
+
+        for (int j = next_output_; j < next_active_; ++j)
+        {
+            int tap = y - rows_.first[j];
+            if (tap >= rows_.count[j])
+                continue;
+
+            float weight = rows_.weights[rows_.offset[j] + tap];
+            std::vector<float> &accumulator = active_[j - next_output_];
+            for (std::size_t i = 0; i < accumulator.size(); ++i)
+                accumulator[i] += weight * resized_row_[i];
+        }
+    }
+
+    // Output rows whose filter ends at this row
+    while (next_output_ < next_active_ && rows_.first[next_output_] + rows_.count[next_output_] <= y + 1)
+    {
+        std::vector<float> &accumulator = active_.front();
+        for (std::size_t i = 0; i < accumulator.size(); ++i)
+            output_row_[i] = cv::saturate_cast<uchar>(accumulator[i]);
+        emit(output_row_.data());
+
+        spare_.push_back(std::move(accumulator));
+        active_.pop_front();
+        ++next_output_;
+    }
+}
+
+/// @brief Receives the rows of a decoded image
+class RowConsumer
+{
+public:
+    virtual ~RowConsumer() {}
+
+    /// @brief Called once before the first row
+    virtual bool begin(const cv::Size &size, int channels) = 0;
+
+    /// @brief Called for every row, top to bottom
+    virtual bool row(const uchar *row) = 0;
+};
+
+/// @brief Encodes an image handed over one row at a time
+class RowSink
+{
+public:
+    virtual ~RowSink() {}
+    virtual bool begin(const cv::Size &size, int channels) = 0;
+    virtual bool write_row(const uchar *row) = 0;
+    virtual bool finish(std::vector<uchar> &output) = 0;
+};
+
+/// @brief libjpeg error manager returning to the caller instead of exiting
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+static void jpeg_error_exit(j_common_ptr cinfo)
+{
+    std::longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jump, 1);
+}
+
+static void jpeg_silent_message(j_common_ptr)
+{
+}
+
+static void png_error_exit(png_structp png, png_const_charp)
+{
+    png_longjmp(png, 1);
+}
+
+static void png_silent_warning(png_structp, png_const_charp)
+{
+}
+
+/// @brief Read cursor of a PNG held in memory
+struct PngSource
+{
+    const unsigned char *data;
+    std::size_t length;
+    std::size_t offset;
+};
+
+static void png_read_memory(png_structp png, png_bytep out, png_size_t count)
+{
+    PngSource *source = static_cast<PngSource *>(png_get_io_ptr(png));
+    if (count > source->length - source->offset)
+        png_error(png, "truncated");
+
+    std::memcpy(out, source->data + source->offset, count);
+    source->offset += count;
+}
+
+static void png_write_memory(png_structp png, png_bytep data, png_size_t length)
+{
+    std::vector<uchar> *output = static_cast<std::vector<uchar> *>(png_get_io_ptr(png));
+    output->insert(output->end(), data, data + length);
+}
+
+static void png_flush_memory(png_structp)
+{
+}
+
+/// @brief Decode a JPEG strip by strip, reduced like cv::IMREAD_REDUCED_* when target_size allows
+static bool decode_jpeg_rows(const unsigned char *data, std::size_t length, const cv::Size &target_size, RowConsumer &consumer)
+{
+    jpeg_decompress_struct cinfo;
+    std::memset(&cinfo, 0, sizeof(cinfo));
+    JpegError error;
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = jpeg_error_exit;
+    error.manager.output_message = jpeg_silent_message;
+    if (setjmp(error.jump))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(length));
+    jpeg_read_header(&cinfo, TRUE);
+
+    // CMYK and YCCK are left to OpenCV
+    bool grayscale = cinfo.jpeg_color_space == JCS_GRAYSCALE;
+    if (!grayscale && cinfo.jpeg_color_space != JCS_YCbCr && cinfo.jpeg_color_space != JCS_RGB)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+#ifdef JCS_EXTENSIONS
+    cinfo.out_color_space = grayscale ? JCS_GRAYSCALE : JCS_EXT_BGR;
+#else
+    cinfo.out_color_space = grayscale ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+
+    static const unsigned int scales[] = {8, 4, 2};
+    for (unsigned int scale : scales)
+    {
+        if ((cinfo.image_width + scale - 1) / scale >= static_cast<unsigned int>(target_size.width) &&
+            (cinfo.image_height + scale - 1) / scale >= static_cast<unsigned int>(target_size.height))
+        {
+            cinfo.scale_num = 1;
+            cinfo.scale_denom = scale;
+            break;
+        }
+    }
+
+    jpeg_start_decompress(&cinfo);
+    int channels = cinfo.output_components;
+    if (!consumer.begin(cv::Size(cinfo.output_width, cinfo.output_height), channels))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    // Released with the decompressor
+    JSAMPARRAY strip = (*cinfo.mem->alloc_sarray)(reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE,
+                                                  cinfo.output_width * channels, strip_rows);
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JDIMENSION rows = jpeg_read_scanlines(&cinfo, strip, strip_rows);
+        for (JDIMENSION i = 0; i < rows; ++i)
+        {
+#ifndef JCS_EXTENSIONS
+            for (JDIMENSION x = 0; channels == 3 && x < cinfo.output_width; ++x)
+                std::swap(strip[i][3 * x], strip[i][3 * x + 2]);
+#endif
+            if (!consumer.row(strip[i]))
+            {
+                jpeg_destroy_decompress(&cinfo);
+                return false;
+            }
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+/// @brief Decode a non-interlaced 8-bit PNG row by row, as BGR, BGRA or grayscale
+static bool decode_png_rows(const unsigned char *data, std::size_t length, RowConsumer &consumer, std::vector<uchar> &row)
+{
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, png_error_exit, png_silent_warning);
+    if (png == nullptr)
+        return false;
+
+    png_infop info = png_create_info_struct(png);
+    if (info == nullptr)
+    {
+        png_destroy_read_struct(&png, nullptr, nullptr);
+        return false;
+    }
+
+    PngSource source = {data, length, 0};
+    if (setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    png_set_read_fn(png, &source, png_read_memory);
+    png_read_info(png, info);
+
+    png_uint_32 width, height;
+    int bit_depth, color_type, interlace;
+    png_get_IHDR(png, info, &width, &height, &bit_depth, &color_type, &interlace, nullptr, nullptr);
+
+    // Interlaced rows are only complete after the last pass, and cv::imdecode
+    // keeps 16-bit samples the rows here are made of bytes
+    if (interlace != PNG_INTERLACE_NONE || bit_depth == 16)
+    {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    bool transparency = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(png);
+    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+        png_set_expand_gray_1_2_4_to_8(png);
+    if (transparency)
+        png_set_tRNS_to_alpha(png);
+    if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA || (color_type == PNG_COLOR_TYPE_GRAY && transparency))
+        png_set_gray_to_rgb(png);
+    png_set_bgr(png);
+    png_read_update_info(png, info);
+
+    row.resize(png_get_rowbytes(png, info));
+    if (!consumer.begin(cv::Size(static_cast<int>(width), static_cast<int>(height)), png_get_channels(png, info)))
+    {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    for (png_uint_32 y = 0; y < height; ++y)
+    {
+        png_read_row(png, row.data(), nullptr);
+        if (!consumer.row(row.data()))
+        {
+            png_destroy_read_struct(&png, &info, nullptr);
+            return false;
+        }
+    }
+
+    png_destroy_read_struct(&png, &info, nullptr);
+    return true;
+}
+
+/// @brief JPEG encoder taking scanlines as they are resized
+class JpegRowSink : public RowSink
+{
+public:
+    JpegRowSink(int quality, int effort) : quality_(quality), effort_(effort)
+    {
+        std::memset(&cinfo_, 0, sizeof(cinfo_));
+        cinfo_.err = jpeg_std_error(&error_.manager);
+        error_.manager.error_exit = jpeg_error_exit;
+        error_.manager.output_message = jpeg_silent_message;
+    }
+
+    ~JpegRowSink() override
+    {
+        jpeg_destroy_compress(&cinfo_);
+        std::free(buffer_);
+    }
+
+    bool begin(const cv::Size &size, int channels) override
+    {
+        if (setjmp(error_.jump))
+            return false;
+
+        jpeg_create_compress(&cinfo_);
+        jpeg_mem_dest(&cinfo_, &buffer_, &buffer_size_);
+        cinfo_.image_width = size.width;
+        cinfo_.image_height = size.height;
+#ifdef JCS_EXTENSIONS
+        // Alpha is dropped, as cv::imencode does
+        cinfo_.input_components = channels;
+        cinfo_.in_color_space = channels == 1 ? JCS_GRAYSCALE : (channels == 3 ? JCS_EXT_BGR : JCS_EXT_BGRX);
+#else
+        cinfo_.input_components = channels == 1 ? 1 : 3;
+        cinfo_.in_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+        channels_ = channels;
+        rgb_row_.resize(static_cast<std::size_t>(size.width) * 3);
+#endif
+        jpeg_set_defaults(&cinfo_);
+        jpeg_set_quality(&cinfo_, quality_ > 0 ? quality_ : 95, TRUE);
+        cinfo_.optimize_coding = effort_ >= 5 ? TRUE : FALSE;
+        jpeg_start_compress(&cinfo_, TRUE);
+        return true;
+    }
+
+    bool write_row(const uchar *row) override
+    {
+        JSAMPROW rows[1] = {const_cast<uchar *>(row)};
+#ifndef JCS_EXTENSIONS
+        if (channels_ > 1)
+        {
+            for (std::size_t x = 0; x < cinfo_.image_width; ++x)
+            {
+                rgb_row_[3 * x] = row[channels_ * x + 2];
+                rgb_row_[3 * x + 1] = row[channels_ * x + 1];
+                rgb_row_[3 * x + 2] = row[channels_ * x];
+            }
+            rows[0] = rgb_row_.data();
+        }
+#endif
+        if (setjmp(error_.jump))
+            return false;
+
+        jpeg_write_scanlines(&cinfo_, rows, 1);
+        return true;
+    }
+
+    bool finish(std::vector<uchar> &output) override
+    {
+        if (setjmp(error_.jump))
+            return false;
+
+        jpeg_finish_compress(&cinfo_);
+        output.assign(buffer_, buffer_ + buffer_size_);
+        return true;
+    }
+
+private:
+    int quality_;
+    int effort_;
+    jpeg_compress_struct cinfo_;
+    JpegError error_;
+    unsigned char *buffer_ = nullptr;
+    unsigned long buffer_size_ = 0;
+#ifndef JCS_EXTENSIONS
+    int channels_ = 0;
+    std::vector<uchar> rgb_row_;
+#endif
+};
+
+/// @brief PNG encoder taking rows as they are resized
+class PngRowSink : public RowSink
+{
+public:
+    explicit PngRowSink(int effort) : effort_(effort) {}
+
+    ~PngRowSink() override
+    {
+        if (png_ != nullptr)
+            png_destroy_write_struct(&png_, &info_);
+    }
+
+    bool begin(const cv::Size &size, int channels) override
+    {
+        png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, png_error_exit, png_silent_warning);
+        if (png_ == nullptr)
+            return false;
+        info_ = png_create_info_struct(png_);
+        if (info_ == nullptr)
+            return false;
+
+        if (setjmp(png_jmpbuf(png_)))
+            return false;
+
+        static const int color_types[] = {0, PNG_COLOR_TYPE_GRAY, PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_RGB, PNG_COLOR_TYPE_RGB_ALPHA};
+        png_set_write_fn(png_, &encoded_, png_write_memory, png_flush_memory);
+        png_set_IHDR(png_, info_, size.width, size.height, 8, color_types[channels], PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        // Level 1 is the cv::imencode default
+        png_set_compression_level(png_, effort_ >= 0 ? effort_ : 1);
+        png_write_info(png_, info_);
+        png_set_bgr(png_);
+        return true;
+    }
+
+    bool write_row(const uchar *row) override
+    {
+        if (setjmp(png_jmpbuf(png_)))
+            return false;
+
+        png_write_row(png_, const_cast<png_bytep>(row));
+        return true;
+    }
+
+    bool finish(std::vector<uchar> &output) override
+    {
+        if (setjmp(png_jmpbuf(png_)))
+            return false;
+
+        png_write_end(png_, nullptr);
+        output.swap(encoded_);
+        return true;
+    }
+
+private:
+    int effort_;
+    png_structp png_ = nullptr;
+    png_infop info_ = nullptr;
+    std::vector<uchar> encoded_;
+};
+
+/// @brief Collects rows into an image of the output size for the codec to encode
+class MatRowSink : public RowSink
+{
+public:
+    MatRowSink(ImageCodec &codec, OutputFormat format, int quality, int effort)
+        : codec_(codec), format_(format), quality_(quality), effort_(effort) {}
+
+    bool begin(const cv::Size &size, int channels) override
+    {
+        image_.create(size, CV_8UC(channels));
+        next_row_ = 0;
+        return true;
+    }
+
+    bool write_row(const uchar *row) override
+    {
+        std::memcpy(image_.ptr(next_row_++), row, image_.cols * image_.elemSize());
+        return true;
+    }
+
+    bool finish(std::vector<uchar> &output) override
+    {
+        return codec_.encode(image_, format_, quality_, effort_, output);
+    }
+
+private:
+    ImageCodec &codec_;
+    OutputFormat format_;
+    int quality_;
+    int effort_;
+    cv::Mat image_;
+    int next_row_ = 0;
+};
+
+/// @brief Feeds every decoded row to one resizer and one encoder per target size
+class StreamPipeline : public RowConsumer
+{
+public:
+    StreamPipeline(const std::vector<cv::Size> &sizes, Interpolation interpolation, OutputFormat format, int quality, int effort, ImageCodec &codec)
+        : sizes_(sizes), interpolation_(interpolation), format_(format), quality_(quality), effort_(effort), codec_(codec) {}
+
+    bool begin(const cv::Size &size, int channels) override
+    {
+        if (channels < 1 || channels > 4)
+            return false;
+
+        for (const cv::Size &target : sizes_)
+        {
+            resizers_.emplace_back(new StreamResizer(size, channels, target, interpolation_));
+            if (format_ == OutputFormat::JPEG)
+                sinks_.emplace_back(new JpegRowSink(quality_, effort_));
+            else if (format_ == OutputFormat::PNG)
+                sinks_.emplace_back(new PngRowSink(effort_));
+            else
+                sinks_.emplace_back(new MatRowSink(codec_, format_, quality_, effort_));
+
+            if (!sinks_.back()->begin(target, channels))
+                return false;
+        }
+        return true;
+    }
+
+    bool row(const uchar *row) override
+    {
+        for (std::size_t i = 0; i < resizers_.size(); ++i)
+        {
+            RowSink &sink = *sinks_[i];
+            bool written = true;
+            resizers_[i]->push_row(row, [&sink, &written](const uchar *output_row)
+                                   { written = written && sink.write_row(output_row); });
+            if (!written)
+                return false;
+        }
+        return true;
+    }
+
+    bool finish(std::vector<std::vector<uchar>> &outputs)
+    {
+        outputs.resize(sizes_.size());
+        for (std::size_t i = 0; i < resizers_.size(); ++i)
+        {
+            if (!resizers_[i]->done() || !sinks_[i]->finish(outputs[i]))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    const std::vector<cv::Size> &sizes_;
+    Interpolation interpolation_;
+    OutputFormat format_;
+    int quality_;
+    int effort_;
+    ImageCodec &codec_;
+    std::vector<std::unique_ptr<StreamResizer>> resizers_;
+    std::vector<std::unique_ptr<RowSink>> sinks_;
+};
+
+bool stream_resize(const unsigned char *data, std::size_t length, const std::vector<cv::Size> &sizes, Interpolation interpolation,
+                   OutputFormat format, int quality, int effort, ImageCodec &codec, std::vector<std::vector<uchar>> &outputs)
+{
+    ImageHeader header;
+    if (sizes.empty() || !peek_image_header(data, length, header))
+        return false;
+
+    cv::Size largest;
+    for (const cv::Size &size : sizes)
+    {
+        if (size.width <= 0 || size.height <= 0)
+            return false;
+        largest.width = std::max(largest.width, size.width);
+        largest.height = std::max(largest.height, size.height);
+    }
+
+    StreamPipeline pipeline(sizes, interpolation, format, quality, effort, codec);
+    bool decoded = false;
+    if (header.format == ImageHeader::Format::JPEG)
+    {
+        decoded = decode_jpeg_rows(data, length, largest, pipeline);
+    }
+    else if (header.format == ImageHeader::Format::PNG)
+    {
+        std::vector<uchar> row;
+        decoded = decode_png_rows(data, length, pipeline, row);
+    }
+
+    return decoded && pipeline.finish(outputs);
+}
@@ -0,0 +1,101 @@
+#include "image_resizer/worker_pool.hpp"
+#include <algorithm>
+#include <utility>
+
+WorkerPool::WorkerPool(std::size_t num_workers, std::size_t queue_capacity, const SchedulerOptions &scheduling)
+    : scheduling_(scheduling), start_(std::chrono::steady_clock::now()), next_sequence_(0),
+      queue_capacity_(queue_capacity), stopping_(false)
+{
+    if (num_workers == 0)
+        num_workers = std::max(1u, std::thread::hardware_concurrency());
+    if (queue_capacity_ == 0)
+        queue_capacity_ = num_workers * 4;
+
+    // At least one worker must take large tasks
+    scheduling_.reserved_workers = std::min(scheduling_.reserved_workers, num_workers - 1);
+
+    workers_.reserve(num_workers);
+    for (std::size_t i = 0; i < num_workers; ++i)
+        workers_.emplace_back(&WorkerPool::worker_loop, this, i < scheduling_.reserved_workers);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_all();
+
+    for (auto &worker : workers_)
+        worker.join();
+}
+
+bool WorkerPool::runs_later(const Task &lhs, const Task &rhs)
+{
+    if (lhs.priority != rhs.priority)
+        return lhs.priority > rhs.priority;
+    return lhs.sequence > rhs.sequence;
+}
+
+void WorkerPool::push(std::vector<Task> &queue, Task task)
+{
+    queue.push_back(std::move(task));
+    std::push_heap(queue.begin(), queue.end(), runs_later);
+}
+
+std::function<void()> WorkerPool::pop(std::vector<Task> &queue)
+{
+    std::pop_heap(queue.begin(), queue.end(), runs_later);
+    std::function<void()> run = std::move(queue.back().run);
+    queue.pop_back();
+    return run;
+}
+
+bool WorkerPool::try_post(std::function<void()> task, std::uint64_t cost)
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+    double priority = static_cast<double>(cost) + static_cast<double>(scheduling_.aging_per_ms) * elapsed.count();
+    bool small = scheduling_.reserved_workers > 0 && cost <= scheduling_.small_task_cost;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || small_tasks_.size() + large_tasks_.size() >= queue_capacity_)
+            return false;
+        push(small ? small_tasks_ : large_tasks_, Task{priority, next_sequence_++, std::move(task)});
+    }
+
+    // A reserved worker woken for a large task would leave it queued
+    if (scheduling_.reserved_workers > 0)
+        cond_.notify_all();
+    else
+        cond_.notify_one();
+    return true;
+}
+
+std::size_t WorkerPool::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return small_tasks_.size() + large_tasks_.size();
+}
+
+void WorkerPool::worker_loop(bool reserved)
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this, reserved]()
+                       { return stopping_ || !small_tasks_.empty() || (!reserved && !large_tasks_.empty()); });
+
+            if (!small_tasks_.empty() &&
+                (reserved || large_tasks_.empty() || !runs_later(small_tasks_.front(), large_tasks_.front())))
+                task = pop(small_tasks_);
+            else if (!reserved && !large_tasks_.empty())
+                task = pop(large_tasks_);
+            else
+                return;
+        }
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+#include "image_resizer/yuv_image.hpp"
+
+/// @brief Samples covering length pixels at one sample per factor pixels
+static int subsampled(int length, int factor)
+{
+    return (length + factor - 1) / factor;
+}
+
+void resample_yuv(const YuvImage &src, YuvImage &dst, const cv::Size &size, Interpolation interpolation)
+{
+    dst.size = size;
+    dst.chroma_factor = src.chroma_factor;
+    dst.planes.resize(src.planes.size());
+
+    for (std::size_t i = 0; i < src.planes.size(); ++i)
+    {
+        if (i > 0)
+        {
+            cv::Size source(subsampled(src.size.width, src.chroma_factor.width), subsampled(src.size.height, src.chroma_factor.height));
+            cv::Size target(subsampled(size.width, src.chroma_factor.width), subsampled(size.height, src.chroma_factor.height));
+            resample_image(src.planes[i](cv::Rect(0, 0, source.width, source.height)), dst.planes[i], target, interpolation);
+            continue;
+        }
+
+        // Luma is resized without its padding, then padded again
+        int pad_right = subsampled(size.width, src.chroma_factor.width) * src.chroma_factor.width - size.width;
+        int pad_bottom = subsampled(size.height, src.chroma_factor.height) * src.chroma_factor.height - size.height;
+        cv::Mat luma = src.planes[0](cv::Rect(0, 0, src.size.width, src.size.height));
+        if (pad_right == 0 && pad_bottom == 0)
+        {
+            resample_image(luma, dst.planes[0], size, interpolation);
+        }
+        else
+        {
+            cv::Mat resized;
+            resample_image(luma, resized, size, interpolation);
+            cv::copyMakeBorder(resized, dst.planes[0], 0, pad_bottom, 0, pad_right, cv::BORDER_REPLICATE);
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "image_resizer/admission.hpp"
+#include "image_resizer/base64.hpp"
+
+/// @brief Smallest PNG prefix holding the IHDR chunk
+static std::vector<unsigned char> png_header(std::uint32_t width, std::uint32_t height, unsigned char color_type)
+{
+    std::vector<unsigned char> data = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 0, 0, 0, 13, 'I', 'H', 'D', 'R'};
+    for (std::uint32_t value : {width, height})
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            data.push_back(static_cast<unsigned char>(value >> shift));
+    }
+    data.insert(data.end(), {8, color_type, 0, 0, 0, 0, 0, 0, 0});
+    return data;
+}
+
+static RequestCost cost(std::uint64_t pixels, std::uint64_t bytes)
+{
+    RequestCost cost;
+    cost.pixels = pixels;
+    cost.bytes = bytes;
+    return cost;
+}
+
+TEST(AdmissionController, estimates_from_header)
+{
+    AdmissionController admission(0, 0, 0);
+    std::vector<unsigned char> png = png_header(8000, 4000, 6);
+
+    RequestCost estimated = admission.estimate(png.data(), png.size(), 640 * 480);
+    EXPECT_EQ(estimated.pixels, 8000u * 4000u + 2u * 640u * 480u);
+    EXPECT_EQ(estimated.bytes, 8000u * 4000u * 4u + 2u * 640u * 480u * 4u);
+
+    // The same image in base64 also holds its decoded copy
+    std::string encoded = base64_encode(std::string(png.begin(), png.end()));
+    RequestCost estimated_base64 = admission.estimate_base64(encoded.data(), encoded.size(), 640 * 480);
+    EXPECT_EQ(estimated_base64.pixels, estimated.pixels);
+    EXPECT_GT(estimated_base64.bytes, estimated.bytes);
+
+    // Streamed sources hold a strip instead of the whole image
+    AdmissionController streaming(0, 0, 0, 16 * 1024 * 1024);
+    RequestCost streamed = streaming.estimate(png.data(), png.size(), 640 * 480);
+    EXPECT_EQ(streamed.pixels, estimated.pixels);
+    EXPECT_LT(streamed.bytes, 8000u * 4000u);
+
+    // Without a header the size of the payload is used
+    std::vector<unsigned char> garbage(1000, 0x42);
+    RequestCost unknown = admission.estimate(garbage.data(), garbage.size(), 0);
+    EXPECT_GT(unknown.pixels, 1000u);
+    EXPECT_GT(unknown.bytes, 1000u);
+}
+
+TEST(AdmissionController, queues_then_rejects)
+{
+    AdmissionController admission(100, 1000, 1);
+    EXPECT_TRUE(admission.enabled());
+
+    int admitted = 0;
+    std::uint64_t ticket = 0;
+    EXPECT_EQ(admission.acquire(cost(60, 100), [&]()
+                                { ++admitted; },
+                                ticket),
+              AdmissionController::Result::ADMITTED);
+    EXPECT_EQ(admission.acquire(cost(60, 100), [&]()
+                                { ++admitted; },
+                                ticket),
+              AdmissionController::Result::QUEUED);
+
+    // A request that would fit still waits behind the queued one
+    std::uint64_t other_ticket = 0;
+    EXPECT_EQ(admission.acquire(cost(10, 10), [&]()
+                                { ++admitted; },
+                                other_ticket),
+              AdmissionController::Result::REJECTED);
+    EXPECT_EQ(admitted, 0);
+
+    admission.release(cost(60, 100));
+    EXPECT_EQ(admitted, 1);
+    EXPECT_FALSE(admission.cancel(ticket));
+
+    AdmissionController::Stats stats = admission.stats();
+    EXPECT_EQ(stats.admitted, 2u);
+    EXPECT_EQ(stats.queued, 1u);
+    EXPECT_EQ(stats.rejected, 1u);
+    EXPECT_EQ(stats.waiting, 0u);
+    EXPECT_EQ(stats.pixels_in_use, 60u);
+    EXPECT_EQ(stats.bytes_in_use, 100u);
+
+    admission.release(cost(60, 100));
+    EXPECT_EQ(admission.stats().pixels_in_use, 0u);
+}
+
+TEST(AdmissionController, cancel_admits_followers)
+{
+    AdmissionController admission(100, 0, 4);
+
+    int admitted = 0;
+    std::uint64_t first = 0, second = 0, third = 0;
+    EXPECT_EQ(admission.acquire(cost(50, 0), [&]()
+                                { ++admitted; },
+                                first),
+              AdmissionController::Result::ADMITTED);
+    EXPECT_EQ(admission.acquire(cost(80, 0), [&]()
+                                { ++admitted; },
+                                second),
+              AdmissionController::Result::QUEUED);
+    EXPECT_EQ(admission.acquire(cost(40, 0), [&]()
+                                { ++admitted; },
+                                third),
+              AdmissionController::Result::QUEUED);
+
+    // The large head times out, the small request behind it fits already
+    EXPECT_TRUE(admission.cancel(second));
+    EXPECT_EQ(admitted, 1);
+    EXPECT_FALSE(admission.cancel(third));
+    EXPECT_EQ(admission.stats().timed_out, 1u);
+    EXPECT_EQ(admission.stats().pixels_in_use, 90u);
+}
+
+TEST(AdmissionController, oversized_requests_run_alone)
+{
+    AdmissionController admission(100, 1000, 4);
+
+    int admitted = 0;
+    std::uint64_t ticket = 0;
+    EXPECT_EQ(admission.acquire(cost(10, 10), [&]()
+                                { ++admitted; },
+                                ticket),
+              AdmissionController::Result::ADMITTED);
+    EXPECT_EQ(admission.acquire(cost(5000, 50000), [&]()
+                                { ++admitted; },
+                                ticket),
+              AdmissionController::Result::QUEUED);
+
+    admission.release(cost(10, 10));
+    EXPECT_EQ(admitted, 1);
+    EXPECT_EQ(admission.stats().pixels_in_use, 100u);
+    EXPECT_EQ(admission.stats().bytes_in_use, 1000u);
+
+    admission.release(cost(5000, 50000));
+    EXPECT_EQ(admission.stats().pixels_in_use, 0u);
+    EXPECT_EQ(admission.stats().bytes_in_use, 0u);
+
+    // Without budgets everything is admitted at once
+    AdmissionController unlimited(0, 0, 0);
+    EXPECT_FALSE(unlimited.enabled());
+    EXPECT_EQ(unlimited.acquire(cost(1ull << 40, 1ull << 40), nullptr, ticket), AdmissionController::Result::ADMITTED);
+}
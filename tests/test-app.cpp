@@ -11,12 +11,13 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
+#include "image_resizer/app.hpp"
 #include "image_resizer/error.hpp"
 #include "image_resizer/base64.hpp"
 #include "image_resizer/image_resizer.hpp"
 
-// TDD since its functionalities will be private
 cv::Mat decode_image(const std::string &byte_string)
 {
     std::string decoded_img_str = base64_decode(byte_string);
@@ -34,94 +35,57 @@ std::string encode_image(const cv::Mat &image, const std::string &type)
     return encoded_img_str;
 }
 
-typedef std::tuple<uint16_t, std::string> HTTP_CODE;
-uint16_t getCode(const HTTP_CODE &code)
+std::string encode_raw(const cv::Mat &image, const std::string &type)
 {
-    return std::get<0>(code);
+    std::vector<uchar> buf;
+    cv::imencode(type, image, buf);
+    return std::string(buf.begin(), buf.end());
 }
 
-std::string getReason(const HTTP_CODE &code)
+cv::Mat decode_raw(const std::string &bytes)
 {
-    return std::get<1>(code);
+    std::vector<uchar> data(bytes.begin(), bytes.end());
+    return cv::imdecode(data, cv::IMREAD_UNCHANGED);
 }
 
-HTTP_CODE validate_requests(const auto &req_ptr, rapidjson::Document &doc)
+// Small server without response cache, every request is resized
+AppConfig test_config(std::size_t port)
 {
+    AppConfig config;
+    config.http_port = port;
+    config.worker_threads = 2;
+    config.cache_bytes = 0;
+    return config;
+}
 
-    if (req_ptr->headers["Content-Type"] != "application/json")
-    {
-        return std::make_tuple(415, "Content-Type error: payload must be defined as application/json");
-    }
-
-    else if (doc.Parse(req_ptr->body.c_str(), req_ptr->body.size()).HasParseError())
-    {
-        std::stringstream err;
-        err << "JSON parse error: " << doc.GetParseError() << " - " << rapidjson::GetParseError_En(doc.GetParseError());
-        return std::make_tuple(422, err.str());
-    }
-
-    else if (!doc.HasMember("input_jpeg"))
-    {
-        return std::make_tuple(400, "input_jpeg is not available in data.");
-    }
-    else if (!doc.HasMember("desired_width"))
-    {
-        return std::make_tuple(400, "desired_width is not available in data.");
-    }
-    else if (!doc.HasMember("desired_height"))
-    {
-        return std::make_tuple(400, "desired_height is not available in data.");
-    }
-
-    return std::make_tuple(200, "");
+std::string resize_request(const std::string &encoded_image, int width, int height)
+{
+    return "{\"input_jpeg\":\"" + encoded_image + "\",\"desired_width\":" + std::to_string(width) +
+           ",\"desired_height\":" + std::to_string(height) + "}";
+}
+
+// Serve the application on a local port while test runs as a client
+template <typename Test>
+void serve(const std::shared_ptr<AppContext> &ctx, Test test)
+{
+    auto as = asyik::make_service();
+    auto server = asyik::make_http_server(as, "127.0.0.1", static_cast<uint16_t>(ctx->config.http_port));
+    register_routes(server, ctx);
+
+    as->execute([as, test]()
+                {
+                    test(as);
+                    as->stop(); });
+    as->run();
 }
 
 TEST(APP, main_func)
 {
+    auto ctx = make_app_context(test_config(8080));
     auto as = asyik::make_service();
     auto server = asyik::make_http_server(as, "127.0.0.1", 8080);
-    server->set_request_body_limit(10485760); // 10MB
-
-    std::shared_ptr<ImageResizer> image_resizer = std::make_shared<ImageResizer>();
-
-    // accept string argument
-    server->on_http_request("/resize_image", "POST", [image_resizer](auto req, auto args)
-                            {
-                            HTTP_CODE val_code;
-                            rapidjson::Document payload_data, payload_result;
-                            rapidjson::StringBuffer buffer; buffer.Clear();
-                            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-
-                            req->response.headers.set("Content-Type", "application/json");
-
-                            val_code = validate_requests(req, payload_data);
-                            if (getCode(val_code) != 200)
-                            {
-                              rapidjson::SetValueByPointer(payload_result, "/code", getCode(val_code));
-                              rapidjson::SetValueByPointer(payload_result, "/Message", getReason(val_code).c_str());
-                              payload_result.Accept(writer);
-                              req->response.body = buffer.GetString();
-                              req->response.result(getCode(val_code));
-                            }
-                            else
-                            {
-                              Error proc_code = image_resizer->process(payload_data, payload_result);
-
-                              if (!proc_code.IsOk()) {
-                                rapidjson::SetValueByPointer(payload_result, "/code", 500);
-                                rapidjson::SetValueByPointer(payload_result, "/Message", proc_code.AsString().c_str());
-                                payload_result.Accept(writer);
-                                req->response.body = buffer.GetString();
-                                req->response.result(500);
-                              }
-                              else {
-                                rapidjson::SetValueByPointer(payload_result, "/code", 200);
-                                rapidjson::SetValueByPointer(payload_result, "/message", "success");
-                                payload_result.Accept(writer);
-                                req->response.body = buffer.GetString();
-                                req->response.result(200);
-                              }
-                            } });
+    register_routes(server, ctx);
+
     as->execute([as]() {
         auto req =
             asyik::http_easy_request(as, "POST", "http://127.0.0.1:8080/resize_image",
@@ -246,4 +210,146 @@ TEST(APP, main_func)
     });
 
     as->run();
-}
\ No newline at end of file
+}
+
+TEST(APP, resize_batch)
+{
+    auto ctx = make_app_context(test_config(8081));
+    std::string image = encode_image(cv::Mat(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120)), ".jpg");
+
+    serve(ctx, [&image](asyik::service_ptr as)
+          {
+              auto req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8081/resize_batch",
+                                                  "{\"items\":[]}", {{"Content-Type", "application/json"}});
+              EXPECT_TRUE(req->response.result() == 400);
+              EXPECT_EQ(req->response.body, "{\"code\":400,\"Message\":\"items must be a non-empty array.\"}");
+
+              // Valid and invalid items interleaved, every result at the index of its item
+              std::string body = "{\"items\":[" + resize_request(image, 320, 240) + "," +
+                                 "{\"input_jpeg\":\"" + image + "\",\"desired_height\":240}," +
+                                 "{\"input_jpeg\":\"" + image + "\",\"desired_width\":320,\"desired_height\":240,\"interpolation\":\"bogus\"}," +
+                                 resize_request("AAA", 320, 240) + "," +
+                                 resize_request(image, 160, 90) + "]}";
+              req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8081/resize_batch",
+                                             body, {{"Content-Type", "application/json"}});
+              EXPECT_TRUE(req->response.result() == 200);
+              EXPECT_EQ(std::string(req->response.headers["Content-Type"]), "application/json");
+
+              rapidjson::Document output;
+              output.Parse(req->response.body.c_str(), req->response.body.size());
+              ASSERT_FALSE(output.HasParseError());
+              EXPECT_EQ(output["code"].GetInt(), 200);
+              const rapidjson::Value &results = output["results"];
+              ASSERT_EQ(results.Size(), 5u);
+
+              EXPECT_EQ(results[0]["code"].GetInt(), 200);
+              EXPECT_TRUE((decode_image(results[0]["output_jpeg"].GetString()).size() == cv::Size{320, 240}));
+              EXPECT_EQ(results[1]["code"].GetInt(), 400);
+              EXPECT_STREQ(results[1]["Message"].GetString(), "desired_width is not available in data.");
+              EXPECT_EQ(results[2]["code"].GetInt(), 400);
+              EXPECT_FALSE(results[2].HasMember("output_jpeg"));
+              EXPECT_EQ(results[3]["code"].GetInt(), 500);
+              EXPECT_FALSE(results[3].HasMember("output_jpeg"));
+              EXPECT_EQ(results[4]["code"].GetInt(), 200);
+              EXPECT_TRUE((decode_image(results[4]["output_jpeg"].GetString()).size() == cv::Size{160, 90})); });
+}
+
+TEST(APP, resize_raw)
+{
+    auto ctx = make_app_context(test_config(8082));
+    std::string image = encode_raw(cv::Mat(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120)), ".jpg");
+
+    serve(ctx, [&image](asyik::service_ptr as)
+          {
+              // Parameters from headers
+              auto req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8082/resize_raw", image,
+                                                  {{"Content-Type", "application/octet-stream"},
+                                                   {"X-Desired-Width", "320"},
+                                                   {"X-Desired-Height", "240"}});
+              EXPECT_TRUE(req->response.result() == 200);
+              EXPECT_EQ(std::string(req->response.headers["Content-Type"]), "image/jpeg");
+              EXPECT_TRUE((decode_raw(req->response.body).size() == cv::Size{320, 240}));
+
+              // Parameters from the query string, the format names the Content-Type
+              req = asyik::http_easy_request(as, "POST",
+                                             "http://127.0.0.1:8082/resize_raw?desired_width=160&desired_height=90&output_format=png",
+                                             image, {{"Content-Type", "application/octet-stream"}});
+              EXPECT_TRUE(req->response.result() == 200);
+              EXPECT_EQ(std::string(req->response.headers["Content-Type"]), "image/png");
+              EXPECT_EQ(req->response.body.compare(1, 3, "PNG"), 0);
+              EXPECT_TRUE((decode_raw(req->response.body).size() == cv::Size{160, 90}));
+
+              // Parameters from form fields next to the image part
+              std::string form = "--XyZ\r\nContent-Disposition: form-data; name=\"desired_width\"\r\n\r\n200\r\n"
+                                 "--XyZ\r\nContent-Disposition: form-data; name=\"desired_height\"\r\n\r\n100\r\n"
+                                 "--XyZ\r\nContent-Disposition: form-data; name=\"image\"; filename=\"a.jpg\"\r\n"
+                                 "Content-Type: image/jpeg\r\n\r\n" +
+                                 image + "\r\n--XyZ--\r\n";
+              req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8082/resize_raw", form,
+                                             {{"Content-Type", "multipart/form-data; boundary=XyZ"}});
+              EXPECT_TRUE(req->response.result() == 200);
+              EXPECT_EQ(std::string(req->response.headers["Content-Type"]), "image/jpeg");
+              EXPECT_TRUE((decode_raw(req->response.body).size() == cv::Size{200, 100}));
+
+              // Errors are answered in json
+              req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8082/resize_raw", image,
+                                             {{"Content-Type", "text/plain"}});
+              EXPECT_TRUE(req->response.result() == 415);
+              EXPECT_EQ(std::string(req->response.headers["Content-Type"]), "application/json");
+
+              req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8082/resize_raw?desired_width=320", image,
+                                             {{"Content-Type", "application/octet-stream"}});
+              EXPECT_TRUE(req->response.result() == 400);
+              EXPECT_EQ(req->response.body, "{\"code\":400,\"Message\":\"desired_height is not available in data.\"}");
+
+              req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8082/resize_raw", form,
+                                             {{"Content-Type", "multipart/form-data; boundary=other"}});
+              EXPECT_TRUE(req->response.result() == 400); });
+}
+
+TEST(APP, admission_shedding)
+{
+    AppConfig config = test_config(8083);
+    config.admission_pixels = 1024 * 1024;
+    config.admission_bytes = 0;
+    config.admission_queue_size = 0;
+    config.retry_after_seconds = 3;
+    auto ctx = make_app_context(config);
+
+    // Hold the whole budget, nothing else is admitted nor allowed to wait
+    RequestCost held;
+    held.pixels = config.admission_pixels;
+    std::uint64_t ticket = 0;
+    ASSERT_TRUE(ctx->admission->acquire(held, []() {}, ticket) == AdmissionController::Result::ADMITTED);
+
+    std::string raw = encode_raw(cv::Mat(cv::Size{640, 480}, CV_8UC3, cv::Scalar(40, 80, 120)), ".jpg");
+    std::string image = base64_encode(raw);
+
+    serve(ctx, [&raw, &image](asyik::service_ptr as)
+          {
+              auto busy = [](const auto &req)
+              {
+                  EXPECT_TRUE(req->response.result() == 503);
+                  EXPECT_EQ(std::string(req->response.headers["Retry-After"]), "3");
+                  EXPECT_EQ(std::string(req->response.headers["Content-Type"]), "application/json");
+                  EXPECT_EQ(req->response.body, "{\"code\":503,\"Message\":\"Server is busy, try again later.\"}");
+              };
+
+              busy(asyik::http_easy_request(as, "POST", "http://127.0.0.1:8083/resize_image",
+                                            resize_request(image, 320, 240), {{"Content-Type", "application/json"}}));
+              busy(asyik::http_easy_request(as, "POST", "http://127.0.0.1:8083/resize_batch",
+                                            "{\"items\":[" + resize_request(image, 320, 240) + "]}",
+                                            {{"Content-Type", "application/json"}}));
+              busy(asyik::http_easy_request(as, "POST", "http://127.0.0.1:8083/resize_raw?desired_width=320&desired_height=240",
+                                            raw, {{"Content-Type", "application/octet-stream"}}));
+
+              // Invalid requests are refused before admission
+              auto req = asyik::http_easy_request(as, "POST", "http://127.0.0.1:8083/resize_image",
+                                                  "{\"input_jpeg\":\"" + image + "\",\"desired_width\":320,\"desired_height\":240,\"quality\":101}",
+                                                  {{"Content-Type", "application/json"}});
+              EXPECT_TRUE(req->response.result() == 400); });
+
+    AdmissionController::Stats stats = ctx->admission->stats();
+    EXPECT_EQ(stats.rejected, 3u);
+    ctx->admission->release(held);
+}
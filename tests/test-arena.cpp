@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include "image_resizer/mat_pool.hpp"
+#include "image_resizer/request_arena.hpp"
+
+TEST(Arena, mat_pool_size_classes)
+{
+    EXPECT_EQ(MatPool::size_class(1), 0u);
+    EXPECT_EQ(MatPool::class_capacity(0), 4096u);
+
+    for (std::size_t size_test = 1; size_test < (1u << 24); size_test = size_test * 3 / 2 + 7)
+    {
+        std::size_t index_test = MatPool::size_class(size_test);
+        EXPECT_GE(MatPool::class_capacity(index_test), size_test);
+        if (index_test > 0)
+        {
+            EXPECT_LT(MatPool::class_capacity(index_test - 1), size_test);
+        }
+        // Less than a fifth of every buffer is wasted
+        EXPECT_LE(MatPool::class_capacity(index_test), std::max<std::size_t>(4096, size_test + size_test / 4));
+    }
+}
+
+TEST(Arena, mat_pool_reuse)
+{
+    MatPool pool_test(64 * 1024 * 1024);
+
+    cv::Mat image_test1;
+    image_test1.allocator = &pool_test;
+    image_test1.create(480, 640, CV_8UC3);
+    image_test1.setTo(cv::Scalar(1, 2, 3));
+    const uchar *data_test1 = image_test1.data;
+    image_test1.release();
+
+    // A same sized image gets the released buffer back
+    cv::Mat image_test2;
+    image_test2.allocator = &pool_test;
+    image_test2.create(480, 640, CV_8UC3);
+    EXPECT_EQ(image_test2.data, data_test1);
+
+    // OpenCV functions allocate their outputs from the pool too
+    cv::Mat resized_test;
+    resized_test.allocator = &pool_test;
+    cv::resize(image_test2, resized_test, cv::Size(320, 240));
+    EXPECT_EQ(resized_test.size(), cv::Size(320, 240));
+    EXPECT_EQ(resized_test.u->currAllocator, &pool_test);
+
+    // Larger than the whole budget, allocated and freed without pooling
+    MatPool small_pool_test(1024 * 1024);
+    cv::Mat large_test;
+    large_test.allocator = &small_pool_test;
+    large_test.create(1080, 1920, CV_8UC3);
+    EXPECT_FALSE(large_test.empty());
+}
+
+TEST(Arena, mat_pool_shared_budget)
+{
+    MatPool pool_test(4 * 1024 * 1024);
+
+    // Allocated here, released on another thread, reused here once that thread is gone
+    cv::Mat image_test1;
+    image_test1.allocator = &pool_test;
+    image_test1.create(480, 640, CV_8UC3);
+    const uchar *data_test1 = image_test1.data;
+    std::thread([&image_test1]()
+                { image_test1.release(); })
+        .join();
+    EXPECT_GT(pool_test.cached_bytes(), 0u);
+
+    cv::Mat image_test2;
+    image_test2.allocator = &pool_test;
+    image_test2.create(480, 640, CV_8UC3);
+    EXPECT_EQ(image_test2.data, data_test1);
+    EXPECT_EQ(pool_test.cached_bytes(), 0u);
+
+    // Buffers released by many threads stay within the one budget
+    std::vector<std::thread> threads_test;
+    for (int i = 0; i < 16; ++i)
+    {
+        threads_test.emplace_back([&pool_test]()
+                                  {
+                                      cv::Mat image;
+                                      image.allocator = &pool_test;
+                                      image.create(480, 640, CV_8UC3);
+                                      image.release(); });
+    }
+    for (std::thread &thread_test : threads_test)
+        thread_test.join();
+    EXPECT_LE(pool_test.cached_bytes(), 4u * 1024 * 1024);
+    EXPECT_GT(pool_test.cached_bytes(), 0u);
+}
+
+TEST(Arena, request_arena)
+{
+    std::string body_test1 = "{\"input_jpeg\": \"QUJDRA==\", \"desired_width\": 640, \"desired_height\": 480}";
+    {
+        RequestArena arena_test;
+        RequestDocument &doc_test = arena_test.document();
+        ASSERT_FALSE(doc_test.ParseInsitu(&body_test1[0]).HasParseError());
+        EXPECT_EQ(doc_test["desired_width"].GetInt(), 640);
+        EXPECT_STREQ(doc_test["input_jpeg"].GetString(), "QUJDRA==");
+    }
+
+    // Several arenas may be alive at once on a thread, e.g. one per fiber
+    std::string body_test2 = "{\"items\": [{\"a\": 1}, {\"b\": 2}]}";
+    std::string body_test3 = "[1, 2, 3]";
+    RequestArena arena_test2, arena_test3;
+    ASSERT_FALSE(arena_test2.document().ParseInsitu(&body_test2[0]).HasParseError());
+    ASSERT_FALSE(arena_test3.document().ParseInsitu(&body_test3[0]).HasParseError());
+    EXPECT_EQ(arena_test2.document()["items"].Size(), 2u);
+    EXPECT_EQ(arena_test3.document().Size(), 3u);
+}
@@ -1,5 +1,7 @@
 #include "image_resizer/base64.hpp"
 #include <iostream>
+#include <random>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST(Base64, basic)
@@ -142,3 +144,86 @@ TEST(Base64, invalid_encoded)
         EXPECT_EQ(err.what(), std::string("Input is not valid base64-encoded data."));
     }
 }
+
+// Reference implementation the vectorized codec must stay byte-identical to
+static std::string reference_encode(std::string const &bytes_string)
+{
+    static const std::string chars{
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789+/"};
+    std::string enc;
+    int str_length = bytes_string.length();
+    for (int i = 0; i < str_length; i += 3)
+    {
+        enc.push_back(chars[(bytes_string[i] & 0xfc) >> 2]);
+        if (i + 1 < str_length)
+        {
+            enc.push_back(chars[((bytes_string[i] & 0x03) << 4) + ((bytes_string[i + 1] & 0xf0) >> 4)]);
+            if (i + 2 < str_length)
+            {
+                enc.push_back(chars[((bytes_string[i + 1] & 0x0f) << 2) + ((bytes_string[i + 2] & 0xc0) >> 6)]);
+                enc.push_back(chars[bytes_string[i + 2] & 0x3f]);
+            }
+            else
+            {
+                enc.push_back(chars[(bytes_string[i + 1] & 0x0f) << 2]);
+                enc.push_back('=');
+            }
+        }
+        else
+        {
+            enc.push_back(chars[(bytes_string[i] & 0x03) << 4]);
+            enc.push_back('=');
+            enc.push_back('=');
+        }
+    }
+    return enc;
+}
+
+TEST(Base64, matches_reference)
+{
+    // Cover the scalar tail and every vectorized block boundary
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (std::size_t length = 0; length < 512; ++length)
+    {
+        std::string original(length, '\0');
+        for (auto &chr : original)
+            chr = static_cast<char>(byte(rng));
+
+        std::string encoded = base64_encode(original);
+        ASSERT_EQ(encoded, reference_encode(original));
+        ASSERT_EQ(encoded.size(), base64_encoded_length(length));
+        ASSERT_EQ(base64_decode(encoded), original);
+    }
+
+    std::string large(5 * 1024 * 1024 + 7, '\0');
+    for (auto &chr : large)
+        chr = static_cast<char>(byte(rng));
+    std::string large_encoded = base64_encode(large);
+    ASSERT_EQ(large_encoded, reference_encode(large));
+    ASSERT_EQ(base64_decode(large_encoded), large);
+
+    // Buffer based API
+    std::vector<unsigned char> decoded(base64_decoded_length(large_encoded.size()));
+    std::size_t decoded_length = base64_decode(large_encoded.data(), large_encoded.size(), decoded.data());
+    ASSERT_EQ(decoded_length, large.size());
+    ASSERT_EQ(std::string(decoded.begin(), decoded.begin() + decoded_length), large);
+}
+
+TEST(Base64, invalid_encoded_any_position)
+{
+    // Invalid characters must be rejected wherever they land in a block
+    std::string encoded = base64_encode(std::string(300, 'x'));
+    for (std::size_t pos = 0; pos < encoded.size(); ++pos)
+    {
+        std::string corrupted = encoded;
+        corrupted[pos] = (pos % 2) ? '?' : '\x80';
+        EXPECT_THROW(base64_decode(corrupted), std::runtime_error);
+    }
+
+    // A dangling single character can not be decoded
+    EXPECT_THROW(base64_decode(encoded + "Y"), std::runtime_error);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "image_resizer/codec.hpp"
+
+TEST(ImageCodec, decode_into_caller_mat)
+{
+    ImageCodec &codec_test = default_codec();
+    cv::Mat origin_image_test(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::vector<uchar> buf;
+    cv::imencode(".jpg", origin_image_test, buf);
+
+    // Full size when the target needs every pixel
+    cv::Mat decoded_test;
+    EXPECT_TRUE(codec_test.decode(buf.data(), buf.size(), cv::Size{1280, 720}, decoded_test));
+    EXPECT_TRUE((decoded_test.size() == cv::Size{1280, 720}));
+    EXPECT_EQ(decoded_test.type(), CV_8UC3);
+    EXPECT_LE(cv::norm(decoded_test, origin_image_test, cv::NORM_INF), 4.0);
+
+    // A buffer of the right size is decoded into, not replaced
+    const uchar *data_test = decoded_test.data;
+    EXPECT_TRUE(codec_test.decode(buf.data(), buf.size(), cv::Size{1280, 720}, decoded_test));
+    EXPECT_EQ(decoded_test.data, data_test);
+
+    // Reduced scale still covering the target
+    cv::Mat reduced_test;
+    EXPECT_TRUE(codec_test.decode(buf.data(), buf.size(), cv::Size{300, 100}, reduced_test));
+    EXPECT_GE(reduced_test.cols, 300);
+    EXPECT_GE(reduced_test.rows, 100);
+    EXPECT_LE(reduced_test.cols, 640);
+
+    cv::imencode(".jpg", cv::Mat::zeros(cv::Size{321, 123}, CV_8UC1), buf);
+    cv::Mat grayscale_test;
+    EXPECT_TRUE(codec_test.decode(buf.data(), buf.size(), cv::Size{321, 123}, grayscale_test));
+    EXPECT_EQ(grayscale_test.type(), CV_8UC1);
+
+    // Other formats and garbage go through OpenCV
+    cv::imencode(".png", cv::Mat::zeros(cv::Size{77, 55}, CV_8UC4), buf);
+    cv::Mat png_test;
+    EXPECT_TRUE(codec_test.decode(buf.data(), buf.size(), cv::Size{10, 10}, png_test));
+    EXPECT_EQ(png_test.type(), CV_8UC4);
+
+    std::vector<uchar> garbage_test(64, 0xFF);
+    garbage_test[1] = 0xD8;
+    cv::Mat garbage_image_test;
+    EXPECT_FALSE(codec_test.decode(garbage_test.data(), garbage_test.size(), cv::Size{10, 10}, garbage_image_test));
+}
+
+TEST(ImageCodec, encode_round_trip)
+{
+    ImageCodec &codec_test = default_codec();
+    cv::Mat origin_image_test(cv::Size{640, 480}, CV_8UC3, cv::Scalar(40, 80, 120));
+
+    std::vector<uchar> buf_test1;
+    EXPECT_TRUE(codec_test.encode(origin_image_test, OutputFormat::JPEG, -1, -1, buf_test1));
+    cv::Mat decoded_test1 = cv::imdecode(buf_test1, cv::IMREAD_UNCHANGED);
+    EXPECT_TRUE((decoded_test1.size() == cv::Size{640, 480}));
+    EXPECT_LE(cv::norm(decoded_test1, origin_image_test, cv::NORM_INF), 4.0);
+
+    // Lower quality, smaller output
+    std::vector<uchar> buf_test2;
+    cv::Mat textured_image_test(cv::Size{640, 480}, CV_8UC3);
+    cv::randu(textured_image_test, cv::Scalar::all(0), cv::Scalar::all(255));
+    EXPECT_TRUE(codec_test.encode(textured_image_test, OutputFormat::JPEG, 95, -1, buf_test1));
+    EXPECT_TRUE(codec_test.encode(textured_image_test, OutputFormat::JPEG, 30, -1, buf_test2));
+    EXPECT_LT(buf_test2.size(), buf_test1.size());
+
+    // Four channels drop alpha, as cv::imencode does
+    cv::Mat alpha_image_test(cv::Size{64, 64}, CV_8UC4, cv::Scalar(40, 80, 120, 255));
+    EXPECT_TRUE(codec_test.encode(alpha_image_test, OutputFormat::JPEG, -1, -1, buf_test1));
+    EXPECT_EQ(cv::imdecode(buf_test1, cv::IMREAD_UNCHANGED).channels(), 3);
+
+    EXPECT_TRUE(codec_test.encode(origin_image_test, OutputFormat::PNG, -1, 1, buf_test1));
+    EXPECT_EQ(buf_test1[1], 'P');
+}
+
+TEST(ImageCodec, resample_yuv_planes)
+{
+    // 4:2:0 with odd sizes, luma padded to even
+    YuvImage source_test;
+    source_test.size = cv::Size{101, 75};
+    source_test.chroma_factor = cv::Size{2, 2};
+    source_test.planes.push_back(cv::Mat(cv::Size{102, 76}, CV_8UC1, cv::Scalar(200)));
+    source_test.planes.push_back(cv::Mat(cv::Size{51, 38}, CV_8UC1, cv::Scalar(90)));
+    source_test.planes.push_back(cv::Mat(cv::Size{51, 38}, CV_8UC1, cv::Scalar(160)));
+
+    YuvImage resized_test;
+    resample_yuv(source_test, resized_test, cv::Size{51, 37}, Interpolation::AREA);
+    ASSERT_EQ(resized_test.planes.size(), 3u);
+    EXPECT_TRUE((resized_test.size == cv::Size{51, 37}));
+    EXPECT_TRUE((resized_test.chroma_factor == cv::Size{2, 2}));
+    EXPECT_TRUE((resized_test.planes[0].size() == cv::Size{52, 38}));
+    EXPECT_TRUE((resized_test.planes[1].size() == cv::Size{26, 19}));
+    EXPECT_TRUE((resized_test.planes[2].size() == cv::Size{26, 19}));
+    EXPECT_EQ(resized_test.planes[0].at<uchar>(37, 51), 200);
+    EXPECT_EQ(resized_test.planes[2].at<uchar>(18, 25), 160);
+}
+
+TEST(ImageCodec, yuv_round_trip)
+{
+    ImageCodec &codec_test = default_codec();
+    if (!codec_test.yuv_supported(OutputFormat::JPEG, -1))
+        GTEST_SKIP() << "codec has no planar path";
+
+    EXPECT_FALSE(codec_test.yuv_supported(OutputFormat::PNG, -1));
+
+    cv::Mat origin_image_test(cv::Size{641, 481}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::vector<uchar> buf;
+    cv::imencode(".jpg", origin_image_test, buf);
+
+    YuvImage decoded_test;
+    ASSERT_TRUE(codec_test.decode_yuv(buf.data(), buf.size(), cv::Size{641, 481}, decoded_test));
+    EXPECT_TRUE((decoded_test.size == cv::Size{641, 481}));
+    EXPECT_EQ(decoded_test.planes.size(), 3u);
+
+    YuvImage resized_test;
+    resample_yuv(decoded_test, resized_test, cv::Size{321, 241}, Interpolation::LINEAR);
+    ASSERT_TRUE(codec_test.encode_yuv(resized_test, -1, buf));
+
+    cv::Mat output_test = cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+    EXPECT_TRUE((output_test.size() == cv::Size{321, 241}));
+    cv::Mat expected_test(cv::Size{321, 241}, CV_8UC3, cv::Scalar(40, 80, 120));
+    EXPECT_LE(cv::norm(output_test, expected_test, cv::NORM_INF), 6.0);
+
+    // PNG has no planes
+    cv::imencode(".png", origin_image_test, buf);
+    EXPECT_FALSE(codec_test.decode_yuv(buf.data(), buf.size(), cv::Size{10, 10}, decoded_test));
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "image_resizer/form_data.hpp"
+
+TEST(FormData, header_parameter)
+{
+    std::string value_test;
+    EXPECT_TRUE(header_parameter("multipart/form-data; boundary=----abc123", "boundary", value_test));
+    EXPECT_EQ(value_test, "----abc123");
+
+    EXPECT_TRUE(header_parameter("form-data; name=\"image\"; filename=\"a; b.jpg\"", "filename", value_test));
+    EXPECT_EQ(value_test, "a; b.jpg");
+    EXPECT_TRUE(header_parameter("form-data; name=\"image\"; filename=\"a; b.jpg\"", "name", value_test));
+    EXPECT_EQ(value_test, "image");
+
+    EXPECT_FALSE(header_parameter("application/octet-stream", "boundary", value_test));
+    EXPECT_FALSE(header_parameter("form-data; name=\"image", "name", value_test));
+}
+
+TEST(FormData, parse_multipart)
+{
+    // The image holds CRLF and a partial delimiter, it must be kept byte for byte
+    std::string image_test("\xff\xd8\r\n--Xy\x00\xff\xd9", 10);
+    std::string body_test = "--XyZ\r\n"
+                            "Content-Disposition: form-data; name=\"desired_width\"\r\n"
+                            "\r\n"
+                            "640\r\n"
+                            "--XyZ\r\n"
+                            "Content-Disposition: form-data; name=\"image\"; filename=\"photo.jpg\"\r\n"
+                            "Content-Type: image/jpeg\r\n"
+                            "\r\n" +
+                            image_test + "\r\n"
+                                         "--XyZ--\r\n";
+
+    std::vector<FormPart> parts_test;
+    ASSERT_TRUE(parse_multipart("multipart/form-data; boundary=XyZ", body_test.data(), body_test.size(), parts_test));
+    ASSERT_EQ(parts_test.size(), 2u);
+
+    EXPECT_EQ(parts_test[0].name, "desired_width");
+    EXPECT_TRUE(parts_test[0].filename.empty());
+    EXPECT_EQ(std::string(parts_test[0].data, parts_test[0].length), "640");
+
+    EXPECT_EQ(parts_test[1].name, "image");
+    EXPECT_EQ(parts_test[1].filename, "photo.jpg");
+    EXPECT_EQ(parts_test[1].content_type, "image/jpeg");
+    EXPECT_EQ(std::string(parts_test[1].data, parts_test[1].length), image_test);
+
+    // Missing boundary, truncated body, missing closing delimiter
+    std::vector<FormPart> parts_test2;
+    EXPECT_FALSE(parse_multipart("multipart/form-data", body_test.data(), body_test.size(), parts_test2));
+    EXPECT_FALSE(parse_multipart("multipart/form-data; boundary=XyZ", body_test.data(), 40, parts_test2));
+    std::string unterminated_test = body_test.substr(0, body_test.size() - 11);
+    EXPECT_FALSE(parse_multipart("multipart/form-data; boundary=XyZ", unterminated_test.data(), unterminated_test.size(), parts_test2));
+}
+
+TEST(FormData, query_parameter)
+{
+    std::string value_test;
+    EXPECT_TRUE(query_parameter("/resize_raw?desired_width=640&desired_height=480", "desired_height", value_test));
+    EXPECT_EQ(value_test, "480");
+    EXPECT_TRUE(query_parameter("/resize_raw?interpolation=qu%61lity+x", "interpolation", value_test));
+    EXPECT_EQ(value_test, "quality x");
+    EXPECT_FALSE(query_parameter("/resize_raw?desired_widths=640", "desired_width", value_test));
+    EXPECT_FALSE(query_parameter("/resize_raw", "desired_width", value_test));
+}
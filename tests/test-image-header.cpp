@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "image_resizer/image_header.hpp"
+
+TEST(ImageHeader, peek_encoded_images)
+{
+    std::vector<uchar> buf;
+
+    cv::imencode(".jpg", cv::Mat::zeros(cv::Size{1280, 720}, CV_8UC3), buf);
+    ImageHeader header_test1;
+    EXPECT_TRUE(peek_image_header(buf.data(), buf.size(), header_test1));
+    EXPECT_TRUE(header_test1.format == ImageHeader::Format::JPEG);
+    EXPECT_EQ(header_test1.width, 1280);
+    EXPECT_EQ(header_test1.height, 720);
+    EXPECT_EQ(header_test1.channels, 3);
+
+    cv::imencode(".jpg", cv::Mat::zeros(cv::Size{321, 123}, CV_8UC1), buf);
+    ImageHeader header_test2;
+    EXPECT_TRUE(peek_image_header(buf.data(), buf.size(), header_test2));
+    EXPECT_EQ(header_test2.width, 321);
+    EXPECT_EQ(header_test2.height, 123);
+    EXPECT_EQ(header_test2.channels, 1);
+
+    cv::imencode(".png", cv::Mat::zeros(cv::Size{77, 55}, CV_8UC4), buf);
+    ImageHeader header_test3;
+    EXPECT_TRUE(peek_image_header(buf.data(), buf.size(), header_test3));
+    EXPECT_TRUE(header_test3.format == ImageHeader::Format::PNG);
+    EXPECT_EQ(header_test3.width, 77);
+    EXPECT_EQ(header_test3.height, 55);
+    EXPECT_EQ(header_test3.channels, 4);
+}
+
+TEST(ImageHeader, invalid_header)
+{
+    std::vector<uchar> buf;
+    cv::imencode(".jpg", cv::Mat::zeros(cv::Size{64, 64}, CV_8UC3), buf);
+
+    // Truncated before the frame header
+    ImageHeader header_test1;
+    EXPECT_FALSE(peek_image_header(buf.data(), 20, header_test1));
+    EXPECT_TRUE(header_test1.format == ImageHeader::Format::UNKNOWN);
+
+    std::string text_test2{"The key point is how to convert a numpy array"};
+    ImageHeader header_test2;
+    EXPECT_FALSE(peek_image_header(reinterpret_cast<const unsigned char *>(text_test2.data()), text_test2.size(), header_test2));
+
+    ImageHeader header_test3;
+    EXPECT_FALSE(peek_image_header(nullptr, 0, header_test3));
+}
@@ -82,6 +82,11 @@ TEST(ImageResizerFunc, resizer_class_proc_str)
     EXPECT_EQ(res_test, Error(Error::Code::FAILED));
     EXPECT_STREQ(res_test.Message().c_str(), "Unable to parse input str to json.");
 
+    std::string empty_str_test;
+    Error empty_res_test = image_resizer_obj.process(empty_str_test, output_str_test);
+    EXPECT_EQ(empty_res_test, Error(Error::Code::FAILED));
+    EXPECT_STREQ(empty_res_test.Message().c_str(), "Unable to parse input str to json.");
+
     std::string input_str_test1{"{\"foo\":[123]}"};
     std::string output_str_test1;
     Error res_test1 = image_resizer_obj.process(input_str_test1, output_str_test1);
@@ -231,6 +236,351 @@ TEST(ImageResizerFunc, resizer_class_proc_json)
     EXPECT_STREQ(res_test4.Message().c_str(), "Input is not valid base64-encoded data.");
 }
 
+TEST(ImageResizerFunc, resizer_class_proc_stream)
+{
+    ImageResizer image_resizer_obj;
+    cv::Size mat_size{1280, 720};
+
+    rapidjson::Document input_doc_test1;
+    input_doc_test1.Parse("{\"input_jpeg\": \"AAA?A\", \"desired_width\": 640, \"desired_height\": 480}");
+
+    std::string output_str_test1;
+    Error res_test1 = image_resizer_obj.process(input_doc_test1, output_str_test1);
+    EXPECT_EQ(res_test1, Error(Error::Code::FAILED));
+    EXPECT_STREQ(res_test1.Message().c_str(), "Input is not valid base64-encoded data.");
+
+    cv::Mat origin_image_test2 = cv::Mat(mat_size, CV_8UC3);
+    std::string encoded_image_test2 = encode_image(origin_image_test2, ".jpg");
+
+    rapidjson::Document input_doc_test2;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test2, encoded_image_test2.c_str());
+    rapidjson::Pointer("/desired_width").Set(input_doc_test2, 640);
+    rapidjson::Pointer("/desired_height").Set(input_doc_test2, 480);
+
+    std::string output_str_test2;
+    Error res_test2 = image_resizer_obj.process(input_doc_test2, output_str_test2);
+    EXPECT_EQ(res_test2, Error::Success);
+
+    rapidjson::Document output_doc_test2;
+    EXPECT_FALSE(output_doc_test2.Parse(output_str_test2.c_str(), output_str_test2.size()).HasParseError());
+    EXPECT_TRUE(output_doc_test2.HasMember("output_jpeg"));
+
+    cv::Mat output_img_test2 = decode_image(output_doc_test2["output_jpeg"].GetString());
+    EXPECT_TRUE((output_img_test2.size() == cv::Size{640, 480}));
+}
+
+TEST(ImageResizerFunc, resizer_reduced_decode)
+{
+    ImageResizer image_resizer_obj;
+    cv::Size mat_size{1280, 720};
+
+    // Thumbnails of large JPEGs are decoded at 1/2, 1/4 or 1/8 scale first
+    for (int type : {CV_8UC1, CV_8UC3})
+    {
+        cv::Mat origin_image_test = cv::Mat(mat_size, type, cv::Scalar::all(128));
+        std::string encoded_image_test = encode_image(origin_image_test, ".jpg");
+
+        for (cv::Size target : {cv::Size{160, 90}, cv::Size{150, 100}, cv::Size{640, 360}, cv::Size{1000, 700}})
+        {
+            rapidjson::Document input_doc_test, output_doc_test;
+            rapidjson::Pointer("/input_jpeg").Set(input_doc_test, encoded_image_test.c_str());
+            rapidjson::Pointer("/desired_width").Set(input_doc_test, target.width);
+            rapidjson::Pointer("/desired_height").Set(input_doc_test, target.height);
+
+            Error res_test = image_resizer_obj.process(input_doc_test, output_doc_test);
+            EXPECT_EQ(res_test, Error::Success);
+
+            cv::Mat output_img_test = decode_image(output_doc_test["output_jpeg"].GetString());
+            EXPECT_TRUE(output_img_test.size() == target);
+            EXPECT_EQ(output_img_test.channels(), origin_image_test.channels());
+        }
+    }
+}
+
+TEST(ImageResizerFunc, resizer_interpolation)
+{
+    Interpolation interpolation_test1 = Interpolation::NEAREST;
+    EXPECT_TRUE(parse_interpolation("lanczos", interpolation_test1));
+    EXPECT_TRUE(interpolation_test1 == Interpolation::LANCZOS);
+    EXPECT_TRUE(parse_interpolation("balanced", interpolation_test1));
+    EXPECT_TRUE(interpolation_test1 == Interpolation::LINEAR);
+    EXPECT_FALSE(parse_interpolation("bilinear", interpolation_test1));
+    EXPECT_TRUE(interpolation_test1 == Interpolation::LINEAR);
+
+    ImageResizer image_resizer_obj;
+    cv::Mat origin_image_test = cv::Mat(cv::Size{1920, 1080}, CV_8UC3, cv::Scalar(10, 120, 230));
+    std::string encoded_image_test = encode_image(origin_image_test, ".png");
+
+    for (const char *name : {"nearest", "linear", "area", "cubic", "lanczos", "fast", "balanced", "quality"})
+    {
+        for (cv::Size target : {cv::Size{160, 90}, cv::Size{1280, 720}, cv::Size{2560, 1440}})
+        {
+            rapidjson::Document input_doc_test, output_doc_test;
+            rapidjson::Pointer("/input_jpeg").Set(input_doc_test, encoded_image_test.c_str());
+            rapidjson::Pointer("/desired_width").Set(input_doc_test, target.width);
+            rapidjson::Pointer("/desired_height").Set(input_doc_test, target.height);
+            rapidjson::Pointer("/interpolation").Set(input_doc_test, name);
+
+            Error res_test = image_resizer_obj.process(input_doc_test, output_doc_test);
+            EXPECT_EQ(res_test, Error::Success);
+
+            cv::Mat output_img_test = decode_image(output_doc_test["output_jpeg"].GetString());
+            EXPECT_TRUE(output_img_test.size() == target);
+        }
+    }
+
+    rapidjson::Document input_doc_test2, output_doc_test2;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test2, encoded_image_test.c_str());
+    rapidjson::Pointer("/desired_width").Set(input_doc_test2, 640);
+    rapidjson::Pointer("/desired_height").Set(input_doc_test2, 480);
+    rapidjson::Pointer("/interpolation").Set(input_doc_test2, "bilinear");
+
+    Error res_test2 = image_resizer_obj.process(input_doc_test2, output_doc_test2);
+    EXPECT_EQ(res_test2, Error(Error::Code::FAILED));
+    EXPECT_STREQ(res_test2.Message().c_str(), "interpolation must be one of nearest, linear, area, cubic, lanczos, fast, balanced or quality.");
+}
+
+TEST(ImageResizerFunc, resizer_multi_size)
+{
+    ImageResizer image_resizer_obj;
+    cv::Mat origin_image_test = cv::Mat(cv::Size{1920, 1080}, CV_8UC3, cv::Scalar(10, 120, 230));
+    std::string encoded_image_test = encode_image(origin_image_test, ".jpg");
+    std::vector<cv::Size> sizes_test{{320, 180}, {1280, 720}, {100, 400}, {640, 360}};
+
+    rapidjson::Document input_doc_test1;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test1, encoded_image_test.c_str());
+    rapidjson::Pointer("/interpolation").Set(input_doc_test1, "quality");
+    for (std::size_t i = 0; i < sizes_test.size(); ++i)
+    {
+        rapidjson::Pointer(("/sizes/" + std::to_string(i) + "/width").c_str()).Set(input_doc_test1, sizes_test[i].width);
+        rapidjson::Pointer(("/sizes/" + std::to_string(i) + "/height").c_str()).Set(input_doc_test1, sizes_test[i].height);
+    }
+
+    // Streamed response keeps the order of the requested sizes
+    std::string output_str_test1;
+    Error res_test1 = image_resizer_obj.process(input_doc_test1, output_str_test1);
+    EXPECT_EQ(res_test1, Error::Success);
+
+    rapidjson::Document output_doc_test1;
+    EXPECT_FALSE(output_doc_test1.Parse(output_str_test1.c_str(), output_str_test1.size()).HasParseError());
+    ASSERT_TRUE(output_doc_test1.HasMember("outputs"));
+    ASSERT_EQ(output_doc_test1["outputs"].Size(), sizes_test.size());
+    for (rapidjson::SizeType i = 0; i < sizes_test.size(); ++i)
+    {
+        const rapidjson::Value &output = output_doc_test1["outputs"][i];
+        EXPECT_EQ(output["width"].GetInt(), sizes_test[i].width);
+        EXPECT_EQ(output["height"].GetInt(), sizes_test[i].height);
+        cv::Mat output_img_test = decode_image(output["output_jpeg"].GetString());
+        EXPECT_TRUE(output_img_test.size() == sizes_test[i]);
+    }
+
+    rapidjson::Document output_doc_test2;
+    Error res_test2 = image_resizer_obj.process(input_doc_test1, output_doc_test2);
+    EXPECT_EQ(res_test2, Error::Success);
+    ASSERT_TRUE(output_doc_test2.HasMember("outputs"));
+    ASSERT_EQ(output_doc_test2["outputs"].Size(), sizes_test.size());
+    cv::Mat output_img_test2 = decode_image(output_doc_test2["outputs"][2]["output_jpeg"].GetString());
+    EXPECT_TRUE(output_img_test2.size() == sizes_test[2]);
+
+    rapidjson::Document input_doc_test3, output_doc_test3;
+    input_doc_test3.Parse("{\"input_jpeg\": \"AAAA\", \"sizes\": [{\"width\": 10}]}");
+    Error res_test3 = image_resizer_obj.process(input_doc_test3, output_doc_test3);
+    EXPECT_EQ(res_test3, Error(Error::Code::FAILED));
+    EXPECT_STREQ(res_test3.Message().c_str(), "sizes must be a non-empty array of {width, height} objects.");
+
+    // Dimensions beyond the JPEG limit are refused before decoding
+    for (const char *request : {"{\"input_jpeg\": \"AAAA\", \"sizes\": [{\"width\": 10, \"height\": 65501}]}",
+                                "{\"input_jpeg\": \"AAAA\", \"desired_width\": 0, \"desired_height\": 10}"})
+    {
+        rapidjson::Document input_doc_test4, output_doc_test4;
+        input_doc_test4.Parse(request);
+        Error res_test4 = image_resizer_obj.process(input_doc_test4, output_doc_test4);
+        EXPECT_EQ(res_test4, Error(Error::Code::FAILED));
+        EXPECT_STREQ(res_test4.Message().c_str(), "Target width and height must be integers between 1 and 65500.");
+    }
+}
+
+TEST(ImageResizerFunc, resizer_result_cache)
+{
+    auto cache_test = std::make_shared<ResultCache>(16 * 1024 * 1024);
+    ImageResizer image_resizer_obj(cache_test);
+
+    cv::Mat origin_image_test = cv::Mat(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::string encoded_image_test = encode_image(origin_image_test, ".jpg");
+
+    rapidjson::Document input_doc_test1;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test1, encoded_image_test.c_str());
+    rapidjson::Pointer("/desired_width").Set(input_doc_test1, 640);
+    rapidjson::Pointer("/desired_height").Set(input_doc_test1, 480);
+
+    std::string output_str_test1, output_str_test2;
+    EXPECT_EQ(image_resizer_obj.process(input_doc_test1, output_str_test1), Error::Success);
+    EXPECT_EQ(image_resizer_obj.process(input_doc_test1, output_str_test2), Error::Success);
+    EXPECT_EQ(output_str_test1, output_str_test2);
+
+    // Another parameter is another response
+    rapidjson::Pointer("/interpolation").Set(input_doc_test1, "area");
+    std::string output_str_test3;
+    EXPECT_EQ(image_resizer_obj.process(input_doc_test1, output_str_test3), Error::Success);
+
+    ResultCache::Stats stats_test = cache_test->stats();
+    EXPECT_EQ(stats_test.hits, 1u);
+    EXPECT_EQ(stats_test.misses, 2u);
+    EXPECT_EQ(stats_test.entries, 2u);
+}
+
+TEST(ImageResizerFunc, resizer_cache_lookup)
+{
+    auto cache_test = std::make_shared<ResultCache>(16 * 1024 * 1024);
+    ImageResizer image_resizer_obj(cache_test);
+
+    cv::Mat origin_image_test = cv::Mat(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::string encoded_image_test = encode_image(origin_image_test, ".jpg");
+    rapidjson::Document input_doc_test;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test, encoded_image_test.c_str());
+    rapidjson::Pointer("/desired_width").Set(input_doc_test, 640);
+    rapidjson::Pointer("/desired_height").Set(input_doc_test, 480);
+
+    // A miss hands its key to decode, which does not look it up again
+    ResizeJob probe_test1;
+    std::string lookup_str_test1;
+    EXPECT_FALSE(image_resizer_obj.lookup(input_doc_test, probe_test1, OutputFormat::JPEG, lookup_str_test1));
+    EXPECT_TRUE(probe_test1.cache_checked);
+    EXPECT_TRUE(lookup_str_test1.empty());
+
+    ResizeJob job_test;
+    job_test.key = probe_test1.key;
+    job_test.cache_checked = true;
+    ASSERT_EQ(image_resizer_obj.decode(input_doc_test, job_test), Error::Success);
+    image_resizer_obj.resize(job_test);
+    std::string output_str_test;
+    ASSERT_EQ(image_resizer_obj.encode(job_test, output_str_test), Error::Success);
+    EXPECT_EQ(cache_test->stats().misses, 1u);
+
+    ResizeJob probe_test2;
+    std::string lookup_str_test2;
+    EXPECT_TRUE(image_resizer_obj.lookup(input_doc_test, probe_test2, OutputFormat::JPEG, lookup_str_test2));
+    EXPECT_EQ(lookup_str_test2, output_str_test);
+    EXPECT_EQ(cache_test->stats().hits, 1u);
+}
+
+TEST(ImageResizerFunc, resizer_raw_bytes)
+{
+    ImageResizer image_resizer_obj;
+
+    cv::Mat origin_image_test = cv::Mat(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::vector<uchar> encoded_image_test;
+    cv::imencode(".png", origin_image_test, encoded_image_test);
+
+    ResizeOptions options_test;
+    options_test.sizes.emplace_back(640, 480);
+
+    std::string output_str_test1;
+    Error res_test1 = image_resizer_obj.process_raw(encoded_image_test.data(), encoded_image_test.size(), options_test, output_str_test1);
+    EXPECT_EQ(res_test1, Error::Success);
+
+    // Raw JPEG bytes, no base64 nor json around them
+    std::vector<uchar> output_bytes_test1(output_str_test1.begin(), output_str_test1.end());
+    cv::Mat output_img_test1 = cv::imdecode(output_bytes_test1, cv::IMREAD_UNCHANGED);
+    EXPECT_TRUE((output_img_test1.size() == cv::Size{640, 480}));
+
+    std::string output_str_test2;
+    Error res_test2 = image_resizer_obj.process_raw(encoded_image_test.data(), 16, options_test, output_str_test2);
+    EXPECT_EQ(res_test2, Error(Error::Code::FAILED));
+    EXPECT_STREQ(res_test2.Message().c_str(), "Input is not a valid image encoded data.");
+
+    options_test.sizes.emplace_back(320, 240);
+    Error res_test3 = image_resizer_obj.process_raw(encoded_image_test.data(), encoded_image_test.size(), options_test, output_str_test2);
+    EXPECT_EQ(res_test3, Error(Error::Code::FAILED));
+}
+
+TEST(ImageResizerFunc, resizer_output_format)
+{
+    ImageResizer image_resizer_obj;
+
+    cv::Mat origin_image_test = cv::Mat(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::string encoded_image_test = encode_image(origin_image_test, ".jpg");
+
+    rapidjson::Document input_doc_test1;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test1, encoded_image_test.c_str());
+    rapidjson::Pointer("/desired_width").Set(input_doc_test1, 640);
+    rapidjson::Pointer("/desired_height").Set(input_doc_test1, 480);
+    rapidjson::Pointer("/output_format").Set(input_doc_test1, "png");
+    rapidjson::Pointer("/effort").Set(input_doc_test1, 1);
+
+    std::string output_str_test1;
+    EXPECT_EQ(image_resizer_obj.process(input_doc_test1, output_str_test1), Error::Success);
+
+    rapidjson::Document output_doc_test1;
+    output_doc_test1.Parse(output_str_test1.c_str());
+    ASSERT_TRUE(output_doc_test1.HasMember("output_image"));
+    EXPECT_FALSE(output_doc_test1.HasMember("output_jpeg"));
+    EXPECT_STREQ(output_doc_test1["output_format"].GetString(), "png");
+
+    // PNG is lossless, the flat color survives the round trip
+    std::string output_bytes_test1 = base64_decode(output_doc_test1["output_image"].GetString());
+    EXPECT_EQ(output_bytes_test1.compare(1, 3, "PNG"), 0);
+    cv::Mat output_img_test1 = decode_image(output_doc_test1["output_image"].GetString());
+    EXPECT_TRUE((output_img_test1.size() == cv::Size{640, 480}));
+
+    // The negotiated format only applies when the request names none
+    rapidjson::Document input_doc_test2;
+    rapidjson::Pointer("/input_jpeg").Set(input_doc_test2, encoded_image_test.c_str());
+    rapidjson::Pointer("/desired_width").Set(input_doc_test2, 64);
+    rapidjson::Pointer("/desired_height").Set(input_doc_test2, 48);
+    std::string output_str_test2;
+    EXPECT_EQ(image_resizer_obj.process(input_doc_test2, output_str_test2, OutputFormat::PNG), Error::Success);
+    EXPECT_NE(output_str_test2.find("\"output_format\":\"png\""), std::string::npos);
+
+    rapidjson::Pointer("/output_format").Set(input_doc_test2, "jpeg");
+    rapidjson::Pointer("/quality").Set(input_doc_test2, 50);
+    std::string output_str_test3;
+    EXPECT_EQ(image_resizer_obj.process(input_doc_test2, output_str_test3, OutputFormat::PNG), Error::Success);
+    EXPECT_EQ(output_str_test3.compare(0, 15, "{\"output_jpeg\":"), 0);
+
+    rapidjson::Pointer("/output_format").Set(input_doc_test2, "gif");
+    std::string output_str_test4;
+    Error res_test4 = image_resizer_obj.process(input_doc_test2, output_str_test4);
+    EXPECT_EQ(res_test4, Error(Error::Code::FAILED));
+    EXPECT_STREQ(res_test4.Message().c_str(), "output_format must be one of jpeg, png, webp or avif.");
+
+    rapidjson::Pointer("/output_format").Set(input_doc_test2, "jpeg");
+    rapidjson::Pointer("/quality").Set(input_doc_test2, 101);
+    Error res_test5 = image_resizer_obj.process(input_doc_test2, output_str_test4);
+    EXPECT_STREQ(res_test5.Message().c_str(), "quality must be an integer between 1 and 100.");
+
+    rapidjson::Pointer("/quality").Set(input_doc_test2, 80);
+    rapidjson::Pointer("/effort").Set(input_doc_test2, 10);
+    Error res_test6 = image_resizer_obj.process(input_doc_test2, output_str_test4);
+    EXPECT_STREQ(res_test6.Message().c_str(), "effort must be an integer between 0 and 9.");
+}
+
+TEST(ImageResizerFunc, output_format_negotiation)
+{
+    OutputFormat format_test = OutputFormat::JPEG;
+    EXPECT_FALSE(negotiate_output_format("", format_test));
+    EXPECT_FALSE(negotiate_output_format("*/*", format_test));
+    EXPECT_FALSE(negotiate_output_format("image/*, text/html", format_test));
+    EXPECT_EQ(format_test, OutputFormat::JPEG);
+
+    EXPECT_TRUE(negotiate_output_format("image/png", format_test));
+    EXPECT_EQ(format_test, OutputFormat::PNG);
+
+    // Ties go to the smaller format, q values win over that
+    EXPECT_TRUE(negotiate_output_format("image/png, image/jpeg", format_test));
+    EXPECT_EQ(format_test, OutputFormat::JPEG);
+    EXPECT_TRUE(negotiate_output_format("image/png;q=1.0, Image/JPEG; q=0.5", format_test));
+    EXPECT_EQ(format_test, OutputFormat::PNG);
+    EXPECT_TRUE(negotiate_output_format("image/jpeg;q=0, image/png;q=0.1", format_test));
+    EXPECT_EQ(format_test, OutputFormat::PNG);
+
+    if (output_format_supported(OutputFormat::WEBP))
+    {
+        EXPECT_TRUE(negotiate_output_format("image/jpeg,image/webp,*/*;q=0.8", format_test));
+        EXPECT_EQ(format_test, OutputFormat::WEBP);
+    }
+}
+
 TEST(ImageResizerFunc, failed_image_encode)
 {
     std::string encoded_str_err{
@@ -246,3 +596,28 @@ TEST(ImageResizerFunc, failed_image_encode)
 
     EXPECT_THROW(decode_image(encoded_str_err), std::runtime_error);
 }
+
+TEST(ImageResizerFunc, validate_options)
+{
+    rapidjson::Document input_doc_test;
+    input_doc_test.Parse(R"({"input_jpeg": "", "desired_width": 640, "desired_height": 480})");
+    EXPECT_EQ(ImageResizer::validate_options(input_doc_test), Error::Success);
+
+    // Every optional field is checked as decode reads it
+    const char *invalid_tests[] = {
+        R"({"input_jpeg": "", "desired_width": 0, "desired_height": 480})",
+        R"({"input_jpeg": "", "sizes": []})",
+        R"({"input_jpeg": "", "sizes": [{"width": 640}]})",
+        R"({"input_jpeg": "", "desired_width": 640, "desired_height": 480, "interpolation": "bicubic"})",
+        R"({"input_jpeg": "", "desired_width": 640, "desired_height": 480, "output_format": "gif"})",
+        R"({"input_jpeg": "", "desired_width": 640, "desired_height": 480, "quality": 101})",
+        R"({"input_jpeg": "", "desired_width": 640, "desired_height": 480, "effort": -1})",
+    };
+    for (const char *invalid_test : invalid_tests)
+    {
+        input_doc_test.Parse(invalid_test);
+        Error res_test = ImageResizer::validate_options(input_doc_test);
+        EXPECT_EQ(res_test, Error(Error::Code::FAILED)) << invalid_test;
+        EXPECT_FALSE(res_test.Message().empty());
+    }
+}
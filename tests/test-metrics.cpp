@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "image_resizer/metrics.hpp"
+
+TEST(Metrics, stage_histograms)
+{
+    Metrics metrics_test;
+
+    // Recorded from several threads, summed when rendered
+    std::vector<std::thread> threads_test;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads_test.emplace_back([&metrics_test]()
+                                  {
+                                      for (int i = 0; i < 1000; ++i)
+                                          metrics_test.observe(Stage::RESIZE, 2000000); // 2ms
+                                      metrics_test.observe(Stage::RESIZE, 20000000000ULL); // 20s
+                                  });
+    }
+    for (auto &thread : threads_test)
+        thread.join();
+
+    {
+        StageTimer timer_test(&metrics_test, Stage::PARSE);
+    }
+    StageTimer disabled_timer_test(nullptr, Stage::PARSE);
+
+    std::string output_test;
+    metrics_test.render(output_test);
+
+    EXPECT_NE(output_test.find("# TYPE image_resizer_stage_duration_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_stage_duration_seconds_bucket{stage=\"resize\",le=\"0.001\"} 0\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_stage_duration_seconds_bucket{stage=\"resize\",le=\"0.0025\"} 4000\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_stage_duration_seconds_bucket{stage=\"resize\",le=\"10\"} 4000\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_stage_duration_seconds_bucket{stage=\"resize\",le=\"+Inf\"} 4004\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_stage_duration_seconds_sum{stage=\"resize\"} 88.000000000\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_stage_duration_seconds_count{stage=\"parse\"} 1\n"), std::string::npos);
+}
+
+TEST(Metrics, request_counters)
+{
+    Metrics metrics_test;
+    metrics_test.count_request(200, 1000, 300);
+    metrics_test.count_request(200, 1000, 300);
+    metrics_test.count_request(503, 500, 50);
+    metrics_test.add_in_flight(3);
+    metrics_test.add_in_flight(-1);
+
+    std::string output_test;
+    metrics_test.render(output_test);
+
+    EXPECT_NE(output_test.find("image_resizer_requests_total{code=\"200\"} 2\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_requests_total{code=\"503\"} 1\n"), std::string::npos);
+    EXPECT_EQ(output_test.find("image_resizer_requests_total{code=\"400\"}"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_requests_in_flight 2\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_request_bytes_total 2500\n"), std::string::npos);
+    EXPECT_NE(output_test.find("image_resizer_response_bytes_total 650\n"), std::string::npos);
+}
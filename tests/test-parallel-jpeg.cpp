@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <jpeglib.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "image_resizer/image_resizer.hpp"
+#include "image_resizer/parallel_jpeg.hpp"
+
+/// @brief Decode with plain libjpeg, counting the corrupt data warnings a bad restart marker raises
+static cv::Mat libjpeg_decode(const std::vector<uchar> &buffer, unsigned int &restart_interval, long &warnings)
+{
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr error;
+    cinfo.err = jpeg_std_error(&error);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, buffer.data(), buffer.size());
+    jpeg_read_header(&cinfo, TRUE);
+    restart_interval = cinfo.restart_interval;
+    jpeg_start_decompress(&cinfo);
+
+    cv::Mat image(cinfo.output_height, cinfo.output_width, CV_8UC(cinfo.output_components));
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW rows[1] = {image.ptr<uchar>(cinfo.output_scanline)};
+        jpeg_read_scanlines(&cinfo, rows, 1);
+    }
+    warnings = error.num_warnings;
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return image;
+}
+
+static cv::Mat noisy_image(const cv::Size &size, int type)
+{
+    cv::Mat image(size, type);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+    return image;
+}
+
+TEST(ParallelJpeg, matches_serial_encoding)
+{
+    // Heights that are not a multiple of the MCU height leave a short last band
+    for (int type : {CV_8UC1, CV_8UC3, CV_8UC4})
+    {
+        cv::Mat image_test = noisy_image(cv::Size{1003, 517}, type);
+        std::vector<uchar> serial_test;
+        ASSERT_TRUE(encode_jpeg_parallel(image_test, 80, 1, serial_test));
+
+        for (std::size_t bands : {2, 5, 64})
+        {
+            std::vector<uchar> parallel_test;
+            ASSERT_TRUE(encode_jpeg_parallel(image_test, 80, bands, parallel_test));
+            EXPECT_EQ(parallel_test, serial_test);
+        }
+    }
+}
+
+TEST(ParallelJpeg, standard_decoders_accept)
+{
+    for (int type : {CV_8UC1, CV_8UC3, CV_8UC4})
+    {
+        for (cv::Size size : {cv::Size{1920, 1080}, cv::Size{9, 7}})
+        {
+            cv::Mat image_test(size, type, cv::Scalar(40, 80, 120, 255));
+            std::vector<uchar> buffer_test;
+            ASSERT_TRUE(encode_jpeg_parallel(image_test, -1, 8, buffer_test));
+
+            unsigned int restart_interval_test;
+            long warnings_test;
+            cv::Mat libjpeg_test = libjpeg_decode(buffer_test, restart_interval_test, warnings_test);
+            EXPECT_TRUE(libjpeg_test.size() == size);
+            EXPECT_GT(restart_interval_test, 0u);
+            EXPECT_EQ(warnings_test, 0);
+
+            cv::Mat opencv_test = cv::imdecode(buffer_test, cv::IMREAD_UNCHANGED);
+            ASSERT_TRUE(opencv_test.size() == size);
+            EXPECT_EQ(opencv_test.channels(), type == CV_8UC1 ? 1 : 3);
+            if (type == CV_8UC3)
+            {
+                EXPECT_LE(cv::norm(opencv_test, image_test, cv::NORM_INF), 4.0);
+            }
+        }
+    }
+
+    cv::Mat float_test(cv::Size{64, 64}, CV_32FC3);
+    std::vector<uchar> buffer_test;
+    EXPECT_FALSE(encode_jpeg_parallel(float_test, -1, 4, buffer_test));
+}
+
+TEST(ParallelJpeg, resizer_encodes_large_outputs_in_bands)
+{
+    cv::Mat source_test = noisy_image(cv::Size{1280, 720}, CV_8UC3);
+    std::vector<uchar> png_test;
+    cv::imencode(".png", source_test, png_test);
+
+    ResizeOptions options_test;
+    options_test.sizes.emplace_back(1024, 768);
+
+    // Every JPEG output is encoded in bands
+    ImageResizer parallel_resizer_test(nullptr, nullptr, 0, 1);
+    std::string parallel_test;
+    ASSERT_EQ(parallel_resizer_test.process_raw(png_test.data(), png_test.size(), options_test, parallel_test), Error::Success);
+
+    std::vector<uchar> parallel_bytes_test(parallel_test.begin(), parallel_test.end());
+    unsigned int restart_interval_test;
+    long warnings_test;
+    cv::Mat decoded_test = libjpeg_decode(parallel_bytes_test, restart_interval_test, warnings_test);
+    EXPECT_TRUE((decoded_test.size() == cv::Size{1024, 768}));
+    EXPECT_EQ(restart_interval_test, 64u);
+    EXPECT_EQ(warnings_test, 0);
+
+    // Optimized Huffman tables keep the codec
+    options_test.effort = 9;
+    std::string optimized_test;
+    ASSERT_EQ(parallel_resizer_test.process_raw(png_test.data(), png_test.size(), options_test, optimized_test), Error::Success);
+    std::vector<uchar> optimized_bytes_test(optimized_test.begin(), optimized_test.end());
+    libjpeg_decode(optimized_bytes_test, restart_interval_test, warnings_test);
+    EXPECT_EQ(restart_interval_test, 0u);
+}
+
+TEST(ParallelJpeg, resizer_encodes_large_outputs_of_jpeg_sources_in_bands)
+{
+    // JPEG to JPEG would otherwise stay in YCbCr when the codec allows it
+    cv::Mat source_test = noisy_image(cv::Size{1280, 720}, CV_8UC3);
+    std::vector<uchar> jpeg_test;
+    cv::imencode(".jpg", source_test, jpeg_test);
+
+    ResizeOptions options_test;
+    options_test.sizes.emplace_back(1024, 768);
+
+    ImageResizer parallel_resizer_test(nullptr, nullptr, 0, 1024 * 768);
+    std::string parallel_test;
+    ASSERT_EQ(parallel_resizer_test.process_raw(jpeg_test.data(), jpeg_test.size(), options_test, parallel_test), Error::Success);
+
+    std::vector<uchar> parallel_bytes_test(parallel_test.begin(), parallel_test.end());
+    unsigned int restart_interval_test;
+    long warnings_test;
+    cv::Mat decoded_test = libjpeg_decode(parallel_bytes_test, restart_interval_test, warnings_test);
+    EXPECT_TRUE((decoded_test.size() == cv::Size{1024, 768}));
+    EXPECT_EQ(restart_interval_test, 64u);
+    EXPECT_EQ(warnings_test, 0);
+}
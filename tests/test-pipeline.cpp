@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "image_resizer/image_resizer.hpp"
+#include "image_resizer/mpmc_queue.hpp"
+#include "image_resizer/resize_pipeline.hpp"
+
+TEST(MpmcQueue, bounded_fifo)
+{
+    MpmcQueue<int> queue(3);
+    EXPECT_EQ(queue.capacity(), 4u);
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(queue.try_push(i));
+    int value = 42;
+    EXPECT_FALSE(queue.try_push(value));
+    EXPECT_EQ(queue.size(), 4u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(MpmcQueue, concurrent_producers_and_consumers)
+{
+    MpmcQueue<int> queue(64);
+    const int per_producer = 20000;
+    std::atomic<long long> sum{0};
+    std::atomic<int> popped{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 4; ++p)
+    {
+        threads.emplace_back([&, p]()
+                             {
+                                 for (int i = 1; i <= per_producer; ++i)
+                                 {
+                                     int value = p * per_producer + i;
+                                     while (!queue.try_push(value))
+                                         std::this_thread::yield();
+                                 } });
+    }
+    for (int c = 0; c < 4; ++c)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 int value;
+                                 while (popped.load() < 4 * per_producer)
+                                 {
+                                     if (queue.try_pop(value))
+                                     {
+                                         sum += value;
+                                         ++popped;
+                                     }
+                                     else
+                                     {
+                                         std::this_thread::yield();
+                                     }
+                                 } });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    long long count = 4LL * per_producer;
+    EXPECT_EQ(popped.load(), count);
+    EXPECT_EQ(sum.load(), count * (count + 1) / 2);
+}
+
+TEST(ResizePipeline, processes_raw_requests)
+{
+    auto resizer = std::make_shared<ImageResizer>(nullptr);
+    PipelineOptions options;
+    options.decode_threads = 2;
+    options.resize_threads = 1;
+    options.encode_threads = 2;
+    options.queue_capacity = 64;
+
+    cv::Mat source_test(cv::Size{640, 480}, CV_8UC3, cv::Scalar(10, 120, 230));
+    std::vector<uchar> jpeg_test;
+    cv::imencode(".jpg", source_test, jpeg_test);
+
+    const int request_count = 32;
+    std::vector<std::string> outputs(request_count);
+    std::vector<std::promise<Error>> results(request_count);
+    {
+        ResizePipeline pipeline(resizer, options);
+        for (int i = 0; i < request_count; ++i)
+        {
+            // Every other request carries a broken image and fails in the decode stage
+            std::size_t length = i % 2 == 0 ? jpeg_test.size() : 16;
+            ASSERT_TRUE(pipeline.try_submit([&jpeg_test, length](ImageResizer &stage_resizer, ResizeJob &job)
+                                            {
+                                                job.options.sizes.assign(1, cv::Size{160, 120});
+                                                return stage_resizer.decode_raw(jpeg_test.data(), length, job); },
+                                            outputs[i], [&results, i](const Error &status)
+                                            { results[i].set_value(status); }));
+        }
+
+        for (int i = 0; i < request_count; ++i)
+        {
+            Error status = results[i].get_future().get();
+            EXPECT_EQ(status.IsOk(), i % 2 == 0);
+        }
+
+        std::vector<ResizePipeline::StageStats> stats = pipeline.stats();
+        ASSERT_EQ(stats.size(), 3u);
+        EXPECT_STREQ(stats[0].name, "decode");
+        EXPECT_EQ(stats[0].threads, 2u);
+        EXPECT_EQ(stats[0].capacity, 64u);
+        EXPECT_EQ(stats[0].jobs, static_cast<std::uint64_t>(request_count));
+        EXPECT_EQ(stats[1].jobs, static_cast<std::uint64_t>(request_count / 2));
+        EXPECT_EQ(stats[0].queued, 0u);
+    }
+
+    cv::Mat output_test = cv::imdecode(std::vector<uchar>(outputs[0].begin(), outputs[0].end()), cv::IMREAD_UNCHANGED);
+    EXPECT_TRUE((output_test.size() == cv::Size{160, 120}));
+    EXPECT_TRUE(outputs[1].empty());
+}
+
+TEST(ResizePipeline, matches_process)
+{
+    auto resizer = std::make_shared<ImageResizer>(nullptr);
+    cv::Mat source_test(cv::Size{800, 600}, CV_8UC3);
+    cv::randu(source_test, cv::Scalar::all(0), cv::Scalar::all(255));
+    std::vector<uchar> png_test;
+    cv::imencode(".png", source_test, png_test);
+
+    ResizeOptions options;
+    options.sizes.assign(1, cv::Size{200, 150});
+    options.format = OutputFormat::PNG;
+
+    std::string expected;
+    ASSERT_TRUE(resizer->process_raw(png_test.data(), png_test.size(), options, expected).IsOk());
+
+    std::string output;
+    std::promise<Error> result;
+    {
+        ResizePipeline pipeline(resizer);
+        ASSERT_TRUE(pipeline.try_submit([&](ImageResizer &stage_resizer, ResizeJob &job)
+                                        {
+                                            job.options = options;
+                                            return stage_resizer.decode_raw(png_test.data(), png_test.size(), job); },
+                                        output, [&](const Error &status)
+                                        { result.set_value(status); }));
+        EXPECT_TRUE(result.get_future().get().IsOk());
+    }
+    EXPECT_EQ(output, expected);
+}
@@ -2,10 +2,12 @@
 #include <gtest/gtest.h>
 #include <string>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <tuple>
 #include <rapidjson/document.h>
-
-typedef std::tuple<uint16_t, std::string> HTTP_CODE;
+#include "image_resizer/app.hpp"
+#include "image_resizer/request_arena.hpp"
 
 HTTP_CODE validate_requests(rapidjson::Document &doc)
 {
@@ -52,3 +54,63 @@ TEST(RapidJSONDoc, data_validation)
     EXPECT_EQ(std::get<0>(code4), 200);
     EXPECT_EQ(std::get<1>(code4), "");
 }
+
+/// @brief Minimal http request, the members parse_requests reads
+struct RequestStub
+{
+    struct Headers
+    {
+        std::map<std::string, std::string> fields;
+
+        std::string operator[](const std::string &name) const
+        {
+            auto field = fields.find(name);
+            return field == fields.end() ? std::string() : field->second;
+        }
+    };
+
+    Headers headers;
+    std::string body;
+};
+
+static std::shared_ptr<RequestStub> json_request(const std::string &body)
+{
+    auto req = std::make_shared<RequestStub>();
+    req->headers.fields["Content-Type"] = "application/json";
+    req->body = body;
+    return req;
+}
+
+TEST(RapidJSONDoc, parse_requests_insitu)
+{
+    auto req_test = json_request("{\"input_jpeg\": \"QUJDRA==\", \"desired_width\": 640, \"desired_height\": 480}");
+    RequestArena arena_test;
+    RequestDocument &doc_test = arena_test.document();
+    HTTP_CODE code_test = parse_requests(req_test, doc_test);
+    ASSERT_EQ(std::get<0>(code_test), 200);
+
+    // Strings are views into the request body instead of copies
+    const char *input_test = doc_test["input_jpeg"].GetString();
+    EXPECT_GE(input_test, req_test->body.data());
+    EXPECT_LT(input_test, req_test->body.data() + req_test->body.size());
+    EXPECT_EQ(std::string(input_test, doc_test["input_jpeg"].GetStringLength()), "QUJDRA==");
+    EXPECT_EQ(doc_test["desired_width"].GetInt(), 640);
+    EXPECT_EQ(doc_test["desired_height"].GetInt(), 480);
+}
+
+TEST(RapidJSONDoc, parse_requests_errors)
+{
+    RequestArena arena_test;
+
+    auto empty_test = json_request("");
+    HTTP_CODE code_test = parse_requests(empty_test, arena_test.document());
+    EXPECT_EQ(std::get<0>(code_test), 422);
+    EXPECT_EQ(std::get<1>(code_test), "JSON parse error: 1 - The document is empty.");
+
+    auto truncated_test = json_request("{\"input_jpeg\": \"QUJD");
+    EXPECT_EQ(std::get<0>(parse_requests(truncated_test, arena_test.document())), 422);
+
+    auto text_test = json_request("{}");
+    text_test->headers.fields["Content-Type"] = "text/plain";
+    EXPECT_EQ(std::get<0>(parse_requests(text_test, arena_test.document())), 415);
+}
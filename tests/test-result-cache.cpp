@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include "image_resizer/hash.hpp"
+#include "image_resizer/result_cache.hpp"
+
+TEST(ResultCache, hash_bytes)
+{
+    std::string data_test(100000, 'a');
+    Hash128 hash_test1 = hash_bytes(data_test.data(), data_test.size());
+    EXPECT_EQ(hash_test1, hash_bytes(data_test.data(), data_test.size()));
+
+    // Every byte and the length must change the hash
+    std::string data_test2 = data_test;
+    data_test2[77777] = 'b';
+    EXPECT_NE(hash_test1, hash_bytes(data_test2.data(), data_test2.size()));
+    EXPECT_NE(hash_test1, hash_bytes(data_test.data(), data_test.size() - 1));
+
+    std::string zeros_test(15, '\0');
+    EXPECT_NE(hash_bytes(zeros_test.data(), 14), hash_bytes(zeros_test.data(), 15));
+
+    // Moving a 16-byte block must change the hash, whatever the block holds
+    std::uint64_t moved_test1[8] = {1, 2, 3, 4, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 5, 6};
+    std::uint64_t moved_test2[8] = {1, 2, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 3, 4, 5, 6};
+    EXPECT_NE(hash_bytes(moved_test1, sizeof(moved_test1)), hash_bytes(moved_test2, sizeof(moved_test2)));
+    EXPECT_NE(check_bytes(moved_test1, sizeof(moved_test1)), check_bytes(moved_test2, sizeof(moved_test2)));
+
+    // Seeded hashes are unrelated to the unseeded one
+    EXPECT_NE(hash_test1, hash_bytes(data_test.data(), data_test.size(), 1));
+    EXPECT_NE(check_bytes(data_test.data(), data_test.size()), check_bytes(data_test.data(), data_test.size(), 1));
+    EXPECT_NE(hash_seeds().hash, hash_seeds().check);
+}
+
+/// @brief Key of a short string, seeded like ImageResizer::cache_key
+static CacheKey key_of(const std::string &value)
+{
+    CacheKey key;
+    key.hash = hash_bytes(value.data(), value.size(), hash_seeds().hash);
+    key.check = check_bytes(value.data(), value.size(), hash_seeds().check);
+    key.length = value.size();
+    return key;
+}
+
+TEST(ResultCache, lru_eviction)
+{
+    // Budget for two entries of ~1000 bytes including bookkeeping
+    ResultCache cache_test(2500);
+    EXPECT_TRUE(cache_test.enabled());
+
+    CacheKey key1 = key_of("1"), key2 = key_of("2"), key3 = key_of("3");
+    cache_test.put(key1, std::string(1000, '1'));
+    cache_test.put(key2, std::string(1000, '2'));
+
+    EXPECT_EQ(*cache_test.get(key1), std::string(1000, '1'));
+
+    // key2 is the least recently used one now
+    cache_test.put(key3, std::string(1000, '3'));
+    EXPECT_EQ(cache_test.get(key2), nullptr);
+    EXPECT_NE(cache_test.get(key1), nullptr);
+    EXPECT_NE(cache_test.get(key3), nullptr);
+
+    // Too large for the whole budget
+    cache_test.put(key2, std::string(5000, '2'));
+    EXPECT_EQ(cache_test.get(key2), nullptr);
+
+    ResultCache::Stats stats_test = cache_test.stats();
+    EXPECT_EQ(stats_test.hits, 3u);
+    EXPECT_EQ(stats_test.misses, 2u);
+    EXPECT_EQ(stats_test.evictions, 1u);
+    EXPECT_EQ(stats_test.entries, 2u);
+    EXPECT_LE(stats_test.bytes, stats_test.capacity_bytes);
+
+    ResultCache disabled_test(0);
+    EXPECT_FALSE(disabled_test.enabled());
+    disabled_test.put(key1, "1");
+    EXPECT_EQ(disabled_test.get(key1), nullptr);
+}
+
+TEST(ResultCache, checks_colliding_keys)
+{
+    ResultCache cache_test(1024 * 1024);
+    CacheKey key_test = key_of("original");
+    cache_test.put(key_test, "original response");
+
+    // Same hash, another input: a miss, and the entry stays
+    CacheKey colliding_test = key_test;
+    colliding_test.check ^= 1;
+    EXPECT_EQ(cache_test.get(colliding_test), nullptr);
+    cache_test.put(colliding_test, "crafted response");
+    EXPECT_EQ(cache_test.get(colliding_test), nullptr);
+
+    CacheKey longer_test = key_test;
+    longer_test.length += 16;
+    EXPECT_EQ(cache_test.get(longer_test), nullptr);
+
+    ASSERT_NE(cache_test.get(key_test), nullptr);
+    EXPECT_EQ(*cache_test.get(key_test), "original response");
+    EXPECT_EQ(cache_test.stats().entries, 1u);
+}
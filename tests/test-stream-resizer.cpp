@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "image_resizer/codec.hpp"
+#include "image_resizer/image_resizer.hpp"
+#include "image_resizer/interpolation.hpp"
+#include "image_resizer/stream_resizer.hpp"
+
+/// @brief Resize an image by streaming its rows through a StreamResizer
+static cv::Mat stream_rows(const cv::Mat &source, const cv::Size &size, Interpolation interpolation)
+{
+    cv::Mat output(size, source.type());
+    int row_test = 0;
+    StreamResizer resizer(source.size(), source.channels(), size, interpolation);
+    for (int y = 0; y < source.rows; ++y)
+    {
+        resizer.push_row(source.ptr(y), [&](const uchar *row)
+                         { std::memcpy(output.ptr(row_test++), row, output.cols * output.elemSize()); });
+    }
+    EXPECT_TRUE(resizer.done());
+    EXPECT_EQ(row_test, size.height);
+    return output;
+}
+
+TEST(StreamResizer, matches_cv_resize)
+{
+    cv::Mat source_test(cv::Size{397, 263}, CV_8UC3);
+    cv::randu(source_test, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    // Area averages exactly like cv::INTER_AREA, up to rounding
+    cv::Mat expected_test;
+    cv::resize(source_test, expected_test, cv::Size{101, 67}, 0, 0, cv::INTER_AREA);
+    EXPECT_LE(cv::norm(stream_rows(source_test, cv::Size{101, 67}, Interpolation::AREA), expected_test, cv::NORM_INF), 1.0);
+
+    cv::resize(source_test, expected_test, cv::Size{500, 300}, 0, 0, cv::INTER_LINEAR);
+    EXPECT_LE(cv::norm(stream_rows(source_test, cv::Size{500, 300}, Interpolation::LINEAR), expected_test, cv::NORM_INF), 1.0);
+
+    cv::resize(source_test, expected_test, cv::Size{50, 40}, 0, 0, cv::INTER_NEAREST);
+    EXPECT_EQ(cv::norm(stream_rows(source_test, cv::Size{50, 40}, Interpolation::NEAREST), expected_test, cv::NORM_INF), 0.0);
+
+    // Same size is a copy
+    EXPECT_EQ(cv::norm(stream_rows(source_test, source_test.size(), Interpolation::LINEAR), source_test, cv::NORM_INF), 0.0);
+}
+
+TEST(StreamResizer, linear_shrink_is_filtered)
+{
+    // One pixel checkerboard, sampling it with a two-tap tent keeps the pattern
+    cv::Mat source_test(cv::Size{400, 400}, CV_8UC1);
+    for (int y = 0; y < source_test.rows; ++y)
+        for (int x = 0; x < source_test.cols; ++x)
+            source_test.at<uchar>(y, x) = ((x + y) % 2) ? 255 : 0;
+
+    // Averaged to flat gray like resample_image with its pyrDown levels
+    cv::Mat expected_test;
+    resample_image(source_test, expected_test, cv::Size{50, 50}, Interpolation::LINEAR);
+    cv::Mat output_test = stream_rows(source_test, cv::Size{50, 50}, Interpolation::LINEAR);
+    EXPECT_LE(cv::norm(output_test, expected_test, cv::NORM_INF), 2.0);
+    EXPECT_LE(cv::norm(output_test, cv::Mat(output_test.size(), CV_8UC1, cv::Scalar(128)), cv::NORM_INF), 1.0);
+}
+
+TEST(StreamResizer, stream_encoded_images)
+{
+    cv::Mat source_test(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::vector<uchar> jpeg_test, png_test;
+    cv::imencode(".jpg", source_test, jpeg_test);
+    cv::imencode(".png", source_test, png_test);
+    std::vector<cv::Size> sizes_test = {cv::Size{640, 360}, cv::Size{100, 80}};
+
+    std::vector<std::vector<uchar>> outputs_test;
+    ASSERT_TRUE(stream_resize(jpeg_test.data(), jpeg_test.size(), sizes_test, Interpolation::AREA, OutputFormat::JPEG, -1, -1,
+                              default_codec(), outputs_test));
+    ASSERT_EQ(outputs_test.size(), 2u);
+    cv::Mat output_test = cv::imdecode(outputs_test[0], cv::IMREAD_UNCHANGED);
+    EXPECT_TRUE((output_test.size() == cv::Size{640, 360}));
+    EXPECT_LE(cv::norm(output_test, cv::Mat(output_test.size(), CV_8UC3, cv::Scalar(40, 80, 120)), cv::NORM_INF), 4.0);
+    EXPECT_TRUE((cv::imdecode(outputs_test[1], cv::IMREAD_UNCHANGED).size() == cv::Size{100, 80}));
+
+    // PNG in, lossless PNG out
+    ASSERT_TRUE(stream_resize(png_test.data(), png_test.size(), sizes_test, Interpolation::LINEAR, OutputFormat::PNG, -1, 1,
+                              default_codec(), outputs_test));
+    output_test = cv::imdecode(outputs_test[1], cv::IMREAD_UNCHANGED);
+    EXPECT_EQ(cv::norm(output_test, cv::Mat(output_test.size(), CV_8UC3, cv::Scalar(40, 80, 120)), cv::NORM_INF), 0.0);
+
+    // Interlaced, 16-bit or truncated PNGs are left to the regular path
+    cv::Mat deep_test(cv::Size{64, 64}, CV_16UC3, cv::Scalar(1000, 2000, 3000));
+    cv::imencode(".png", deep_test, png_test);
+    EXPECT_FALSE(stream_resize(png_test.data(), png_test.size(), sizes_test, Interpolation::AREA, OutputFormat::JPEG, -1, -1,
+                               default_codec(), outputs_test));
+    cv::imencode(".png", source_test, png_test);
+    EXPECT_FALSE(stream_resize(png_test.data(), png_test.size() / 2, sizes_test, Interpolation::AREA, OutputFormat::JPEG, -1, -1,
+                               default_codec(), outputs_test));
+}
+
+TEST(StreamResizer, resizer_streams_large_sources)
+{
+    // Every source streamed
+    ImageResizer image_resizer_obj(nullptr, nullptr, 1);
+
+    cv::Mat source_test(cv::Size{1280, 720}, CV_8UC3, cv::Scalar(40, 80, 120));
+    std::vector<uchar> png_test;
+    cv::imencode(".png", source_test, png_test);
+
+    ResizeOptions options_test;
+    options_test.sizes.emplace_back(320, 240);
+    options_test.interpolation = Interpolation::AREA;
+
+    std::string output_str_test;
+    EXPECT_EQ(image_resizer_obj.process_raw(png_test.data(), png_test.size(), options_test, output_str_test), Error::Success);
+    std::vector<uchar> output_bytes_test(output_str_test.begin(), output_str_test.end());
+    EXPECT_TRUE((cv::imdecode(output_bytes_test, cv::IMREAD_UNCHANGED).size() == cv::Size{320, 240}));
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "image_resizer/worker_pool.hpp"
+
+TEST(WorkerPool, runs_tasks_on_workers)
+{
+    WorkerPool pool(4, 64);
+    EXPECT_EQ(pool.size(), 4u);
+    EXPECT_EQ(pool.capacity(), 64u);
+
+    std::mutex mutex;
+    std::set<std::thread::id> thread_ids;
+    std::vector<std::future<void>> results;
+    std::atomic<int> counter{0};
+
+    for (int i = 0; i < 32; ++i)
+    {
+        auto promise = std::make_shared<std::promise<void>>();
+        results.push_back(promise->get_future());
+        EXPECT_TRUE(pool.try_post([&, promise]()
+                                  {
+                                      {
+                                          std::lock_guard<std::mutex> lock(mutex);
+                                          thread_ids.insert(std::this_thread::get_id());
+                                      }
+                                      ++counter;
+                                      promise->set_value(); }));
+    }
+
+    for (auto &result : results)
+        result.wait();
+
+    EXPECT_EQ(counter.load(), 32);
+    EXPECT_EQ(thread_ids.count(std::this_thread::get_id()), 0u);
+}
+
+TEST(WorkerPool, bounded_queue)
+{
+    WorkerPool pool(1, 2);
+
+    // Park the only worker so that queued tasks stay queued
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> started;
+    EXPECT_TRUE(pool.try_post([&]()
+                              { started.set_value(); released.wait(); }));
+    started.get_future().wait();
+
+    std::atomic<int> counter{0};
+    EXPECT_TRUE(pool.try_post([&]()
+                              { ++counter; }));
+    EXPECT_TRUE(pool.try_post([&]()
+                              { ++counter; }));
+    EXPECT_FALSE(pool.try_post([&]()
+                               { ++counter; }));
+    EXPECT_EQ(pool.pending(), 2u);
+
+    release.set_value();
+    while (pool.pending() != 0 || counter.load() != 2)
+        std::this_thread::yield();
+    EXPECT_EQ(counter.load(), 2);
+}
+
+TEST(WorkerPool, drains_on_destruction)
+{
+    std::atomic<int> counter{0};
+    {
+        WorkerPool pool(2, 100);
+        for (int i = 0; i < 100; ++i)
+            EXPECT_TRUE(pool.try_post([&]()
+                                      { ++counter; }));
+    }
+    EXPECT_EQ(counter.load(), 100);
+
+    WorkerPool default_pool;
+    EXPECT_GE(default_pool.size(), 1u);
+    EXPECT_EQ(default_pool.capacity(), default_pool.size() * 4);
+}
+
+/// @brief Occupy every worker of a pool until the returned promise is set
+static std::shared_ptr<std::promise<void>> park_workers(WorkerPool &pool, std::size_t count)
+{
+    auto release = std::make_shared<std::promise<void>>();
+    std::shared_future<void> released = release->get_future().share();
+    std::atomic<std::size_t> started{0};
+    for (std::size_t i = 0; i < count; ++i)
+        EXPECT_TRUE(pool.try_post([&started, released]()
+                                  { ++started; released.wait(); }));
+    while (started.load() != count)
+        std::this_thread::yield();
+    return release;
+}
+
+// Records the order tasks ran in; the test thread reads it only under the lock
+struct RunOrder
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<int> order;
+
+    void record(int value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(value);
+        changed.notify_all();
+    }
+
+    std::vector<int> wait_for(std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]()
+                     { return order.size() == count; });
+        return order;
+    }
+};
+
+TEST(WorkerPool, runs_cheapest_first)
+{
+    SchedulerOptions scheduling;
+    scheduling.aging_per_ms = 0;
+    WorkerPool pool(1, 16, scheduling);
+    auto release = park_workers(pool, 1);
+
+    RunOrder run_order;
+    for (int cost : {500, 100, 300, 100, 0})
+        EXPECT_TRUE(pool.try_post([&run_order, cost]()
+                                  { run_order.record(cost); },
+                                  cost));
+
+    release->set_value();
+    EXPECT_EQ(run_order.wait_for(5), std::vector<int>({0, 100, 100, 300, 500}));
+}
+
+TEST(WorkerPool, ages_waiting_tasks)
+{
+    SchedulerOptions scheduling;
+    scheduling.aging_per_ms = 1000;
+    WorkerPool pool(1, 16, scheduling);
+    auto release = park_workers(pool, 1);
+
+    RunOrder run_order;
+    EXPECT_TRUE(pool.try_post([&run_order]()
+                              { run_order.record(1); },
+                              10000));
+
+    // Waited long enough to be worth more than the cost difference
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(pool.try_post([&run_order]()
+                              { run_order.record(2); },
+                              100));
+
+    release->set_value();
+    EXPECT_EQ(run_order.wait_for(2), std::vector<int>({1, 2}));
+}
+
+TEST(WorkerPool, reserves_workers_for_small_tasks)
+{
+    SchedulerOptions scheduling;
+    scheduling.reserved_workers = 1;
+    scheduling.small_task_cost = 100;
+    WorkerPool pool(2, 16, scheduling);
+    EXPECT_EQ(pool.reserved(), 1u);
+
+    // Large tasks occupy the general worker only
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> large_started{0};
+    for (int i = 0; i < 2; ++i)
+        EXPECT_TRUE(pool.try_post([&]()
+                                  { ++large_started; released.wait(); },
+                                  1000));
+    while (large_started.load() != 1)
+        std::this_thread::yield();
+
+    std::promise<void> small_done;
+    EXPECT_TRUE(pool.try_post([&]()
+                              { small_done.set_value(); },
+                              10));
+    EXPECT_EQ(small_done.get_future().wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(large_started.load(), 1);
+    EXPECT_EQ(pool.pending(), 1u);
+
+    release.set_value();
+    while (pool.pending() != 0 || large_started.load() != 2)
+        std::this_thread::yield();
+
+    // Every worker reserved would leave large tasks unserved
+    SchedulerOptions all_reserved;
+    all_reserved.reserved_workers = 8;
+    WorkerPool clamped(2, 4, all_reserved);
+    EXPECT_EQ(clamped.reserved(), 1u);
+}